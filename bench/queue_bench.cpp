@@ -0,0 +1,105 @@
+/***************************************************************************
+ *
+ * OSAL
+ * Copyright (C) 2023 / 2024  Antonio Salsi <passy.linux@zresa.it>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ***************************************************************************/
+#include "osal/osal.hpp"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+// Contention benchmark: half of the threads post, the other half fetch, on one shared queue.
+
+namespace
+{
+
+constexpr uint32_t QUEUE_SIZE = 64;
+constexpr uint32_t MESSAGES_PER_PRODUCER = 200'000;
+constexpr uint32_t MAX_THREADS = 16;
+
+struct message
+{
+    uint64_t seq;
+    uint64_t payload;
+};
+
+struct context
+{
+    os::queue* q;
+    uint32_t messages;
+};
+
+void* producer(void* arg)
+{
+    auto ctx = static_cast<context*>(arg);
+    message msg{};
+    for(uint32_t i = 0; i < ctx->messages; i++)
+    {
+        msg.seq = i;
+        ctx->q->post(reinterpret_cast<const uint8_t*>(&msg), os::WAIT_FOREVER);
+    }
+    return nullptr;
+}
+
+void* consumer(void* arg)
+{
+    auto ctx = static_cast<context*>(arg);
+    message msg{};
+    for(uint32_t i = 0; i < ctx->messages; i++)
+    {
+        ctx->q->fetch(&msg, os::WAIT_FOREVER);
+    }
+    return nullptr;
+}
+
+double run(os::queue_mode mode, uint32_t threads)
+{
+    os::queue q{QUEUE_SIZE, sizeof(message), mode};
+    context ctx{&q, MESSAGES_PER_PRODUCER};
+    os::thread* workers[MAX_THREADS]{};
+    const uint32_t pairs = threads / 2;
+
+    const uint64_t start = os::get_current_time_us();
+    for(uint32_t i = 0; i < pairs; i++)
+    {
+        workers[2 * i] = new os::thread("bench_c", 4, 4 * 1024, consumer);
+        workers[2 * i]->create(&ctx);
+        workers[2 * i + 1] = new os::thread("bench_p", 4, 4 * 1024, producer);
+        workers[2 * i + 1]->create(&ctx);
+    }
+    for(uint32_t i = 0; i < pairs * 2; i++)
+    {
+        workers[i]->join();
+        delete workers[i];
+    }
+    const uint64_t elapsed = os::get_current_time_us() - start;
+
+    return static_cast<double>(pairs * MESSAGES_PER_PRODUCER) / (static_cast<double>(elapsed) / 1e6);
+}
+
+}
+
+int main()
+{
+    printf("%-8s %14s %14s %8s\n", "threads", "LOCKED msg/s", "MPMC msg/s", "ratio");
+    for(uint32_t threads = 2; threads <= MAX_THREADS; threads *= 2)
+    {
+        const double locked = run(os::queue_mode::LOCKED, threads);
+        const double mpmc = run(os::queue_mode::MPMC, threads);
+        printf("%-8u %14.0f %14.0f %7.2fx\n", threads, locked, mpmc, mpmc / locked);
+    }
+    return EXIT_SUCCESS;
+}
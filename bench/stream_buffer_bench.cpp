@@ -0,0 +1,203 @@
+/***************************************************************************
+ * 
+ * OSAL
+ * Copyright (C) 2023/2024 Antonio Salsi <passy.linux@zresa.it>
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>. 
+ * 
+ ***************************************************************************/
+#include "osal/osal.hpp"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+// Stream buffer throughput benchmark: one writer and one reader move a byte pattern through the
+// buffer in fixed-size chunks; the reader checks every byte, so lost or reordered data is reported.
+// The fd runs feed the buffer from a socketpair, through a bounce buffer or with send_from_fd().
+
+namespace
+{
+
+constexpr size_t BUFFER_SIZE = 4096;
+constexpr size_t TOTAL_BYTES = 64 * 1024 * 1024;
+constexpr size_t MAX_CHUNK = 1024;
+
+struct context
+{
+    os::stream_buffer* sb;
+    size_t chunk;
+    size_t errors;
+};
+
+inline uint8_t pattern(size_t i)
+{
+    return static_cast<uint8_t>(i % 251);
+}
+
+void* writer(void* arg)
+{
+    auto ctx = static_cast<context*>(arg);
+    uint8_t data[MAX_CHUNK];
+    size_t sent = 0;
+    while(sent < TOTAL_BYTES)
+    {
+        const size_t n = TOTAL_BYTES - sent < ctx->chunk ? TOTAL_BYTES - sent : ctx->chunk;
+        for(size_t i = 0; i < n; i++)
+        {
+            data[i] = pattern(sent + i);
+        }
+        size_t done = 0;
+        while(done < n)
+        {
+            done += ctx->sb->send(data + done, n - done, os::WAIT_FOREVER);
+        }
+        sent += n;
+    }
+    return nullptr;
+}
+
+void* reader(void* arg)
+{
+    auto ctx = static_cast<context*>(arg);
+    uint8_t data[MAX_CHUNK];
+    size_t received = 0;
+    while(received < TOTAL_BYTES)
+    {
+        const size_t n = ctx->sb->receive(data, ctx->chunk, os::WAIT_FOREVER);
+        for(size_t i = 0; i < n; i++)
+        {
+            if(data[i] != pattern(received + i))
+            {
+                ctx->errors++;
+            }
+        }
+        received += n;
+    }
+    return nullptr;
+}
+
+void run(size_t chunk, os::stream_buffer_mode mode)
+{
+    os::stream_buffer sb{BUFFER_SIZE, 1, mode};
+    context ctx{&sb, chunk, 0};
+    os::thread r{"bench_r", 4, 4 * 1024, reader};
+    os::thread w{"bench_w", 4, 4 * 1024, writer};
+
+    const uint64_t start = os::get_current_time_us();
+    r.create(&ctx);
+    w.create(&ctx);
+    w.join();
+    r.join();
+    const uint64_t elapsed = os::get_current_time_us() - start;
+
+    printf("%-10s %-10zu %14.1f %14zu\n", mode == os::stream_buffer_mode::MIRRORED ? "mirrored" : "ring", chunk, (static_cast<double>(TOTAL_BYTES) / (1024.0 * 1024.0)) / (static_cast<double>(elapsed) / 1e6), ctx.errors);
+}
+
+struct fd_context
+{
+    os::stream_buffer* sb;
+    int fd;
+};
+
+void* socket_writer(void* arg)
+{
+    auto ctx = static_cast<fd_context*>(arg);
+    static uint8_t data[64 * 1024];
+    for(size_t sent = 0; sent < TOTAL_BYTES; )
+    {
+        const ssize_t n = write(ctx->fd, data, TOTAL_BYTES - sent < sizeof(data) ? TOTAL_BYTES - sent : sizeof(data));
+        if(n <= 0)
+        {
+            break;
+        }
+        sent += n;
+    }
+    return nullptr;
+}
+
+void* drain(void* arg)
+{
+    auto ctx = static_cast<fd_context*>(arg);
+    uint8_t data[MAX_CHUNK];
+    for(size_t received = 0; received < TOTAL_BYTES; )
+    {
+        received += ctx->sb->receive(data, sizeof(data), os::WAIT_FOREVER);
+    }
+    return nullptr;
+}
+
+void run_fd(bool bounce)
+{
+    int sp[2];
+    if(socketpair(AF_UNIX, SOCK_STREAM, 0, sp) != 0)
+    {
+        return;
+    }
+
+    os::stream_buffer sb{BUFFER_SIZE, 1};
+    fd_context writer_ctx{&sb, sp[0]};
+    fd_context drain_ctx{&sb, -1};
+    os::thread w{"bench_w", 4, 4 * 1024, socket_writer};
+    os::thread d{"bench_d", 4, 4 * 1024, drain};
+
+    const uint64_t start = os::get_current_time_us();
+    w.create(&writer_ctx);
+    d.create(&drain_ctx);
+
+    uint8_t data[MAX_CHUNK];
+    for(size_t moved = 0; moved < TOTAL_BYTES; )
+    {
+        if(bounce)
+        {
+            const ssize_t n = read(sp[1], data, sizeof(data));
+            size_t done = 0;
+            while(n > 0 && done < static_cast<size_t>(n))
+            {
+                done += sb.send(data + done, n - done, os::WAIT_FOREVER);
+            }
+            moved += n > 0 ? n : 0;
+        }
+        else
+        {
+            moved += sb.send_from_fd(sp[1], MAX_CHUNK, os::WAIT_FOREVER);
+        }
+    }
+
+    w.join();
+    d.join();
+    const uint64_t elapsed = os::get_current_time_us() - start;
+    close(sp[0]);
+    close(sp[1]);
+
+    printf("%-10s %-10zu %14.1f %14s\n", bounce ? "fd bounce" : "fd readv", MAX_CHUNK, (static_cast<double>(TOTAL_BYTES) / (1024.0 * 1024.0)) / (static_cast<double>(elapsed) / 1e6), "-");
+}
+
+}
+
+int main()
+{
+    printf("%-10s %-10s %14s %14s\n", "mode", "chunk", "MB/s", "bad bytes");
+    for(size_t chunk = 16; chunk <= MAX_CHUNK; chunk *= 4)
+    {
+        run(chunk, os::stream_buffer_mode::RING);
+    }
+    for(size_t chunk = 16; chunk <= MAX_CHUNK; chunk *= 4)
+    {
+        run(chunk, os::stream_buffer_mode::MIRRORED);
+    }
+    run_fd(true);
+    run_fd(false);
+    return EXIT_SUCCESS;
+}
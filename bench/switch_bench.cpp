@@ -0,0 +1,112 @@
+/***************************************************************************
+ * 
+ * OSAL
+ * Copyright (C) 2023/2024 Antonio Salsi <passy.linux@zresa.it>
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>. 
+ * 
+ ***************************************************************************/
+#include "osal/osal.hpp"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/resource.h>
+
+// Scheduler switch benchmark: producers and consumers share a small LOCKED queue, so most
+// operations block; the number of context switches per message measures wasted wakeups.
+
+namespace
+{
+
+constexpr uint32_t QUEUE_SIZE = 4;
+constexpr uint32_t MESSAGES_PER_PRODUCER = 48'000; // divisible by every consumer count below
+constexpr uint32_t MAX_THREADS = 16;
+
+struct context
+{
+    os::queue* q;
+    uint32_t messages;
+};
+
+void* producer(void* arg)
+{
+    auto ctx = static_cast<context*>(arg);
+    for(uint32_t i = 0; i < ctx->messages; i++)
+    {
+        ctx->q->post(reinterpret_cast<const uint8_t*>(&i), os::WAIT_FOREVER);
+    }
+    return nullptr;
+}
+
+void* consumer(void* arg)
+{
+    auto ctx = static_cast<context*>(arg);
+    uint32_t msg = 0;
+    for(uint32_t i = 0; i < ctx->messages; i++)
+    {
+        ctx->q->fetch(&msg, os::WAIT_FOREVER);
+    }
+    return nullptr;
+}
+
+long switches()
+{
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_nvcsw + usage.ru_nivcsw;
+}
+
+void run(uint32_t producers, uint32_t consumers)
+{
+    os::queue q{QUEUE_SIZE, sizeof(uint32_t)};
+    context producer_ctx{&q, MESSAGES_PER_PRODUCER};
+    context consumer_ctx{&q, MESSAGES_PER_PRODUCER * producers / consumers};
+    os::thread* workers[MAX_THREADS]{};
+
+    const long start_switches = switches();
+    const uint64_t start = os::get_current_time_us();
+    for(uint32_t i = 0; i < consumers; i++)
+    {
+        workers[i] = new os::thread("bench_c", 4, 4 * 1024, consumer);
+        workers[i]->create(&consumer_ctx);
+    }
+    for(uint32_t i = 0; i < producers; i++)
+    {
+        workers[consumers + i] = new os::thread("bench_p", 4, 4 * 1024, producer);
+        workers[consumers + i]->create(&producer_ctx);
+    }
+    for(uint32_t i = 0; i < producers + consumers; i++)
+    {
+        workers[i]->join();
+        delete workers[i];
+    }
+    const uint64_t elapsed = os::get_current_time_us() - start;
+    const long total = switches() - start_switches;
+    const double messages = static_cast<double>(producers) * MESSAGES_PER_PRODUCER;
+
+    printf("%-10u %-10u %14.3f %14.0f\n", producers, consumers, static_cast<double>(total) / messages, messages / (static_cast<double>(elapsed) / 1e6));
+}
+
+}
+
+int main()
+{
+    printf("%-10s %-10s %14s %14s\n", "producers", "consumers", "switch/msg", "msg/s");
+    for(uint32_t threads = 2; threads <= MAX_THREADS; threads *= 2)
+    {
+        run(threads / 2, threads / 2);
+    }
+    run(12, 4);
+    run(4, 12);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,328 @@
+/***************************************************************************
+ * 
+ * OSAL
+ * Copyright (C) 2023/2024 Antonio Salsi <passy.linux@zresa.it>
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>. 
+ * 
+ ***************************************************************************/
+#include "osal/osal.hpp"
+
+#include <algorithm>
+#include <initializer_list>
+#include <iterator>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+// Timer jitter benchmark: a periodic timer records how late each expiration fires after the
+// closest point of its ideal schedule (start + k * period) and how many schedule points passed
+// without a call. The osal timer service is compared with the former unix backend, a POSIX timer
+// delivering SIGALRM to a thread waiting in sigtimedwait(). The slack runs count the service
+// wakeups saved by batching expirations. The stress runs arm N timers with periods cycling over
+// 1/2/5/10 ms and print the lateness percentiles of the timer_stats histograms, for both dispatch
+// modes and for the same number of POSIX timers signalling one thread.
+
+namespace
+{
+
+constexpr uint32_t EXPIRATIONS = 2'000;
+constexpr uint64_t PERIODS_US[] = {1'000, 250};
+constexpr uint64_t STRESS_PERIODS_US[] = {1'000, 2'000, 5'000, 10'000};
+constexpr uint64_t STRESS_US = 2'000'000;
+constexpr size_t STRESS_MAX = 256;
+
+uint64_t now_ns()
+{
+    timespec ts{};
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1'000'000'000 + ts.tv_nsec;
+}
+
+struct context
+{
+    uint64_t start;
+    uint64_t period;
+    uint64_t last;      ///< Schedule point of the last call.
+    uint32_t count;
+    uint64_t lateness[EXPIRATIONS];
+};
+
+context ctx;
+
+void record()
+{
+    if(ctx.count < EXPIRATIONS)
+    {
+        const uint64_t elapsed = now_ns() - ctx.start;
+        ctx.last = elapsed / ctx.period;
+        ctx.lateness[ctx.count++] = elapsed % ctx.period;
+    }
+}
+
+void print(const char* backend, uint64_t period_us)
+{
+    std::sort(ctx.lateness, ctx.lateness + ctx.count);
+    auto percentile = [](double p) { return static_cast<double>(ctx.lateness[static_cast<size_t>(p * (ctx.count - 1))]) / 1'000.0; };
+
+    printf("%-12s %-10lu %10.1f %10.1f %10.1f %10lu\n", backend, period_us, percentile(0.5), percentile(0.99), percentile(0.999), ctx.last - ctx.count);
+}
+
+void run_osal(uint64_t period_us)
+{
+    auto timer = new os::timer{period_us, [](auto, auto) -> void*
+                               {
+                                   record();
+                                   return nullptr;
+                               }};
+
+    ctx.count = 0;
+    ctx.period = period_us * 1'000;
+    timer->create();
+    ctx.start = now_ns();
+    timer->start();
+    while(ctx.count < EXPIRATIONS)
+    {
+        os::us_sleep(10'000);
+    }
+
+    const uint64_t stop = now_ns();
+    delete timer;
+    const uint64_t shutdown = now_ns() - stop;
+    print("osal", period_us);
+    printf("%-12s shutdown %.3f ms\n", "osal", static_cast<double>(shutdown) / 1e6);
+}
+
+void print_stress(const char* backend, size_t timers, const os::timer_stats& stats)
+{
+    auto us = [](uint64_t ns) { return static_cast<double>(ns) / 1'000.0; };
+
+    printf("%-12s %-8lu %10lu %10.1f %10.1f %10.1f %12.1f %12lu\n", backend, timers, stats.lateness.count()
+           , us(stats.lateness.percentile(50)), us(stats.lateness.percentile(99)), us(stats.lateness.percentile(99.9))
+           , us(stats.run_time.percentile(99)), stats.overrun.percentile(99.9));
+}
+
+void run_stress_osal(size_t count, os::timer_dispatch dispatch)
+{
+    os::timer* timers[STRESS_MAX]{};
+    os::timer_stats& stats = os::timer::get_global_stats();
+
+    stats.reset();
+    for(size_t i = 0; i < count; i++)
+    {
+        timers[i] = new os::timer{STRESS_PERIODS_US[i % std::size(STRESS_PERIODS_US)], [](auto, auto) -> void* { return nullptr; }};
+        timers[i]->create();
+        timers[i]->set_dispatch(dispatch);
+        timers[i]->start();
+    }
+    os::us_sleep(STRESS_US);
+    for(size_t i = 0; i < count; i++)
+    {
+        delete timers[i];
+    }
+
+    print_stress(dispatch == os::timer_dispatch::POOL ? "osal pool" : "osal inline", count, stats);
+}
+
+void run_slack(uint64_t slack_us)
+{
+    constexpr size_t TIMERS = 64;
+    os::timer* timers[TIMERS]{};
+
+    const os::timer_service_stats before = os::timer::get_service_stats();
+    for(size_t i = 0; i < TIMERS; i++)
+    {
+        timers[i] = new os::timer{10'000, [](auto, auto) -> void* { return nullptr; }};
+        timers[i]->create();
+        timers[i]->set_slack(slack_us);
+
+        // spread the phases over the period
+        timers[i]->start_at(os::tick_current() + os::tick_from_us(10'000 * i / TIMERS));
+    }
+    os::us_sleep(1'000'000);
+    for(auto timer : timers)
+    {
+        delete timer;
+    }
+    const os::timer_service_stats after = os::timer::get_service_stats();
+
+    printf("%-12lu %12lu %12lu %12lu\n", slack_us, after.wakeups - before.wakeups, after.expirations - before.expirations, after.saved_wakeups - before.saved_wakeups);
+}
+
+volatile pid_t signal_tid = 0;
+volatile bool signal_exit = false;
+
+struct stress_context
+{
+    bool enabled;
+    uint64_t start[STRESS_MAX];
+    uint64_t period[STRESS_MAX];
+    uint64_t next[STRESS_MAX];     ///< Schedule point of the next signal.
+    os::timer_stats stats;
+};
+
+stress_context stress;
+
+void stress_record(size_t i, uint32_t overrun)
+{
+    // one signal per served schedule point, the ones missed meanwhile are its overrun: the same
+    // accounting as the osal service with timer_policy::SKIP
+    const uint64_t begin = now_ns();
+    const uint64_t scheduled = stress.start[i] + stress.next[i] * stress.period[i];
+    stress.next[i] += 1 + overrun;
+    stress.stats.record(begin > scheduled ? begin - scheduled : 0, now_ns() - begin, overrun);
+}
+
+void* signal_thread(void*)
+{
+    sigset_t sigset{};
+    siginfo_t si{};
+    timespec tmo{0, 500'000'000};
+
+    sigemptyset(&sigset);
+    sigaddset(&sigset, SIGALRM);
+    signal_tid = static_cast<pid_t>(syscall(SYS_gettid));
+    while(!signal_exit)
+    {
+        if(sigtimedwait(&sigset, &si, &tmo) == SIGALRM)
+        {
+            if(stress.enabled)
+            {
+                stress_record(static_cast<size_t>(si.si_value.sival_int), static_cast<uint32_t>(si.si_overrun));
+            }
+            else
+            {
+                record();
+            }
+        }
+    }
+    return nullptr;
+}
+
+void signal_start(os::thread& thread)
+{
+    sigset_t sigset{};
+    sigemptyset(&sigset);
+    sigaddset(&sigset, SIGALRM);
+    pthread_sigmask(SIG_BLOCK, &sigset, nullptr);
+
+    signal_tid = 0;
+    signal_exit = false;
+    thread.create();
+    while(signal_tid == 0)
+    {
+        sched_yield();
+    }
+}
+
+timer_t signal_timer(int index, uint64_t period)
+{
+    sigevent sev{};
+    timer_t id{};
+    sev.sigev_notify = SIGEV_THREAD_ID;
+    sev.sigev_signo = SIGALRM;
+    sev.sigev_value.sival_int = index;
+    sev._sigev_un._tid = signal_tid;
+    timer_create(CLOCK_MONOTONIC, &sev, &id);
+
+    itimerspec its{};
+    its.it_value.tv_nsec = static_cast<long>(period);
+    its.it_interval.tv_nsec = static_cast<long>(period);
+    timer_settime(id, 0, &its, nullptr);
+    return id;
+}
+
+void run_signal(uint64_t period_us)
+{
+    os::thread thread{"bench_sig", 30, 4 * 1024, signal_thread};
+
+    ctx.count = 0;
+    ctx.period = period_us * 1'000;
+    signal_start(thread);
+
+    ctx.start = now_ns();
+    timer_t id = signal_timer(0, ctx.period);
+    while(ctx.count < EXPIRATIONS)
+    {
+        os::us_sleep(10'000);
+    }
+    timer_delete(id);
+
+    // the 500 ms sigtimedwait() poll is also how long the old timer destructor could block
+    const uint64_t stop = now_ns();
+    signal_exit = true;
+    thread.join();
+    const uint64_t shutdown = now_ns() - stop;
+    print("signal", period_us);
+    printf("%-12s shutdown %.3f ms\n", "signal", static_cast<double>(shutdown) / 1e6);
+}
+
+void run_stress_signal(size_t count)
+{
+    os::thread thread{"bench_sig", 30, 4 * 1024, signal_thread};
+    timer_t ids[STRESS_MAX]{};
+
+    stress.enabled = true;
+    stress.stats.reset();
+    signal_start(thread);
+    for(size_t i = 0; i < count; i++)
+    {
+        stress.period[i] = STRESS_PERIODS_US[i % std::size(STRESS_PERIODS_US)] * 1'000;
+        stress.start[i] = now_ns();
+        stress.next[i] = 1;
+        ids[i] = signal_timer(static_cast<int>(i), stress.period[i]);
+    }
+    os::us_sleep(STRESS_US);
+    for(size_t i = 0; i < count; i++)
+    {
+        timer_delete(ids[i]);
+    }
+    signal_exit = true;
+    thread.join();
+    stress.enabled = false;
+
+    print_stress("signal", count, stress.stats);
+}
+
+}
+
+int main()
+{
+    printf("%-12s %-10s %10s %10s %10s %10s\n", "backend", "period us", "p50 us", "p99 us", "p99.9 us", "missed");
+    for(const uint64_t period : PERIODS_US)
+    {
+        run_osal(period);
+        run_signal(period);
+    }
+
+    // 64 timers with a 10 ms period and spread phases
+    printf("\n%-12s %12s %12s %12s\n", "slack us", "wakeups", "expirations", "saved");
+    for(const uint64_t slack : {0, 1'000, 5'000})
+    {
+        run_slack(slack);
+    }
+
+    // N timers with periods cycling over 1/2/5/10 ms, lateness percentiles from the histograms,
+    // which round up to the next power of two nanoseconds
+    printf("\n%-12s %-8s %10s %10s %10s %10s %12s %12s\n", "backend", "timers", "calls", "p50 us", "p99 us", "p99.9 us", "run p99 us", "overrun p99.9");
+    for(const size_t count : {16, 256})
+    {
+        run_stress_osal(count, os::timer_dispatch::INLINE);
+        run_stress_osal(count, os::timer_dispatch::POOL);
+        run_stress_signal(count);
+    }
+    return EXIT_SUCCESS;
+}
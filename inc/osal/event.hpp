@@ -69,6 +69,17 @@ public:
      */
     osal::exit wait(uint32_t mask, uint32_t& value, uint64_t time, error** error = nullptr) OS_NOEXCEPT;
 
+    /**
+     * @brief Waits for an event to be set until an absolute deadline.
+     *
+     * @param mask The event mask specifying which bits to wait for.
+     * @param value Reference to a variable where the value of the event will be stored.
+     * @param deadline Absolute tick (see osal::deadline) or WAIT_FOREVER.
+     * @param error Optional pointer to an error object to be populated in case of failure.
+     * @return `OK` if the event was set, `KO` if the deadline passed.
+     */
+    osal::exit wait_until(uint32_t mask, uint32_t& value, tick deadline, error** error = nullptr) OS_NOEXCEPT;
+
     /**
      * @brief Waits for an event to be set from an ISR.
      *
@@ -141,6 +152,8 @@ public:
     void clear_from_isr(uint32_t value) OS_NOEXCEPT;
 
 private:
+    friend class queue_set;
+
     event_data e{};  ///< Internal data for the event.
 };
 
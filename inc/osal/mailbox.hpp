@@ -0,0 +1,119 @@
+/***************************************************************************
+ * 
+ * OSAL
+ * Copyright (C) 2023/2024 Antonio Salsi <passy.linux@zresa.it>
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>. 
+ * 
+ ***************************************************************************/
+#pragma once
+
+#include "osal/error.hpp"
+#include "osal_sys/osal_sys.hpp"
+
+#include <stdlib.h>
+
+namespace osal
+{
+inline namespace v1
+{
+
+/**
+ * @brief Holds the latest value of a message, for state that readers only sample.
+ *
+ * overwrite() replaces the stored value and never waits for readers; peek() copies the value
+ * without consuming it, so any number of readers see the newest one. On unix readers use a
+ * seqlock and never take a lock: a read that overlaps a write is retried. Writers are meant
+ * to be a single thread, concurrent writers serialize on a short spin. On FreeRTOS the
+ * mailbox is a one slot queue used with xQueueOverwrite()/xQueuePeek().
+ */
+class mailbox final
+{
+public:
+    /**
+     * @brief Constructor.
+     *
+     * @param message_size The size (in bytes) of the value.
+     * @param error Optional pointer to an error object to be populated in case of failure.
+     */
+    explicit mailbox(size_t message_size, error** error = nullptr) OS_NOEXCEPT;
+
+    mailbox(const mailbox&) = delete;
+
+    mailbox& operator=(const mailbox&) = delete;
+
+    mailbox(mailbox&&) = delete;
+
+    mailbox& operator=(mailbox&&) = delete;
+
+    /**
+     * @brief Destructor.
+     */
+    ~mailbox() OS_NOEXCEPT;
+
+    /**
+     * @brief Replaces the stored value, it never blocks.
+     *
+     * @param msg Pointer to the new value.
+     * @param error Optional pointer to an error object to be populated in case of failure.
+     * @return Exit status indicating the success or failure of the operation.
+     */
+    osal::exit overwrite (const uint8_t* msg, error** error = nullptr) OS_NOEXCEPT;
+
+    /**
+     * @brief Replaces the stored value from an interrupt service routine (ISR).
+     *
+     * @param msg Pointer to the new value.
+     * @param error Optional pointer to an error object to be populated in case of failure.
+     * @return Exit status indicating the success or failure of the operation.
+     */
+    osal::exit overwrite_from_isr (const uint8_t* msg, error** error = nullptr) OS_NOEXCEPT;
+
+    /**
+     * @brief Copies the latest value without consuming it.
+     *
+     * The caller is blocked only while nothing has been written yet, until the specified time has elapsed.
+     *
+     * @param msg Pointer to the buffer where the value will be stored.
+     * @param time The maximum time to wait for the first value (in milliseconds).
+     * @param error Optional pointer to an error object to be populated in case of failure.
+     * @return Exit status indicating the success or failure of the operation.
+     */
+    osal::exit peek (void* msg, uint64_t time, error** error = nullptr) OS_NOEXCEPT;
+
+    /**
+     * @brief Copies the latest value, waiting at most until an absolute deadline for the first write.
+     *
+     * @param msg Pointer to a buffer of message_size bytes.
+     * @param deadline Absolute tick (see osal::deadline) or WAIT_FOREVER.
+     * @param error Optional pointer to an error object to be populated in case of failure.
+     * @return OK if a value was copied, KO if nothing was written before the deadline.
+     */
+    osal::exit peek_until (void* msg, tick deadline, error** error = nullptr) OS_NOEXCEPT;
+
+    /**
+     * @brief Copies the latest value from an interrupt service routine (ISR).
+     *
+     * @param msg Pointer to the buffer where the value will be stored.
+     * @param time Unused, an ISR never waits.
+     * @param error Optional pointer to an error object to be populated in case of failure.
+     * @return Exit status indicating the success or failure of the operation.
+     */
+    osal::exit peek_from_isr (void* msg, uint64_t time, error** error = nullptr) OS_NOEXCEPT;
+
+private:
+    mailbox_data m{};   ///< Internal data for the mailbox.
+};
+
+}
+}
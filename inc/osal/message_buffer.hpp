@@ -0,0 +1,166 @@
+/***************************************************************************
+ * 
+ * OSAL
+ * Copyright (C) 2023/2024 Antonio Salsi <passy.linux@zresa.it>
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>. 
+ * 
+ ***************************************************************************/
+#pragma once
+
+#include "osal/error.hpp"
+#include "osal_sys/osal_sys.hpp"
+
+#include <stdlib.h>
+
+namespace osal
+{
+inline namespace v1
+{
+
+/**
+ * @brief Buffer of variable-length messages.
+ *
+ * Each message is stored as a length prefix followed by its payload, contiguously in one byte
+ * ring, so memory use tracks the actual message sizes. A message is delivered whole or not at
+ * all. On unix the ring is guarded by a mutex and any number of senders and receivers may use
+ * it; on FreeRTOS it is a native message buffer created with xMessageBufferCreate(), which
+ * expects a single sender and a single receiver at a time.
+ */
+class message_buffer final
+{
+public:
+    /**
+     * @brief Constructor.
+     *
+     * @param size The total size (in bytes) of the buffer, length prefixes included.
+     * @param error Optional pointer to an error object to be populated in case of failure.
+     */
+    explicit message_buffer(size_t size, error** error = nullptr) OS_NOEXCEPT;
+
+    message_buffer(const message_buffer&) = delete;
+
+    message_buffer& operator=(const message_buffer&) = delete;
+
+    message_buffer(message_buffer&&) = delete;
+
+    message_buffer& operator=(message_buffer&&) = delete;
+
+    /**
+     * @brief Destructor.
+     */
+    ~message_buffer() OS_NOEXCEPT;
+
+    /**
+     * @brief Sends a message.
+     *
+     * The caller is blocked until there is room for the whole message and its length prefix or until
+     * the specified time has elapsed. Empty messages are refused with OS_EINVAL: a received size
+     * of 0 always means that no message was received.
+     *
+     * @param data Pointer to the message.
+     * @param size The size (in bytes) of the message.
+     * @param time The maximum time to wait for room (in milliseconds).
+     * @param error Optional pointer to an error object to be populated in case of failure.
+     * @return `size` if the message was stored, 0 otherwise.
+     */
+    size_t send(const uint8_t* data, size_t size, uint64_t time, error** error = nullptr) OS_NOEXCEPT;
+
+    /**
+     * @brief Sends a message, waiting at most until an absolute deadline.
+     *
+     * @param data Pointer to the message.
+     * @param size The size (in bytes) of the message.
+     * @param deadline Absolute tick (see osal::deadline) or WAIT_FOREVER.
+     * @param error Optional pointer to an error object to be populated in case of failure.
+     * @return `size` if the message was stored, 0 otherwise.
+     */
+    size_t send_until(const uint8_t* data, size_t size, tick deadline, error** error = nullptr) OS_NOEXCEPT;
+
+    /**
+     * @brief Sends a message from an interrupt service routine (ISR), it never blocks.
+     *
+     * @param data Pointer to the message.
+     * @param size The size (in bytes) of the message.
+     * @param error Optional pointer to an error object to be populated in case of failure.
+     * @return `size` if the message was stored, 0 otherwise.
+     */
+    size_t send_from_isr(const uint8_t* data, size_t size, error** error = nullptr) OS_NOEXCEPT;
+
+    /**
+     * @brief Receives the oldest message.
+     *
+     * The caller is blocked until a message is available or until the specified time has elapsed.
+     * A message larger than `size` is left in the buffer and the call fails with OS_EMSGSIZE.
+     *
+     * @param data Pointer to the buffer where the message will be stored.
+     * @param size The size (in bytes) of the buffer.
+     * @param time The maximum time to wait for a message (in milliseconds).
+     * @param error Optional pointer to an error object to be populated in case of failure.
+     * @return The size of the message, 0 if none was received.
+     */
+    size_t receive(uint8_t* data, size_t size, uint64_t time, error** error = nullptr) OS_NOEXCEPT;
+
+    /**
+     * @brief Receives the oldest message, waiting at most until an absolute deadline.
+     *
+     * @param data Pointer to the buffer where the message will be stored.
+     * @param size The size (in bytes) of the buffer.
+     * @param deadline Absolute tick (see osal::deadline) or WAIT_FOREVER.
+     * @param error Optional pointer to an error object to be populated in case of failure.
+     * @return The size of the message, 0 if none was received.
+     */
+    size_t receive_until(uint8_t* data, size_t size, tick deadline, error** error = nullptr) OS_NOEXCEPT;
+
+    /**
+     * @brief Receives the oldest message from an interrupt service routine (ISR), it never blocks.
+     *
+     * @param data Pointer to the buffer where the message will be stored.
+     * @param size The size (in bytes) of the buffer.
+     * @param error Optional pointer to an error object to be populated in case of failure.
+     * @return The size of the message, 0 if none was received.
+     */
+    size_t receive_from_isr(uint8_t* data, size_t size, error** error = nullptr) OS_NOEXCEPT;
+
+    /**
+     * @brief Returns the size of the oldest message.
+     *
+     * @return The size (in bytes) of the next message to be received, 0 if the buffer is empty.
+     */
+    size_t next_size() const OS_NOEXCEPT;
+
+    /**
+     * @brief Discards all the stored messages.
+     */
+    void reset() OS_NOEXCEPT;
+
+    /**
+     * @brief Checks if the buffer holds no message.
+     *
+     * @return `true` if the buffer is empty, `false` otherwise.
+     */
+    bool is_empty() const OS_NOEXCEPT;
+
+    /**
+     * @brief Returns the number of free bytes, length prefixes included.
+     *
+     * @return The number of free bytes.
+     */
+    size_t bytes_free() const OS_NOEXCEPT;
+
+private:
+    mutable message_buffer_data mb{};
+};
+
+}
+}
@@ -29,10 +29,15 @@
 #include "osal/generics.hpp"
 #include "osal/iterator.hpp"
 #include "osal/log.hpp"
+#include "osal/mailbox.hpp"
 #include "osal/memory.hpp"
+#include "osal/message_buffer.hpp"
 #include "osal/mutex.hpp"
+#include "osal/priority_queue.hpp"
 #include "osal/queue.hpp"
+#include "osal/queue_set.hpp"
 #include "osal/semaphore.hpp"
+#include "osal/static_queue.hpp"
 #include "osal/streambuffer.hpp"
 #include "osal/string.hpp"
 #include "osal/thread.hpp"
@@ -96,6 +101,58 @@ constexpr inline uint64_t operator""_s( unsigned long long secs ) {  return sec_
   **/
 [[maybe_unused]] void tick_sleep(tick tick) OS_NOEXCEPT;
 
+/**
+ * @brief Absolute point in time on the tick clock.
+ *
+ * Every blocking call has a `*_until(tick deadline)` overload: a multi-step operation builds one
+ * deadline and passes it to each step, so retries do not extend the total wait and the clock is
+ * read once. A default constructed deadline never expires, like WAIT_FOREVER.
+ */
+class deadline final
+{
+public:
+    /**
+     * @brief Constructs a deadline that never expires.
+     */
+    constexpr deadline() OS_NOEXCEPT = default;
+
+    /**
+     * @brief Constructs a deadline at an absolute tick.
+     *
+     * @param at The tick, as returned by tick_current() plus an offset, or WAIT_FOREVER.
+     */
+    constexpr explicit deadline(tick at) OS_NOEXCEPT : at(at) {}
+
+    /**
+     * @brief Builds the deadline reached after a relative timeout.
+     *
+     * It matches the deadline the millisecond overloads compute: a zero timeout gives a deadline
+     * that has already expired, so the `*_until` call only tries once.
+     *
+     * @param time Timeout in milliseconds, WAIT_FOREVER for a deadline that never expires.
+     * @return The deadline.
+     */
+    static deadline from_ms(uint64_t time) OS_NOEXCEPT;
+
+    /**
+     * @brief Checks whether the deadline has passed.
+     *
+     * @return true once the tick clock has reached the deadline.
+     */
+    bool expired() const OS_NOEXCEPT;
+
+    /**
+     * @brief Return the absolute tick, to be passed to the `*_until` calls.
+     */
+    constexpr operator tick() const OS_NOEXCEPT
+    {
+        return at;
+    }
+
+private:
+    tick at = WAIT_FOREVER; ///< Absolute tick, WAIT_FOREVER when the deadline never expires.
+};
+
 /**
  * @brief Sets the main loop to sleep mode.
  *
@@ -0,0 +1,143 @@
+/***************************************************************************
+ * 
+ * OSAL
+ * Copyright (C) 2023/2024 Antonio Salsi <passy.linux@zresa.it>
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>. 
+ * 
+ ***************************************************************************/
+#pragma once
+
+#include "osal/error.hpp"
+#include "osal/mutex.hpp"
+#include "osal/semaphore.hpp"
+
+#include <stdlib.h>
+
+namespace osal
+{
+inline namespace v1
+{
+
+/**
+ * @brief Bounded queue that always delivers the most urgent message first.
+ *
+ * Every message is posted with a priority; fetch() returns the message with the highest
+ * priority and, among equal priorities, the oldest one. Messages are kept in one contiguous
+ * buffer like osal::queue, ordered by a binary heap of slot indices, so post() and fetch()
+ * cost O(log n) plus one copy of the message. It is built on osal::mutex and osal::semaphore
+ * and behaves the same on every backend; it must not be used from an ISR.
+ */
+class priority_queue final
+{
+public:
+    /**
+     * @brief Constructor.
+     *
+     * @param size The maximum number of messages that can be stored in the queue.
+     * @param message_size The size (in bytes) of each message in the queue.
+     * @param error Optional pointer to an error object to be populated in case of failure.
+     */
+    priority_queue(size_t size, size_t message_size, error** error = nullptr) OS_NOEXCEPT;
+
+    priority_queue(const priority_queue&) = delete;
+
+    priority_queue& operator=(const priority_queue&) = delete;
+
+    priority_queue(priority_queue&&) = delete;
+
+    priority_queue& operator=(priority_queue&&) = delete;
+
+    /**
+     * @brief Destructor.
+     */
+    ~priority_queue() OS_NOEXCEPT;
+
+    /**
+     * @brief Fetches the most urgent message from the queue.
+     *
+     * The caller is blocked until a message is available or until the specified time has elapsed.
+     *
+     * @param msg Pointer to the buffer where the fetched message will be stored.
+     * @param time The maximum time to wait for a message (in milliseconds).
+     * @param error Optional pointer to an error object to be populated in case of failure.
+     * @return Exit status indicating the success or failure of the fetch operation.
+     */
+    osal::exit fetch (void* msg, uint64_t time, error** error = nullptr) OS_NOEXCEPT;
+
+    /**
+     * @brief Fetches the most urgent message, waiting at most until an absolute deadline.
+     *
+     * @param msg Pointer to the buffer where the fetched message will be stored.
+     * @param deadline Absolute tick (see osal::deadline) or WAIT_FOREVER.
+     * @param error Optional pointer to an error object to be populated in case of failure.
+     * @return Exit status indicating the success or failure of the fetch operation.
+     */
+    osal::exit fetch_until (void* msg, tick deadline, error** error = nullptr) OS_NOEXCEPT;
+
+    /**
+     * @brief Posts a message to the queue.
+     *
+     * The caller is blocked until a slot is free or until the specified time has elapsed.
+     *
+     * @param msg Pointer to the message to be posted.
+     * @param priority Priority of the message, higher values are fetched first.
+     * @param time The maximum time to wait for a free slot (in milliseconds).
+     * @param error Optional pointer to an error object to be populated in case of failure.
+     * @return Exit status indicating the success or failure of the post operation.
+     */
+    osal::exit post (const uint8_t* msg, uint8_t priority, uint64_t time, error** error = nullptr) OS_NOEXCEPT;
+
+    /**
+     * @brief Posts a message, waiting at most until an absolute deadline for a free slot.
+     *
+     * @param msg Pointer to the message to be posted.
+     * @param priority Priority of the message, higher values are fetched first.
+     * @param deadline Absolute tick (see osal::deadline) or WAIT_FOREVER.
+     * @param error Optional pointer to an error object to be populated in case of failure.
+     * @return Exit status indicating the success or failure of the post operation.
+     */
+    osal::exit post_until (const uint8_t* msg, uint8_t priority, tick deadline, error** error = nullptr) OS_NOEXCEPT;
+
+    /**
+     * @brief Return size of element insert
+     *
+     * @return size of element insert
+     */
+    size_t size () const OS_NOEXCEPT;
+
+private:
+    /**
+     * @brief Heap node, it refers to the slot holding the payload.
+     */
+    struct entry
+    {
+        uint64_t sequence;  ///< Post order, breaks ties between equal priorities.
+        size_t slot;        ///< Index of the payload in msg.
+        uint8_t priority;   ///< Priority of the message.
+    };
+
+    mutable class mutex m;          ///< Guards heap, free_slots and count.
+    semaphore messages{0};          ///< Counts stored messages, waited by fetch().
+    semaphore slots;                ///< Counts free slots, waited by post().
+    size_t max_size = 0;            ///< Maximum number of messages.
+    size_t message_size = 0;        ///< Size of each message.
+    size_t count = 0;               ///< Number of stored messages.
+    uint64_t sequence = 0;          ///< Next post order number.
+    uint8_t* msg = nullptr;         ///< Contiguous payload storage, max_size * message_size bytes.
+    entry* heap = nullptr;          ///< Max-heap of the stored messages.
+    size_t* free_slots = nullptr;   ///< Stack of unused payload slots.
+};
+
+}
+}
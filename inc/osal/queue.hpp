@@ -29,6 +29,18 @@ namespace osal
 inline namespace v1
 {
 
+/**
+ * @brief Synchronisation strategy of a queue.
+ *
+ * The mode is fixed at construction. On FreeRTOS every mode maps to the native queue.
+ */
+enum class queue_mode : uint8_t
+{
+    LOCKED, ///< Mutex and condition variable, any number of producers and consumers.
+    SPSC,   ///< Lock-free ring for exactly one producer thread and one consumer thread.
+    MPMC,   ///< Lock-free bounded ring with per-slot sequence numbers, any number of producers and consumers.
+};
+
 /**
  * @brief Final class for queues.
  *
@@ -45,7 +57,24 @@ public:
      * @param message_size The size (in bytes) of each message in the queue.
      * @param error Optional pointer to an error object to be populated in case of failure.
      */
-    queue(size_t size, size_t message_size, error** error = nullptr) OS_NOEXCEPT;
+    queue(size_t size, size_t message_size, error** error = nullptr) OS_NOEXCEPT
+    : queue(size, message_size, queue_mode::LOCKED, error) {}
+
+    /**
+     * @brief Constructor with explicit synchronisation mode.
+     *
+     * With queue_mode::SPSC post() must be called by a single thread and fetch() by a single
+     * (possibly different) thread; in exchange neither side takes a lock and a futex syscall is
+     * issued only when the other side is actually sleeping.
+     * With queue_mode::MPMC producers and consumers claim slots with a compare-and-swap and
+     * only block when the queue is full or empty.
+     *
+     * @param size The maximum number of messages that can be stored in the queue.
+     * @param message_size The size (in bytes) of each message in the queue.
+     * @param mode The synchronisation mode.
+     * @param error Optional pointer to an error object to be populated in case of failure.
+     */
+    queue(size_t size, size_t message_size, queue_mode mode, error** error = nullptr) OS_NOEXCEPT;
 
     /**
      * @brief Deleted copy constructor.
@@ -85,6 +114,16 @@ public:
      */
     osal::exit fetch (void* msg, uint64_t time, error** error = nullptr) OS_NOEXCEPT;
 
+    /**
+     * @brief Fetches a message from the queue, waiting at most until an absolute deadline.
+     *
+     * @param msg Pointer to the buffer where the fetched message will be stored.
+     * @param deadline Absolute tick (see osal::deadline) or WAIT_FOREVER.
+     * @param error Optional pointer to an error object to be populated in case of failure.
+     * @return Exit status indicating the success or failure of the fetch operation.
+     */
+    osal::exit fetch_until (void* msg, tick deadline, error** error = nullptr) OS_NOEXCEPT;
+
     /**
      * @brief Fetches a message from the queue from an ISR.
      *
@@ -111,6 +150,16 @@ public:
      */
     osal::exit post (const uint8_t* msg, uint64_t time, error** error = nullptr) OS_NOEXCEPT;
 
+    /**
+     * @brief Posts a message to the queue, waiting at most until an absolute deadline.
+     *
+     * @param msg Pointer to the message to be posted.
+     * @param deadline Absolute tick (see osal::deadline) or WAIT_FOREVER.
+     * @param error Optional pointer to an error object to be populated in case of failure.
+     * @return Exit status indicating the success or failure of the post operation.
+     */
+    osal::exit post_until (const uint8_t* msg, tick deadline, error** error = nullptr) OS_NOEXCEPT;
+
     /**
      * @brief Posts a message to the queue from an ISR.
      *
@@ -124,6 +173,132 @@ public:
      */
     osal::exit post_from_isr (const uint8_t* msg, uint64_t time, error** error = nullptr) OS_NOEXCEPT;
 
+    /**
+     * @brief Fetches up to `max` messages with a single blocking wait.
+     *
+     * The caller is blocked until at least one message is available or until the specified time has
+     * elapsed, then every available message up to `max` is moved into `msg` under one lock, with at
+     * most two copies across the ring wrap and a single wake-up of the producers.
+     *
+     * @param msg Pointer to a buffer of at least `max` messages.
+     * @param max The maximum number of messages to fetch.
+     * @param got Set to the number of messages fetched.
+     * @param time The maximum time to wait for the first message (in milliseconds).
+     * @param error Optional pointer to an error object to be populated in case of failure.
+     * @return OK if at least one message was fetched, KO if the fetch timed out or encountered an error.
+     */
+    osal::exit fetch_bulk (void* msg, size_t max, size_t& got, uint64_t time, error** error = nullptr) OS_NOEXCEPT;
+
+    /**
+     * @brief fetch_bulk() waiting at most until an absolute deadline.
+     *
+     * @param msg Pointer to a buffer of at least `max * message_size` bytes.
+     * @param max The maximum number of messages to fetch.
+     * @param got Number of messages copied into `msg`.
+     * @param deadline Absolute tick (see osal::deadline) or WAIT_FOREVER.
+     * @param error Optional pointer to an error object to be populated in case of failure.
+     * @return OK if at least one message was fetched, KO otherwise.
+     */
+    osal::exit fetch_bulk_until (void* msg, size_t max, size_t& got, tick deadline, error** error = nullptr) OS_NOEXCEPT;
+
+    /**
+     * @brief Posts up to `count` messages with a single blocking wait.
+     *
+     * The caller is blocked until at least one slot is free or until the specified time has elapsed,
+     * then as many messages as fit are posted under one lock, with at most two copies across the
+     * ring wrap and a single wake-up of the consumers.
+     *
+     * @param msg Pointer to `count` contiguous messages.
+     * @param count The number of messages to post.
+     * @param time The maximum time to wait for the first free slot (in milliseconds).
+     * @param error Optional pointer to an error object to be populated in case of failure.
+     * @return The number of messages posted, 0 on timeout or error.
+     */
+    size_t post_bulk (const uint8_t* msg, size_t count, uint64_t time, error** error = nullptr) OS_NOEXCEPT;
+
+    /**
+     * @brief post_bulk() waiting at most until an absolute deadline.
+     *
+     * @param msg Pointer to `count` contiguous messages.
+     * @param count The number of messages to post.
+     * @param deadline Absolute tick (see osal::deadline) or WAIT_FOREVER.
+     * @param error Optional pointer to an error object to be populated in case of failure.
+     * @return The number of messages posted.
+     */
+    size_t post_bulk_until (const uint8_t* msg, size_t count, tick deadline, error** error = nullptr) OS_NOEXCEPT;
+
+    /**
+     * @brief Reserves the next free slot of the queue for in-place writing.
+     *
+     * The caller is blocked until a slot is free or until the specified time has elapsed. The returned
+     * pointer addresses `message_size` bytes inside the ring: fill it and hand it back with commit().
+     * With queue_mode::LOCKED only one reservation at a time is granted, other producers wait for
+     * its commit. On FreeRTOS the slot is a per-queue staging buffer copied once by commit(), which
+     * also performs the wait: a second reserve() before the commit fails at once with OS_EBUSY
+     * instead of waiting, and a commit() that times out gives the slot back and drops the message.
+     *
+     * @param time The maximum time to wait for a free slot (in milliseconds).
+     * @param error Optional pointer to an error object to be populated in case of failure.
+     * @return Pointer to the slot, nullptr if the wait timed out or encountered an error.
+     */
+    uint8_t* reserve (uint64_t time, error** error = nullptr) OS_NOEXCEPT;
+
+    /**
+     * @brief reserve() waiting at most until an absolute deadline.
+     *
+     * @param deadline Absolute tick (see osal::deadline) or WAIT_FOREVER.
+     * @param error Optional pointer to an error object to be populated in case of failure.
+     * @return Pointer to the slot, nullptr if the wait timed out or encountered an error.
+     */
+    uint8_t* reserve_until (tick deadline, error** error = nullptr) OS_NOEXCEPT;
+
+    /**
+     * @brief Publishes a slot obtained from reserve() to the consumers.
+     *
+     * Each reservation is committed once, a second commit() of the same slot fails with OS_EINVAL.
+     * With queue_mode::MPMC the slot is recognised by its address: the commit of a slot reserved by
+     * another producer is accepted as if it were its own.
+     *
+     * @param slot The pointer returned by reserve().
+     * @param error Optional pointer to an error object to be populated in case of failure.
+     * @return OK if the message was published, KO if `slot` is not the reserved slot.
+     */
+    osal::exit commit (uint8_t* slot, error** error = nullptr) OS_NOEXCEPT;
+
+    /**
+     * @brief Acquires the oldest message of the queue for in-place reading.
+     *
+     * The caller is blocked until a message is available or until the specified time has elapsed.
+     * The returned pointer stays valid until release(), which frees the slot for the producers.
+     * On FreeRTOS the message is received into a per-queue staging buffer: a second acquire()
+     * before the release fails at once with OS_EBUSY instead of waiting.
+     *
+     * @param time The maximum time to wait for a message (in milliseconds).
+     * @param error Optional pointer to an error object to be populated in case of failure.
+     * @return Pointer to the message, nullptr if the wait timed out or encountered an error.
+     */
+    const uint8_t* acquire (uint64_t time, error** error = nullptr) OS_NOEXCEPT;
+
+    /**
+     * @brief acquire() waiting at most until an absolute deadline.
+     *
+     * @param deadline Absolute tick (see osal::deadline) or WAIT_FOREVER.
+     * @param error Optional pointer to an error object to be populated in case of failure.
+     * @return Pointer to the message, nullptr if the wait timed out or encountered an error.
+     */
+    const uint8_t* acquire_until (tick deadline, error** error = nullptr) OS_NOEXCEPT;
+
+    /**
+     * @brief Gives back a slot obtained from acquire().
+     *
+     * Each acquisition is released once, a second release() of the same slot fails with OS_EINVAL.
+     *
+     * @param slot The pointer returned by acquire().
+     * @param error Optional pointer to an error object to be populated in case of failure.
+     * @return OK if the slot was released, KO if `slot` is not the acquired slot.
+     */
+    osal::exit release (const uint8_t* slot, error** error = nullptr) OS_NOEXCEPT;
+
     /**
      * @brief Return size of element insert
      * @return number of element
@@ -131,7 +306,10 @@ public:
     size_t size () const OS_NOEXCEPT;
 
 private:
-    queue_data q{}; ///< Internal data for the queue.
+    friend class queue_set;
+
+    queue_mode mode;  ///< Synchronisation mode chosen at construction.
+    mutable queue_data q{}; ///< Internal data for the queue, locked by the const size() in queue_mode::LOCKED.
 };
 
 }
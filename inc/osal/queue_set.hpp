@@ -0,0 +1,151 @@
+/***************************************************************************
+ * 
+ * OSAL
+ * Copyright (C) 2023/2024 Antonio Salsi <passy.linux@zresa.it>
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>. 
+ * 
+ ***************************************************************************/
+#pragma once
+
+#include "osal/error.hpp"
+#include "osal_sys/osal_sys.hpp"
+
+#include <stdlib.h>
+
+namespace osal
+{
+inline namespace v1
+{
+
+class queue;
+class semaphore;
+class event;
+
+/**
+ * @brief Waits on several queues, semaphores and events with one call.
+ *
+ * Members notify the set when they become ready, so select() sleeps until the first of them
+ * has something to deliver; the caller then takes it with a zero timeout fetch() or wait().
+ * On FreeRTOS the set maps to xQueueCreateSet()/xQueueSelectFromSet(), which requires
+ * configUSE_QUEUE_SETS, members that are empty when added and does not accept events.
+ * Members may be added and removed while other threads post to them, but a set must not be
+ * destroyed while its members are still being posted to: a post that started before remove()
+ * may still notify the set.
+ */
+class queue_set final
+{
+public:
+    /**
+     * @brief Constructor.
+     *
+     * @param size The maximum number of items that can be ready at once, that is the sum of
+     *             the capacities of the members; it also bounds the number of members.
+     * @param error Optional pointer to an error object to be populated in case of failure.
+     */
+    explicit queue_set(size_t size, error** error = nullptr) OS_NOEXCEPT;
+
+    queue_set(const queue_set&) = delete;
+
+    queue_set& operator=(const queue_set&) = delete;
+
+    queue_set(queue_set&&) = delete;
+
+    queue_set& operator=(queue_set&&) = delete;
+
+    /**
+     * @brief Destructor, it detaches every member.
+     */
+    ~queue_set() OS_NOEXCEPT;
+
+    /**
+     * @brief Adds a queue, it is ready while it holds at least one message.
+     *
+     * @param q The queue, it can belong to one set at a time.
+     * @param error Optional pointer to an error object to be populated in case of failure.
+     * @return Exit status indicating the success or failure of the operation.
+     */
+    osal::exit add(class queue& q, error** error = nullptr) OS_NOEXCEPT;
+
+    /**
+     * @brief Adds a semaphore, it is ready while its count is not zero.
+     *
+     * @param sem The semaphore, it can belong to one set at a time.
+     * @param error Optional pointer to an error object to be populated in case of failure.
+     * @return Exit status indicating the success or failure of the operation.
+     */
+    osal::exit add(class semaphore& sem, error** error = nullptr) OS_NOEXCEPT;
+
+    /**
+     * @brief Adds an event, it is ready while one of the bits in mask is set.
+     *
+     * Not supported on FreeRTOS.
+     *
+     * @param ev The event, it can belong to one set at a time.
+     * @param mask The bits that make the event ready.
+     * @param error Optional pointer to an error object to be populated in case of failure.
+     * @return Exit status indicating the success or failure of the operation.
+     */
+    osal::exit add(class event& ev, uint32_t mask, error** error = nullptr) OS_NOEXCEPT;
+
+    /**
+     * @brief Removes a queue from the set.
+     *
+     * @param q The queue.
+     * @param error Optional pointer to an error object to be populated in case of failure.
+     * @return Exit status indicating the success or failure of the operation.
+     */
+    osal::exit remove(class queue& q, error** error = nullptr) OS_NOEXCEPT;
+
+    /**
+     * @brief Removes a semaphore from the set.
+     *
+     * @param sem The semaphore.
+     * @param error Optional pointer to an error object to be populated in case of failure.
+     * @return Exit status indicating the success or failure of the operation.
+     */
+    osal::exit remove(class semaphore& sem, error** error = nullptr) OS_NOEXCEPT;
+
+    /**
+     * @brief Removes an event from the set.
+     *
+     * @param ev The event.
+     * @param error Optional pointer to an error object to be populated in case of failure.
+     * @return Exit status indicating the success or failure of the operation.
+     */
+    osal::exit remove(class event& ev, error** error = nullptr) OS_NOEXCEPT;
+
+    /**
+     * @brief Blocks until a member is ready or until the specified time has elapsed.
+     *
+     * @param time The maximum time to wait (in milliseconds).
+     * @param error Optional pointer to an error object to be populated in case of failure.
+     * @return The address of the ready queue, semaphore or event, nullptr on timeout.
+     */
+    void* select(uint64_t time, error** error = nullptr) OS_NOEXCEPT;
+
+    /**
+     * @brief Waits until a member becomes ready or an absolute deadline passes.
+     *
+     * @param deadline Absolute tick (see osal::deadline) or WAIT_FOREVER.
+     * @param error Optional pointer to an error object to be populated in case of failure.
+     * @return The ready member, nullptr if the deadline passed.
+     */
+    void* select_until(tick deadline, error** error = nullptr) OS_NOEXCEPT;
+
+private:
+    queue_set_data s{}; ///< Internal data for the queue set.
+};
+
+}
+}
@@ -82,6 +82,17 @@ public:
      */
     osal::exit wait(uint64_t time, error** error = nullptr) OS_NOEXCEPT;
 
+    /**
+     * @brief Waits for the semaphore to become available until an absolute deadline.
+     *
+     * A deadline already in the past turns the call into a non-blocking try.
+     *
+     * @param deadline Absolute tick (see osal::deadline) or WAIT_FOREVER.
+     * @param error Optional pointer to an error object to be populated in case of failure.
+     * @return OK if the semaphore became available, KO if the wait timed out or encountered an error.
+     */
+    osal::exit wait_until(tick deadline, error** error = nullptr) OS_NOEXCEPT;
+
     /**
      * @brief Waits for the semaphore to become available from an ISR.
      *
@@ -110,6 +121,8 @@ public:
     void signal_from_isr() OS_NOEXCEPT;
 
 private:
+    friend class queue_set;
+
     semaphore_data sem{}; ///< Internal data for the semaphore.
 };
 
@@ -0,0 +1,159 @@
+/***************************************************************************
+ * 
+ * OSAL
+ * Copyright (C) 2023/2024 Antonio Salsi <passy.linux@zresa.it>
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>. 
+ * 
+ ***************************************************************************/
+#pragma once
+
+#include "osal/error.hpp"
+#include "osal_sys/osal_sys.hpp"
+
+#include <stdlib.h>
+#include <type_traits>
+
+namespace osal
+{
+inline namespace v1
+{
+
+/**
+ * @brief Fixed capacity queue of typed messages with embedded storage.
+ *
+ * Unlike osal::queue the ring lives inside the object and the message type is known at compile
+ * time: nothing is allocated on the heap and every copy has the constant size of T. The
+ * constructor is constexpr, so a global instance is constant-initialized and ready before
+ * any constructor runs. The platform objects are set up on first use: on unix the mutex and
+ * conditions, kept in an opaque block, on FreeRTOS the native queue, created with
+ * xQueueCreateStatic().
+ *
+ * @tparam T Message type, it must be trivially copyable.
+ * @tparam N Maximum number of messages that can be stored in the queue.
+ */
+template<typename T, size_t N>
+class static_queue final
+{
+    static_assert(std::is_trivially_copyable_v<T>, "static_queue messages must be trivially copyable");
+    static_assert(N > 0, "static_queue capacity must be greater than zero");
+
+public:
+    /**
+     * @brief Constructor, it neither allocates nor calls into the OS.
+     */
+    constexpr static_queue() OS_NOEXCEPT = default;
+
+    static_queue(const static_queue&) = delete;
+
+    static_queue& operator=(const static_queue&) = delete;
+
+    static_queue(static_queue&&) = delete;
+
+    static_queue& operator=(static_queue&&) = delete;
+
+    /**
+     * @brief Destructor.
+     */
+    ~static_queue() OS_NOEXCEPT;
+
+    /**
+     * @brief Fetches a message from the queue.
+     *
+     * The caller is blocked until a message is available or until the specified time has elapsed.
+     *
+     * @param msg The fetched message.
+     * @param time The maximum time to wait for a message (in milliseconds).
+     * @param error Optional pointer to an error object to be populated in case of failure.
+     * @return Exit status indicating the success or failure of the fetch operation.
+     */
+    osal::exit fetch (T& msg, uint64_t time, error** error = nullptr) OS_NOEXCEPT;
+
+    /**
+     * @brief Fetches a message from the queue, waiting at most until an absolute deadline.
+     *
+     * @param msg The fetched message.
+     * @param deadline Absolute tick (see osal::deadline) or WAIT_FOREVER.
+     * @param error Optional pointer to an error object to be populated in case of failure.
+     * @return Exit status indicating the success or failure of the fetch operation.
+     */
+    osal::exit fetch_until (T& msg, tick deadline, error** error = nullptr) OS_NOEXCEPT;
+
+    /**
+     * @brief Fetches a message from the queue in an interrupt service routine (ISR).
+     *
+     * @param msg The fetched message.
+     * @param time The maximum time to wait for a message (in milliseconds).
+     * @param error Optional pointer to an error object to be populated in case of failure.
+     * @return Exit status indicating the success or failure of the fetch operation.
+     */
+    osal::exit fetch_from_isr (T& msg, uint64_t time, error** error = nullptr) OS_NOEXCEPT;
+
+    /**
+     * @brief Posts a message to the queue.
+     *
+     * The caller is blocked until a slot is free or until the specified time has elapsed.
+     *
+     * @param msg The message to be posted.
+     * @param time The maximum time to wait for a free slot (in milliseconds).
+     * @param error Optional pointer to an error object to be populated in case of failure.
+     * @return Exit status indicating the success or failure of the post operation.
+     */
+    osal::exit post (const T& msg, uint64_t time, error** error = nullptr) OS_NOEXCEPT;
+
+    /**
+     * @brief Posts a message to the queue, waiting at most until an absolute deadline.
+     *
+     * @param msg The message to be posted.
+     * @param deadline Absolute tick (see osal::deadline) or WAIT_FOREVER.
+     * @param error Optional pointer to an error object to be populated in case of failure.
+     * @return Exit status indicating the success or failure of the post operation.
+     */
+    osal::exit post_until (const T& msg, tick deadline, error** error = nullptr) OS_NOEXCEPT;
+
+    /**
+     * @brief Posts a message to the queue from an interrupt service routine (ISR).
+     *
+     * @param msg The message to be posted.
+     * @param time The maximum time to wait for a free slot (in milliseconds).
+     * @param error Optional pointer to an error object to be populated in case of failure.
+     * @return Exit status indicating the success or failure of the post operation.
+     */
+    osal::exit post_from_isr (const T& msg, uint64_t time, error** error = nullptr) OS_NOEXCEPT;
+
+    /**
+     * @brief Return size of element insert
+     *
+     * @return size of element insert
+     */
+    size_t size () const OS_NOEXCEPT;
+
+    /**
+     * @brief Return the maximum number of messages.
+     *
+     * @return N
+     */
+    static constexpr size_t capacity () OS_NOEXCEPT
+    {
+        return N;
+    }
+
+private:
+    mutable static_queue_data q{};              ///< Internal data for the queue.
+    alignas(T) uint8_t buffer[N * sizeof(T)]{}; ///< Embedded message storage.
+};
+
+}
+}
+
+#include "osal_sys/static_queue.hpp"
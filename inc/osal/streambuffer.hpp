@@ -29,11 +29,32 @@ namespace osal
 inline namespace v1
 {
 
+/**
+ * @brief Contiguous region of a stream buffer storage.
+ */
+struct span
+{
+    uint8_t* data = nullptr;    ///< First byte of the region.
+    size_t size = 0;            ///< Number of bytes in the region.
+};
+
+/**
+ * @brief Storage layout of a stream buffer.
+ *
+ * The layout is fixed at construction. On FreeRTOS every layout maps to the native stream buffer.
+ */
+enum class stream_buffer_mode : uint8_t
+{
+    RING,       ///< Heap storage, regions wrap at the end of the storage.
+    MIRRORED,   ///< Storage pages mapped twice back to back (Linux memfd), every region is contiguous.
+};
+
 /**
 * @brief Class for stream buffers.
 *
 * This class provides a stream buffer implementation.
-* It is meant to be used for sending and receiving data in a stream-like manner.
+* It is meant to be used for sending and receiving data in a stream-like manner,
+* by one writer and one reader at a time.
 */
 class stream_buffer
 {
@@ -46,7 +67,22 @@ public:
      * @param trigger_size The minimum number of bytes required to trigger sending or receiving.
      * @param _error Optional pointer to an error object to be populated in case of failure.
      */
-    stream_buffer(size_t size, size_t trigger_size, error** _error = nullptr) OS_NOEXCEPT;
+    stream_buffer(size_t size, size_t trigger_size, error** _error = nullptr) OS_NOEXCEPT
+    : stream_buffer(size, trigger_size, stream_buffer_mode::RING, _error) {}
+
+    /**
+     * @brief Constructor with explicit storage layout.
+     *
+     * With stream_buffer_mode::MIRRORED the storage is rounded up to whole pages and mapped twice,
+     * back to back, so the bytes past its end alias its start: acquire_write() and acquire_read()
+     * always return a single region and decoders can run over the ring without reassembly.
+     *
+     * @param size The total size (in bytes) of the stream buffer.
+     * @param trigger_size The minimum number of bytes required to trigger sending or receiving.
+     * @param mode The storage layout.
+     * @param _error Optional pointer to an error object to be populated in case of failure.
+     */
+    stream_buffer(size_t size, size_t trigger_size, stream_buffer_mode mode, error** _error = nullptr) OS_NOEXCEPT;
 
     /**
      * @brief Deleted copy constructor.
@@ -77,15 +113,28 @@ public:
      * @brief Sends data to the stream buffer.
      *
      * This function sends the specified data to the stream buffer.
-     * It blocks the caller until all the data is sent or until the specified time has elapsed.
+     * It blocks the caller until all the data is sent or until the specified time has elapsed,
+     * whatever fits is written meanwhile and the caller sleeps while the buffer is full, so a
+     * slow consumer throttles the producer instead of losing data.
      *
      * @param data Pointer to the data to be sent.
      * @param size The size (in bytes) of the data to be sent.
      * @param time The maximum time to wait for sending the data (in milliseconds).
+     * @param error Optional pointer to an error object, set to OS_ETIMEDOUT only if nothing was sent.
+     * @return The number of bytes sent, less than size when the time elapsed first.
+     */
+    size_t send(const uint8_t* data, size_t size, uint64_t time, error** error = nullptr) OS_NOEXCEPT;
+
+    /**
+     * @brief Sends data to the stream buffer, waiting at most until an absolute deadline.
+     *
+     * @param data Pointer to the data to be sent.
+     * @param size The size (in bytes) of the data to be sent.
+     * @param deadline Absolute tick (see osal::deadline) or WAIT_FOREVER.
      * @param error Optional pointer to an error object to be populated in case of failure.
      * @return The number of bytes sent.
      */
-    size_t send(const uint8_t* data, size_t size, uint64_t time, error** error = nullptr) OS_NOEXCEPT;
+    size_t send_until(const uint8_t* data, size_t size, tick deadline, error** error = nullptr) OS_NOEXCEPT;
 
     /**
      * @brief Sends data to the stream buffer from an ISR.
@@ -115,6 +164,45 @@ public:
      */
     size_t receive(uint8_t* data, size_t size, uint64_t time, error** error = nullptr) OS_NOEXCEPT;
 
+    /**
+     * @brief Receives data from the stream buffer, waiting at most until an absolute deadline.
+     *
+     * @param data Pointer to the buffer where the received data will be stored.
+     * @param size The size (in bytes) of the buffer.
+     * @param deadline Absolute tick (see osal::deadline) or WAIT_FOREVER.
+     * @param error Optional pointer to an error object to be populated in case of failure.
+     * @return The number of bytes received.
+     */
+    size_t receive_until(uint8_t* data, size_t size, tick deadline, error** error = nullptr) OS_NOEXCEPT;
+
+    /**
+     * @brief Receives data once at least a given amount is stored, regardless of the trigger level.
+     *
+     * Lets a latency-sensitive consumer wake for a few bytes, e.g. receive_at_least(buf, n, 1, 2),
+     * while other calls keep batching on the trigger level. On FreeRTOS the trigger level is
+     * lowered for the duration of the call.
+     *
+     * @param data Pointer to the buffer where the received data will be stored.
+     * @param size The size (in bytes) of the buffer.
+     * @param min_size Bytes to wait for, clamped to size and to the capacity; 0 uses the trigger level.
+     * @param time The maximum time to wait for receiving the data (in milliseconds).
+     * @param error Optional pointer to an error object to be populated in case of failure.
+     * @return The number of bytes received.
+     */
+    size_t receive_at_least(uint8_t* data, size_t size, size_t min_size, uint64_t time, error** error = nullptr) OS_NOEXCEPT;
+
+    /**
+     * @brief Same as receive_at_least(), waiting at most until an absolute deadline.
+     *
+     * @param data Pointer to the buffer where the received data will be stored.
+     * @param size The size (in bytes) of the buffer.
+     * @param min_size Bytes to wait for, clamped to size and to the capacity; 0 uses the trigger level.
+     * @param deadline Absolute tick (see osal::deadline) or WAIT_FOREVER.
+     * @param error Optional pointer to an error object to be populated in case of failure.
+     * @return The number of bytes received.
+     */
+    size_t receive_at_least_until(uint8_t* data, size_t size, size_t min_size, tick deadline, error** error = nullptr) OS_NOEXCEPT;
+
     /**
      * @brief Receives data from the stream buffer from an ISR.
      *
@@ -129,6 +217,150 @@ public:
      */
     size_t receive_from_isr(uint8_t* data, size_t size, uint64_t time, error** error = nullptr) OS_NOEXCEPT;
 
+    /**
+     * @brief Exposes the free space of the stream buffer for in-place writing.
+     *
+     * The caller is blocked until at least one byte is free or until the specified time has elapsed.
+     * The free space may wrap around the end of the storage, so it is described by two regions, the
+     * second one is empty when it does not. Fill any prefix of regions[0] followed by regions[1],
+     * then publish it with commit_write().
+     *
+     * @param regions Filled with the free regions, in write order.
+     * @param time The maximum time to wait for free space (in milliseconds).
+     * @param error Optional pointer to an error object to be populated in case of failure.
+     * @return The total number of free bytes, 0 if the wait timed out or encountered an error.
+     */
+    size_t acquire_write(span (&regions)[2], uint64_t time, error** error = nullptr) OS_NOEXCEPT;
+
+    /**
+     * @brief Same as acquire_write(), waiting at most until an absolute deadline.
+     *
+     * @param regions Filled with the free regions, in write order.
+     * @param deadline Absolute tick (see osal::deadline) or WAIT_FOREVER.
+     * @param error Optional pointer to an error object to be populated in case of failure.
+     * @return The total number of free bytes, 0 if the wait timed out or encountered an error.
+     */
+    size_t acquire_write_until(span (&regions)[2], tick deadline, error** error = nullptr) OS_NOEXCEPT;
+
+    /**
+     * @brief Publishes bytes written in place after acquire_write().
+     *
+     * @param size Number of bytes written, at most the total returned by acquire_write().
+     * @param error Optional pointer to an error object to be populated in case of failure.
+     * @return OK if the bytes were published, KO otherwise.
+     */
+    osal::exit commit_write(size_t size, error** error = nullptr) OS_NOEXCEPT;
+
+    /**
+     * @brief Exposes the stored data of the stream buffer for in-place reading.
+     *
+     * The caller is blocked until the trigger size is reached or until the specified time has elapsed.
+     * The data may wrap around the end of the storage, so it is described by two regions, the second
+     * one is empty when it does not. Release what was consumed with commit_read().
+     *
+     * @param regions Filled with the stored regions, in read order.
+     * @param time The maximum time to wait for data (in milliseconds).
+     * @param error Optional pointer to an error object to be populated in case of failure.
+     * @return The total number of stored bytes, 0 if the wait timed out or encountered an error.
+     */
+    size_t acquire_read(span (&regions)[2], uint64_t time, error** error = nullptr) OS_NOEXCEPT;
+
+    /**
+     * @brief Same as acquire_read(), waiting at most until an absolute deadline.
+     *
+     * @param regions Filled with the stored regions, in read order.
+     * @param deadline Absolute tick (see osal::deadline) or WAIT_FOREVER.
+     * @param error Optional pointer to an error object to be populated in case of failure.
+     * @return The total number of stored bytes, 0 if the wait timed out or encountered an error.
+     */
+    size_t acquire_read_until(span (&regions)[2], tick deadline, error** error = nullptr) OS_NOEXCEPT;
+
+    /**
+     * @brief Releases bytes consumed in place after acquire_read().
+     *
+     * @param size Number of bytes consumed, at most the total returned by acquire_read().
+     * @param error Optional pointer to an error object to be populated in case of failure.
+     * @return OK if the bytes were released, KO otherwise.
+     */
+    osal::exit commit_read(size_t size, error** error = nullptr) OS_NOEXCEPT;
+
+    /**
+     * @brief Reads from a file descriptor straight into the stream buffer.
+     *
+     * The caller is blocked until at least one byte is free or until the specified time has elapsed,
+     * then a single readv() fills the free regions, at most `max` bytes. The descriptor keeps its own
+     * blocking mode. Only available on unix, elsewhere the call fails with OS_EOPNOTSUPP.
+     *
+     * @param fd The file descriptor to read from.
+     * @param max The maximum number of bytes to transfer.
+     * @param time The maximum time to wait for free space (in milliseconds).
+     * @param error Optional pointer to an error object to be populated in case of failure.
+     * @return The number of bytes transferred, 0 on timeout, error or end of file.
+     */
+    size_t send_from_fd(int fd, size_t max, uint64_t time, error** error = nullptr) OS_NOEXCEPT;
+
+    /**
+     * @brief Same as send_from_fd(), waiting at most until an absolute deadline.
+     *
+     * @param fd The file descriptor to read from.
+     * @param max The maximum number of bytes to transfer.
+     * @param deadline Absolute tick (see osal::deadline) or WAIT_FOREVER.
+     * @param error Optional pointer to an error object to be populated in case of failure.
+     * @return The number of bytes transferred, 0 on timeout, error or end of file.
+     */
+    size_t send_from_fd_until(int fd, size_t max, tick deadline, error** error = nullptr) OS_NOEXCEPT;
+
+    /**
+     * @brief Writes the stream buffer content straight to a file descriptor.
+     *
+     * The caller is blocked until the trigger size is reached or until the specified time has elapsed,
+     * then a single writev() drains the stored regions, at most `max` bytes; only the bytes accepted
+     * by the descriptor are consumed. Only available on unix, elsewhere the call fails with OS_EOPNOTSUPP.
+     *
+     * @param fd The file descriptor to write to.
+     * @param max The maximum number of bytes to transfer.
+     * @param time The maximum time to wait for data (in milliseconds).
+     * @param error Optional pointer to an error object to be populated in case of failure.
+     * @return The number of bytes transferred, 0 on timeout or error.
+     */
+    size_t receive_to_fd(int fd, size_t max, uint64_t time, error** error = nullptr) OS_NOEXCEPT;
+
+    /**
+     * @brief Same as receive_to_fd(), waiting at most until an absolute deadline.
+     *
+     * @param fd The file descriptor to write to.
+     * @param max The maximum number of bytes to transfer.
+     * @param deadline Absolute tick (see osal::deadline) or WAIT_FOREVER.
+     * @param error Optional pointer to an error object to be populated in case of failure.
+     * @return The number of bytes transferred, 0 on timeout or error.
+     */
+    size_t receive_to_fd_until(int fd, size_t max, tick deadline, error** error = nullptr) OS_NOEXCEPT;
+
+    /**
+     * @brief Changes the number of stored bytes that unblocks receive(), like xStreamBufferSetTriggerLevel().
+     *
+     * A reader already waiting re-evaluates the new level.
+     *
+     * @param trigger_size The new trigger level, at most the buffer size.
+     * @param error Optional pointer to an error object to be populated in case of failure.
+     * @return osal::exit::OK on success, osal::exit::KO if the level exceeds the buffer size.
+     */
+    osal::exit set_trigger_level(size_t trigger_size, error** error = nullptr) OS_NOEXCEPT;
+
+    /**
+     * @brief Returns a descriptor that becomes readable when the trigger level is reached.
+     *
+     * The eventfd is created on the first call, non-blocking, and owned by the stream buffer. It is
+     * signalled once, when the stored bytes reach the trigger level, and re-armed by every receive,
+     * so a poll()/epoll consumer reads the descriptor and then drains with a zero timeout until
+     * receive() returns 0. Call it from the reader; concurrent first calls share one descriptor.
+     * Only available on unix, elsewhere the call fails with OS_EOPNOTSUPP.
+     *
+     * @param error Optional pointer to an error object to be populated in case of failure.
+     * @return The descriptor, -1 on failure.
+     */
+    int get_event_fd(error** error = nullptr) OS_NOEXCEPT;
+
     /**
      * @brief Resets the stream buffer.
      *
@@ -22,6 +22,8 @@
 #include "osal/error.hpp"
 #include "osal_sys/osal_sys.hpp"
 
+#include <atomic>
+#include <stddef.h>
 #include <stdint.h>
 
 namespace osal
@@ -29,11 +31,179 @@ namespace osal
 inline namespace v1
 {
 
+/**
+ * @brief What a periodic timer does with the expirations missed while its handler ran late.
+ */
+enum class timer_policy : uint8_t
+{
+    SKIP,       ///< Run the handler once and resume on the next point of the schedule, overrun() tells how many were missed.
+    CATCH_UP,   ///< Run the handler back to back for every missed expiration, overrun() tells how many are still due.
+};
+
+/**
+ * @brief Where the handler of a timer runs.
+ */
+enum class timer_dispatch : uint8_t
+{
+    INLINE,     ///< On the timer service thread, a slow handler delays the other expirations.
+    POOL,       ///< On a shared pool of worker threads, calls of one timer never overlap.
+};
+
+/**
+ * @brief Counters of the timer service, summed over its threads.
+ *
+ * Expirations that share a wakeup thanks to their slack (see timer::set_slack()) count as saved
+ * wakeups: saved_wakeups is expirations minus the wakeups that served at least one of them.
+ */
+struct timer_service_stats
+{
+    uint64_t wakeups = 0;           ///< Times the service woke up, cascades and spurious wakeups included.
+    uint64_t expirations = 0;       ///< Expirations served.
+    uint64_t saved_wakeups = 0;     ///< Expirations served by a wakeup that had already served another.
+};
+
+/**
+ * @brief Lock-free histogram with power of two buckets.
+ *
+ * Bucket 0 counts the zero samples, bucket i the samples in [2^(i-1), 2^i), the last one everything
+ * above. record() is a single relaxed increment, safe from any thread; readers see each bucket
+ * atomically but not the whole histogram as one snapshot. Each bucket wraps after 2^32 samples.
+ */
+struct timer_histogram
+{
+    static constexpr size_t BUCKETS = 32;
+
+    std::atomic<uint32_t> buckets[BUCKETS]{};
+
+    /**
+     * @brief Adds a sample.
+     *
+     * @param value The sample.
+     */
+    inline void record(uint64_t value) OS_NOEXCEPT
+    {
+        size_t i = value ? 64 - __builtin_clzll(value) : 0;
+        buckets[i < BUCKETS ? i : BUCKETS - 1].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Returns the number of samples.
+     *
+     * @return The sum of the buckets.
+     */
+    uint64_t count() const OS_NOEXCEPT
+    {
+        uint64_t ret = 0;
+        for (auto&& b : buckets)
+        {
+            ret += b.load(std::memory_order_relaxed);
+        }
+        return ret;
+    }
+
+    /**
+     * @brief Returns an upper bound of a percentile.
+     *
+     * @param p The percentile, in [0, 100].
+     * @return The upper bound of the bucket holding it (2^i - 1), at most twice the exact value;
+     *         UINT64_MAX when it falls in the last bucket, 0 without samples.
+     */
+    uint64_t percentile(double p) const OS_NOEXCEPT
+    {
+        uint32_t snapshot[BUCKETS];
+        uint64_t total = 0;
+        for (size_t i = 0; i < BUCKETS; i++)
+        {
+            snapshot[i] = buckets[i].load(std::memory_order_relaxed);
+            total += snapshot[i];
+        }
+        if (total == 0)
+        {
+            return 0;
+        }
+
+        // rank of the sample, 1 based, rounded up
+        const double wanted = p / 100.0 * static_cast<double>(total);
+        uint64_t rank = static_cast<uint64_t>(wanted);
+        if (rank < wanted || rank == 0)
+        {
+            rank++;
+        }
+
+        uint64_t seen = 0;
+        for (size_t i = 0; i < BUCKETS - 1; i++)
+        {
+            seen += snapshot[i];
+            if (seen >= rank)
+            {
+                return i ? (uint64_t{1} << i) - 1 : 0;
+            }
+        }
+        return UINT64_MAX;
+    }
+
+    /**
+     * @brief Clears the buckets, samples recorded meanwhile may be kept or lost.
+     */
+    void reset() OS_NOEXCEPT
+    {
+        for (auto&& b : buckets)
+        {
+            b.store(0, std::memory_order_relaxed);
+        }
+    }
+};
+
+/**
+ * @brief Expiration statistics of a timer, or of all of them.
+ */
+struct timer_stats
+{
+    timer_histogram lateness;   ///< Nanoseconds between the scheduled expiration and the handler call.
+    timer_histogram run_time;   ///< Nanoseconds spent in the handler.
+    timer_histogram overrun;    ///< Expirations missed before each call, see timer::overrun().
+
+    /**
+     * @brief Adds one handler call.
+     *
+     * @param lateness_ns Call time minus scheduled expiration.
+     * @param run_ns Handler duration.
+     * @param overrun_count Missed expirations.
+     */
+    inline void record(uint64_t lateness_ns, uint64_t run_ns, uint32_t overrun_count) OS_NOEXCEPT
+    {
+        lateness.record(lateness_ns);
+        run_time.record(run_ns);
+        overrun.record(overrun_count);
+    }
+
+    /**
+     * @brief Clears the three histograms.
+     */
+    void reset() OS_NOEXCEPT
+    {
+        lateness.reset();
+        run_time.reset();
+        overrun.reset();
+    }
+};
+
 /**
  * @brief Final class for timers.
  *
  * This class provides a timer implementation.
  * It is a final class, meaning it cannot be derived from.
+ * On unix all the timers share a hierarchical timing wheel serviced by OS_TIMER_SERVICE_THREADS
+ * threads (1 ms tick), handlers run on the service thread; on FreeRTOS they run on the timer task.
+ * No timer allocates: the unix service lives in static storage and starts with the first create(),
+ * FreeRTOS timers are built by xTimerCreateStatic() in the object itself, so timers can be kept
+ * in global tables.
+ * On FreeRTOS a created timer must be destroyed by a task while the scheduler runs: not from a
+ * handler, which runs on the timer task, and not before vTaskStartScheduler(). The kernel deletes
+ * timers asynchronously and keeps using the control block embedded in the object until the timer
+ * task has processed the command, which the destructor can await only from another task. This is
+ * checked by configASSERT() alone: with assertions disabled, a destructor called from a handler
+ * never returns and one called before the scheduler starts is undefined behaviour.
  */
 class timer final
 {
@@ -77,12 +247,17 @@ public:
 
     /**
      * @brief Destructor.
+     *
+     * Stops the timer and waits for a running handler, unless called by that handler. On unix a
+     * handler may delete its own timer; on FreeRTOS this asserts, see the class description.
      */
     ~timer() OS_NOEXCEPT;
 
     /**
      * @brief Creates the timer.
      *
+     * Calling it again on a created timer stops it and updates its argument in place.
+     *
      * @param arg The argument to be passed to the timer handler.
      * @param error Optional pointer to an error object to be populated in case of failure.
      * @return `true` if the timer was created successfully, `false` otherwise.
@@ -108,6 +283,21 @@ public:
      */
     void start() const OS_NOEXCEPT;
 
+    /**
+     * @brief Starts the timer at an absolute deadline.
+     *
+     * The first expiration happens at deadline, a periodic timer then expires at deadline + k * period:
+     * every expiration is computed from the schedule, never from the time the previous one fired,
+     * so the phase error does not accumulate. A deadline already passed expires at once.
+     * On FreeRTOS native timers are relative: the first period is set to reach deadline and the
+     * programmed one is restored by the first call, which the kernel counts from the tick it
+     * processes the change. The schedule is therefore exact only to within the dispatch latency of
+     * that first call, usually 0 ticks.
+     *
+     * @param deadline Absolute tick (see osal::deadline).
+     */
+    void start_at(tick deadline) const OS_NOEXCEPT;
+
     /**
      * @brief Starts the timer from an ISR.
      *
@@ -129,15 +319,111 @@ public:
      */
     void stop_from_isr() const OS_NOEXCEPT;
 
+    /**
+     * @brief Selects how a periodic timer handles missed expirations.
+     *
+     * Unix defaults to timer_policy::SKIP. FreeRTOS reloads auto-reload timers from their expected
+     * expiration time and always catches up, only timer_policy::CATCH_UP is accepted there.
+     *
+     * @param policy The policy.
+     * @param error Optional pointer to an error object to be populated in case of failure.
+     * @return osal::exit::OK on success, osal::exit::KO if the platform does not support the policy.
+     */
+    osal::exit set_policy(timer_policy policy, error** error = nullptr) OS_NOEXCEPT;
+
+    /**
+     * @brief Returns the expirations missed before the current handler call, like timer_getoverrun().
+     *
+     * Only meaningful inside the handler. With timer_policy::SKIP it is the number of schedule
+     * points passed without a call, with timer_policy::CATCH_UP the number of calls still due.
+     * Always 0 on FreeRTOS.
+     *
+     * @return The overrun count.
+     */
+    uint32_t overrun() const OS_NOEXCEPT;
+
+    /**
+     * @brief Sets how late an expiration may be served.
+     *
+     * Timers with loose tolerances let the service batch their expirations: it sleeps until the
+     * earliest expiration plus its slack and serves every timer due by then in one wakeup. On
+     * FreeRTOS the first expiration is rounded up to a shared tick boundary, the largest power of
+     * two ticks not above the slack, so timers with compatible periods expire on the same tick.
+     * On unix it applies at once, on FreeRTOS from the next start().
+     *
+     * @param us The tolerated delay (in microseconds), 0 by default.
+     */
+    void set_slack(uint64_t us) OS_NOEXCEPT;
+
+    /**
+     * @brief Returns the timer service counters.
+     *
+     * @return The counters; on FreeRTOS, where the timer task belongs to the kernel, all 0.
+     */
+    static timer_service_stats get_service_stats() OS_NOEXCEPT;
+
+    /**
+     * @brief Selects where the handler runs.
+     *
+     * With timer_dispatch::POOL expirations are queued to OS_TIMER_WORKER_THREADS shared workers,
+     * started on first use. A timer is queued at most once: an expiration that finds its call still
+     * queued is merged into it, one that arrives while the handler runs queues a single new call for
+     * when it returns. Merged expirations are added to overrun() and counted by coalesced().
+     * Only timer_dispatch::INLINE is available on FreeRTOS, handlers run on the timer task.
+     *
+     * @param dispatch The dispatch mode.
+     * @param error Optional pointer to an error object to be populated in case of failure.
+     * @return osal::exit::OK on success, osal::exit::KO if the mode is not available.
+     */
+    osal::exit set_dispatch(timer_dispatch dispatch, error** error = nullptr) OS_NOEXCEPT;
+
+    /**
+     * @brief Returns the expirations merged into an already queued or pending pooled call.
+     *
+     * @return The count since creation.
+     */
+    uint64_t coalesced() const OS_NOEXCEPT;
+
+    /**
+     * @brief Returns the pooled calls discarded because the timer was stopped before they ran.
+     *
+     * @return The count since creation.
+     */
+    uint64_t dropped() const OS_NOEXCEPT;
+
+    /**
+     * @brief Returns the statistics of this timer.
+     *
+     * Every handler call records its lateness, run time and overrun, here and in get_global_stats().
+     * On FreeRTOS lateness and run time have the tick resolution.
+     *
+     * @return The histograms, readable and resettable while the timer runs.
+     */
+    timer_stats& get_stats() OS_NOEXCEPT
+    {
+        return stats;
+    }
+
+    /**
+     * @brief Returns the statistics summed over all the timers.
+     *
+     * @return The histograms, readable and resettable at any time.
+     */
+    static timer_stats& get_global_stats() OS_NOEXCEPT;
+
+    /**
+     * @brief Checks if the timer is armed.
+     *
+     * @return `true` while the timer is waiting to expire, `false` once stopped or after a one-shot expiration.
+     */
     bool is_active() const OS_NOEXCEPT;
 
 private:
     uint64_t us;    ///< The time interval for the timer (in microseconds).
     handler fn;     ///< The handler function to be called when the timer expires.
     bool one_shot;   ///< Flag indicating whether the timer is a one-shot timer.
-    timer_data t{};   ///< Internal data for the timer.
-
-    friend void* timer_thread(void*);
+    mutable timer_data t{};   ///< Internal data for the timer, armed and disarmed by the const start()/stop().
+    timer_stats stats;          ///< Handler call histograms, fed by the timer service.
 
 };
 }
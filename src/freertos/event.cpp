@@ -46,6 +46,11 @@ event::~event() OS_NOEXCEPT
 
 
 osal::exit event::wait(uint32_t mask, uint32_t& value, uint64_t time, error** error) OS_NOEXCEPT
+{
+    return wait_until(mask, value, deadline_from_ms(time), error);
+}
+
+osal::exit event::wait_until(uint32_t mask, uint32_t& value, tick deadline, error** error) OS_NOEXCEPT
 {
     if(e.handle == nullptr)
     {
@@ -61,7 +66,7 @@ osal::exit event::wait(uint32_t mask, uint32_t& value, uint64_t time, error** er
             mask,
             pdFALSE,
             pdFALSE,
-            tmo_to_ticks(time));
+            ticks_until(deadline));
 
     value &= mask;
     return (value == 0) ? exit::OK : exit::KO;
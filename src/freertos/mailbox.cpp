@@ -0,0 +1,128 @@
+/***************************************************************************
+ * 
+ * OSAL
+ * Copyright (C) 2023/2024 Antonio Salsi <passy.linux@zresa.it>
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>. 
+ * 
+ ***************************************************************************/
+#include "osal/mailbox.hpp"
+
+#include <FreeRTOS.h>
+#include <queue.h>
+
+namespace osal
+{
+inline namespace v1
+{
+
+mailbox::mailbox(size_t message_size, error** error) OS_NOEXCEPT
+    : m { xQueueCreate(1, message_size) }
+{
+    if(m.handle == nullptr && error)
+    {
+        *error = OS_ERROR_BUILD("xQueueCreate() fail.", error_type::OS_EFAULT);
+        OS_ERROR_PTR_SET_POSITION(*error);
+    }
+}
+
+mailbox::~mailbox() OS_NOEXCEPT
+{
+    if(m.handle)
+    {
+        vQueueDelete(m.handle);
+        m.handle = nullptr;
+    }
+}
+
+osal::exit mailbox::overwrite(const uint8_t* msg, error** error) OS_NOEXCEPT
+{
+    if(m.handle == nullptr)
+    {
+        if(error)
+        {
+            *error = OS_ERROR_BUILD("xQueueCreate() fail.", error_type::OS_EFAULT);
+            OS_ERROR_PTR_SET_POSITION(*error);
+        }
+        return exit::KO;
+    }
+
+    return xQueueOverwrite(m.handle, msg) == pdPASS ? exit::OK : exit::KO;
+}
+
+osal::exit mailbox::overwrite_from_isr(const uint8_t* msg, error** error) OS_NOEXCEPT
+{
+    if(m.handle == nullptr)
+    {
+        if(error)
+        {
+            *error = OS_ERROR_BUILD("xQueueCreate() fail.", error_type::OS_EFAULT);
+            OS_ERROR_PTR_SET_POSITION(*error);
+        }
+        return exit::KO;
+    }
+
+    BaseType_t woken = pdFALSE;
+    BaseType_t success = xQueueOverwriteFromISR(m.handle, msg, &woken);
+    portYIELD_FROM_ISR(woken);
+
+    return success == pdPASS ? exit::OK : exit::KO;
+}
+
+osal::exit mailbox::peek(void* msg, uint64_t time, error** error) OS_NOEXCEPT
+{
+    return peek_until(msg, deadline_from_ms(time), error);
+}
+
+osal::exit mailbox::peek_until(void* msg, tick deadline, error** error) OS_NOEXCEPT
+{
+    if(m.handle == nullptr)
+    {
+        if(error)
+        {
+            *error = OS_ERROR_BUILD("xQueueCreate() fail.", error_type::OS_EFAULT);
+            OS_ERROR_PTR_SET_POSITION(*error);
+        }
+        return exit::KO;
+    }
+
+    if(xQueuePeek(m.handle, msg, ticks_until(deadline)) == pdTRUE)
+    {
+        return exit::OK;
+    }
+
+    if(error)
+    {
+        *error = OS_ERROR_BUILD("Timeout expired.", error_type::OS_ETIMEDOUT);
+        OS_ERROR_PTR_SET_POSITION(*error);
+    }
+    return exit::KO;
+}
+
+osal::exit mailbox::peek_from_isr(void* msg, uint64_t, error** error) OS_NOEXCEPT
+{
+    if(m.handle == nullptr)
+    {
+        if(error)
+        {
+            *error = OS_ERROR_BUILD("xQueueCreate() fail.", error_type::OS_EFAULT);
+            OS_ERROR_PTR_SET_POSITION(*error);
+        }
+        return exit::KO;
+    }
+
+    return xQueuePeekFromISR(m.handle, msg) == pdTRUE ? exit::OK : exit::KO;
+}
+
+}
+}
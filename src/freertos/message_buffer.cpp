@@ -0,0 +1,199 @@
+/***************************************************************************
+ * 
+ * OSAL
+ * Copyright (C) 2023/2024 Antonio Salsi <passy.linux@zresa.it>
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>. 
+ * 
+ ***************************************************************************/
+#include "osal/message_buffer.hpp"
+
+#include <FreeRTOS.h>
+#include <message_buffer.h>
+
+namespace osal
+{
+inline namespace v1
+{
+
+namespace
+{
+
+bool check_handle(MessageBufferHandle_t handle, error** error) OS_NOEXCEPT
+{
+    if(handle == nullptr)
+    {
+        if(error)
+        {
+            *error = OS_ERROR_BUILD("xMessageBufferCreate() fail.", error_type::OS_EFAULT);
+            OS_ERROR_PTR_SET_POSITION(*error);
+        }
+        return false;
+    }
+    return true;
+}
+
+/**
+ * The native send fails at once, as on a timeout, for a message that can never fit.
+ */
+bool check_size(const message_buffer_data& mb, size_t size, error** error) OS_NOEXCEPT
+{
+    // an empty message would be received as 0, which stands for no message
+    if(size == 0)
+    {
+        if(error)
+        {
+            *error = OS_ERROR_BUILD("Invalid argument.", error_type::OS_EINVAL);
+            OS_ERROR_PTR_SET_POSITION(*error);
+        }
+        return false;
+    }
+
+    if(size + sizeof(configMESSAGE_BUFFER_LENGTH_TYPE) > mb.size)
+    {
+        if(error)
+        {
+            *error = OS_ERROR_BUILD("Message larger than the buffer.", error_type::OS_EMSGSIZE);
+            OS_ERROR_PTR_SET_POSITION(*error);
+        }
+        return false;
+    }
+    return true;
+}
+
+/**
+ * The native receive returns 0 both on timeout and when the buffer is too small for the next message.
+ */
+size_t receive_result(MessageBufferHandle_t handle, size_t received, size_t size, error** error) OS_NOEXCEPT
+{
+    if(received == 0 && error)
+    {
+        if(xMessageBufferNextLengthBytes(handle) > size)
+        {
+            *error = OS_ERROR_BUILD("Buffer too small for the next message.", error_type::OS_EMSGSIZE);
+        }
+        else
+        {
+            *error = OS_ERROR_BUILD("Timeout expired.", error_type::OS_ETIMEDOUT);
+        }
+        OS_ERROR_PTR_SET_POSITION(*error);
+    }
+    return received;
+}
+
+}
+
+message_buffer::message_buffer(size_t size, error** error) OS_NOEXCEPT
+    : mb { xMessageBufferCreate(size), size }
+{
+    check_handle(mb.handle, error);
+}
+
+message_buffer::~message_buffer() OS_NOEXCEPT
+{
+    if(mb.handle)
+    {
+        vMessageBufferDelete(mb.handle);
+        mb.handle = nullptr;
+    }
+}
+
+size_t message_buffer::send(const uint8_t* data, size_t size, uint64_t time, error** error) OS_NOEXCEPT
+{
+    return send_until(data, size, deadline_from_ms(time), error);
+}
+
+size_t message_buffer::send_until(const uint8_t* data, size_t size, tick deadline, error** error) OS_NOEXCEPT
+{
+    if(!check_handle(mb.handle, error) || !check_size(mb, size, error))
+    {
+        return 0;
+    }
+
+    const size_t sent = xMessageBufferSend(mb.handle, data, size, ticks_until(deadline));
+    if(sent == 0 && error)
+    {
+        *error = OS_ERROR_BUILD("Timeout expired.", error_type::OS_ETIMEDOUT);
+        OS_ERROR_PTR_SET_POSITION(*error);
+    }
+    return sent;
+}
+
+size_t message_buffer::send_from_isr(const uint8_t* data, size_t size, error** error) OS_NOEXCEPT
+{
+    if(!check_handle(mb.handle, error) || !check_size(mb, size, error))
+    {
+        return 0;
+    }
+
+    BaseType_t woken = pdFALSE;
+    const size_t sent = xMessageBufferSendFromISR(mb.handle, data, size, &woken);
+    portYIELD_FROM_ISR(woken);
+
+    return sent;
+}
+
+size_t message_buffer::receive(uint8_t* data, size_t size, uint64_t time, error** error) OS_NOEXCEPT
+{
+    return receive_until(data, size, deadline_from_ms(time), error);
+}
+
+size_t message_buffer::receive_until(uint8_t* data, size_t size, tick deadline, error** error) OS_NOEXCEPT
+{
+    if(!check_handle(mb.handle, error))
+    {
+        return 0;
+    }
+
+    return receive_result(mb.handle, xMessageBufferReceive(mb.handle, data, size, ticks_until(deadline)), size, error);
+}
+
+size_t message_buffer::receive_from_isr(uint8_t* data, size_t size, error** error) OS_NOEXCEPT
+{
+    if(!check_handle(mb.handle, error))
+    {
+        return 0;
+    }
+
+    BaseType_t woken = pdFALSE;
+    const size_t received = xMessageBufferReceiveFromISR(mb.handle, data, size, &woken);
+    portYIELD_FROM_ISR(woken);
+
+    return receive_result(mb.handle, received, size, error);
+}
+
+size_t message_buffer::next_size() const OS_NOEXCEPT
+{
+    return mb.handle ? xMessageBufferNextLengthBytes(mb.handle) : 0;
+}
+
+void message_buffer::reset() OS_NOEXCEPT
+{
+    if(mb.handle)
+    {
+        xMessageBufferReset(mb.handle);
+    }
+}
+
+bool message_buffer::is_empty() const OS_NOEXCEPT
+{
+    return mb.handle == nullptr || xMessageBufferIsEmpty(mb.handle) == pdTRUE;
+}
+
+size_t message_buffer::bytes_free() const OS_NOEXCEPT
+{
+    return mb.handle ? xMessageBufferSpaceAvailable(mb.handle) : 0;
+}
+
+}
+}
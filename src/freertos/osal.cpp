@@ -51,6 +51,34 @@ tick tick_from_us (uint64_t us) OS_NOEXCEPT
     return us / (1'000u * portTICK_PERIOD_MS);
 }
 
+uint64_t ticks_until(tick deadline) OS_NOEXCEPT
+{
+    if(deadline == WAIT_FOREVER)
+    {
+        return portMAX_DELAY;
+    }
+
+    // wrap-safe: a deadline in the past lands in the upper half of the tick range
+    const TickType_t left = static_cast<TickType_t>(deadline) - xTaskGetTickCount();
+    return left > (portMAX_DELAY >> 1) ? 0 : left;
+}
+
+tick deadline_from_ms(uint64_t time) OS_NOEXCEPT
+{
+    return time == WAIT_FOREVER ? WAIT_FOREVER : xTaskGetTickCount() + tmo_to_ticks(time);
+}
+
+deadline deadline::from_ms(uint64_t time) OS_NOEXCEPT
+{
+    // same convention as the millisecond overloads, WAIT_FOREVER is kept
+    return deadline{deadline_from_ms(time)};
+}
+
+bool deadline::expired() const OS_NOEXCEPT
+{
+    return at != WAIT_FOREVER && ticks_until(at) == 0;
+}
+
 void tick_sleep (tick tick) OS_NOEXCEPT
 {
     vTaskDelay (tick);
@@ -69,12 +69,55 @@ struct queue_data
 {
     size_t size = 0;
     size_t count = 0;
+    size_t message_size = 0;
     QueueHandle_t handle = nullptr;
+    uint8_t* reserved = nullptr;    ///< Staging buffer handed out by reserve(), allocated by the constructor.
+    uint8_t* acquired = nullptr;    ///< Staging buffer handed out by acquire(), allocated by the constructor.
+    uint64_t reserve_time = 0;      ///< Deadline (tick) of the pending reserve(), spent by commit().
+    bool reserve_busy = false;      ///< reserved is owned by a producer until commit().
+    bool acquire_busy = false;      ///< acquired is owned by a consumer until release().
+};
+
+struct mailbox_data
+{
+    QueueHandle_t handle = nullptr;     ///< One slot queue written by xQueueOverwrite().
+};
+
+struct message_buffer_data
+{
+    StreamBufferHandle_t handle = nullptr;  ///< Native message buffer, a stream buffer storing length-prefixed messages.
+    size_t size = 0;                        ///< Capacity in bytes, length prefixes included.
+};
+
+struct queue_set_member
+{
+    QueueHandle_t handle = nullptr;     ///< Native queue or semaphore added to the set.
+    void* object = nullptr;             ///< The osal object returned by select().
+};
+
+struct queue_set_data
+{
+    QueueHandle_t handle = nullptr;     ///< Created by xQueueCreateSet().
+    queue_set_member* members = nullptr;
+    size_t size = 0;
+    size_t count = 0;
+};
+
+/**
+ * @brief Bytes reserved for the StaticQueue_t control block, checked against the kernel in static_queue.cpp.
+ */
+constexpr inline const size_t STATIC_QUEUE_CONTROL_SIZE = sizeof(void*) * 32;
+
+struct static_queue_data
+{
+    alignas(void*) uint8_t control[STATIC_QUEUE_CONTROL_SIZE]{};   ///< Opaque StaticQueue_t storage.
+    QueueHandle_t handle = nullptr;                                 ///< Created by xQueueCreateStatic() on first use.
 };
 
 struct stream_buffer_data
 {
     StreamBufferHandle_t handle;
+    size_t trigger_size;    ///< Last trigger level set, restored after receive_at_least().
 };
 
 struct thread_data
@@ -92,6 +135,11 @@ struct thread_data
 };
 
 
+/**
+ * @brief Bytes reserved for the StaticTimer_t control block, checked against the kernel in timer.cpp.
+ */
+constexpr inline const size_t STATIC_TIMER_CONTROL_SIZE = sizeof(void*) * 16;
+
 struct timer_data
 {
 
@@ -100,15 +148,36 @@ struct timer_data
         class timer* timer = nullptr;
         void* arg = nullptr;
         void* (*fn)(class timer*, void*) = nullptr;
+        struct timer_stats* stats = nullptr;  ///< Histograms of the owner, fed on every handler call.
+        TickType_t period = 0;      ///< Programmed period, restored after a timer::start_at() first expiration.
+        TickType_t slack = 0;       ///< Tolerated delay in ticks, start() aligns on a shared boundary.
+        bool rephase = false;       ///< The native period currently holds the start_at() offset.
 
         static void wrap_func( TimerHandle_t xTimer );
     };
-    TimerHandle_t handler = nullptr;
+    alignas(void*) uint8_t control[STATIC_TIMER_CONTROL_SIZE]{};  ///< Opaque StaticTimer_t storage, no heap allocation.
+    TimerHandle_t handler = nullptr;                                ///< Created by xTimerCreateStatic().
     args_wrapper args_wrp{};
 };
 
 using tick = uint64_t;
 
+/**
+ * @brief Converts an absolute tick deadline into the relative wait expected by the kernel.
+ *
+ * @param deadline Absolute tick or WAIT_FOREVER.
+ * @return Ticks left, 0 once the deadline has passed, portMAX_DELAY for WAIT_FOREVER.
+ */
+uint64_t ticks_until(tick deadline) OS_NOEXCEPT;
+
+/**
+ * @brief Builds the absolute tick reached after a relative timeout.
+ *
+ * @param time Timeout in milliseconds or WAIT_FOREVER.
+ * @return The absolute tick, WAIT_FOREVER is kept as is.
+ */
+tick deadline_from_ms(uint64_t time) OS_NOEXCEPT;
+
 
 }
 }
@@ -0,0 +1,102 @@
+/***************************************************************************
+ * 
+ * OSAL
+ * Copyright (C) 2023/2024 Antonio Salsi <passy.linux@zresa.it>
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>. 
+ * 
+ ***************************************************************************/
+#pragma once
+
+namespace osal
+{
+inline namespace v1
+{
+
+/**
+ * @brief Returns the native queue, creating it with xQueueCreateStatic() on first use.
+ *
+ * Must not be called first from an interrupt service routine.
+ */
+QueueHandle_t static_queue_handle(static_queue_data& q, uint8_t* buffer, size_t size, size_t message_size) OS_NOEXCEPT;
+
+/**
+ * @brief Receives a message from the native queue.
+ */
+osal::exit static_queue_fetch(QueueHandle_t handle, void* msg, tick deadline, bool isr, error** error) OS_NOEXCEPT;
+
+/**
+ * @brief Sends a message to the back of the native queue.
+ */
+osal::exit static_queue_post(QueueHandle_t handle, const void* msg, tick deadline, bool isr, error** error) OS_NOEXCEPT;
+
+/**
+ * @brief Returns the number of messages stored in the native queue.
+ */
+size_t static_queue_size(QueueHandle_t handle) OS_NOEXCEPT;
+
+/**
+ * @brief Deletes the native queue, if it was created.
+ */
+void static_queue_delete(static_queue_data& q) OS_NOEXCEPT;
+
+template<typename T, size_t N>
+static_queue<T, N>::~static_queue() OS_NOEXCEPT
+{
+    static_queue_delete(q);
+}
+
+template<typename T, size_t N>
+osal::exit static_queue<T, N>::fetch(T& msg, uint64_t time, error** error) OS_NOEXCEPT
+{
+    return fetch_until(msg, deadline_from_ms(time), error);
+}
+
+template<typename T, size_t N>
+osal::exit static_queue<T, N>::fetch_until(T& msg, tick deadline, error** error) OS_NOEXCEPT
+{
+    return static_queue_fetch(static_queue_handle(q, buffer, N, sizeof(T)), &msg, deadline, false, error);
+}
+
+template<typename T, size_t N>
+osal::exit static_queue<T, N>::fetch_from_isr(T& msg, uint64_t time, error** error) OS_NOEXCEPT
+{
+    return static_queue_fetch(q.handle, &msg, 0, true, error);
+}
+
+template<typename T, size_t N>
+osal::exit static_queue<T, N>::post(const T& msg, uint64_t time, error** error) OS_NOEXCEPT
+{
+    return post_until(msg, deadline_from_ms(time), error);
+}
+
+template<typename T, size_t N>
+osal::exit static_queue<T, N>::post_until(const T& msg, tick deadline, error** error) OS_NOEXCEPT
+{
+    return static_queue_post(static_queue_handle(q, buffer, N, sizeof(T)), &msg, deadline, false, error);
+}
+
+template<typename T, size_t N>
+osal::exit static_queue<T, N>::post_from_isr(const T& msg, uint64_t time, error** error) OS_NOEXCEPT
+{
+    return static_queue_post(q.handle, &msg, 0, true, error);
+}
+
+template<typename T, size_t N>
+size_t static_queue<T, N>::size() const OS_NOEXCEPT
+{
+    return static_queue_size(q.handle);
+}
+
+}
+}
@@ -20,22 +20,38 @@
 
 #include <FreeRTOS.h>
 #include <queue.h>
+#include <task.h>
 
 namespace osal
 {
 inline namespace v1
 {
 
-queue::queue(size_t size, size_t message_size, error** error) OS_NOEXCEPT
-    : q {
+queue::queue(size_t size, size_t message_size, queue_mode mode, error** error) OS_NOEXCEPT
+    : mode(mode)
+    , q {
        size,
        0,
+       message_size,
        xQueueCreate(size, message_size)
     }
 {
-    if(q.handle == nullptr && error)
+    if(q.handle == nullptr)
     {
-        *error = OS_ERROR_BUILD("xQueueCreate() fail.", error_type::OS_EFAULT);
+        if(error)
+        {
+            *error = OS_ERROR_BUILD("xQueueCreate() fail.", error_type::OS_EFAULT);
+            OS_ERROR_PTR_SET_POSITION(*error);
+        }
+        return;
+    }
+
+    // the native queue owns its storage: reserve() and acquire() hand out these staging slots
+    q.reserved = new uint8_t[message_size];
+    q.acquired = new uint8_t[message_size];
+    if((q.reserved == nullptr || q.acquired == nullptr) && error)
+    {
+        *error = OS_ERROR_BUILD("Out off memory.", error_type::OS_ENOMEM);
         OS_ERROR_PTR_SET_POSITION(*error);
     }
 }
@@ -47,9 +63,19 @@ queue::~queue() OS_NOEXCEPT
         vQueueDelete(q.handle);
         q.handle = nullptr;
     }
+
+    delete[] q.reserved;
+    q.reserved = nullptr;
+    delete[] q.acquired;
+    q.acquired = nullptr;
 }
 
 osal::exit queue::fetch(void* msg, uint64_t time, error** error) OS_NOEXCEPT
+{
+    return fetch_until(msg, deadline_from_ms(time), error);
+}
+
+osal::exit queue::fetch_until(void* msg, tick deadline, error** error) OS_NOEXCEPT
 {
     if(q.handle == nullptr)
     {
@@ -61,7 +87,7 @@ osal::exit queue::fetch(void* msg, uint64_t time, error** error) OS_NOEXCEPT
         return exit::KO;
     }
 
-    if(xQueueReceive(q.handle, msg, tmo_to_ticks(time)) == pdTRUE && q.count)
+    if(xQueueReceive(q.handle, msg, ticks_until(deadline)) == pdTRUE && q.count)
     {
         q.count--;
         return exit::OK;
@@ -94,6 +120,11 @@ exit queue::fetch_from_isr(void* msg, uint64_t, error** error) OS_NOEXCEPT
 }
 
 osal::exit queue::post(const uint8_t* msg, uint64_t time, error** error) OS_NOEXCEPT
+{
+    return post_until(msg, deadline_from_ms(time), error);
+}
+
+osal::exit queue::post_until(const uint8_t* msg, tick deadline, error** error) OS_NOEXCEPT
 {
     if(q.handle == nullptr)
     {
@@ -105,7 +136,7 @@ osal::exit queue::post(const uint8_t* msg, uint64_t time, error** error) OS_NOEX
         return exit::KO;
     }
 
-    if(xQueueSendToBack(q.handle, msg, tmo_to_ticks(time)) == pdTRUE)
+    if(xQueueSendToBack(q.handle, msg, ticks_until(deadline)) == pdTRUE)
     {
         q.count++;
         return exit::OK;
@@ -138,6 +169,255 @@ exit queue::post_from_isr(const uint8_t* msg, uint64_t, error** error) OS_NOEXCE
     return exit::KO;
 }
 
+osal::exit queue::fetch_bulk(void* msg, size_t max, size_t& got, uint64_t time, error** error) OS_NOEXCEPT
+{
+    return fetch_bulk_until(msg, max, got, deadline_from_ms(time), error);
+}
+
+osal::exit queue::fetch_bulk_until(void* msg, size_t max, size_t& got, tick deadline, error** error) OS_NOEXCEPT
+{
+    auto buffer = static_cast<uint8_t*>(msg);
+
+    got = 0;
+    if(q.handle == nullptr)
+    {
+        if(error)
+        {
+            *error = OS_ERROR_BUILD("xQueueCreate() fail.", error_type::OS_EFAULT);
+            OS_ERROR_PTR_SET_POSITION(*error);
+        }
+        return exit::KO;
+    }
+
+    if(msg == nullptr || max == 0)
+    {
+        if(error)
+        {
+            *error = OS_ERROR_BUILD("Invalid argument.", error_type::OS_EINVAL);
+            OS_ERROR_PTR_SET_POSITION(*error);
+        }
+        return exit::KO;
+    }
+
+    // block only for the first message, then drain what is already there
+    if(xQueueReceive(q.handle, buffer, ticks_until(deadline)) != pdTRUE)
+    {
+        return exit::KO;
+    }
+
+    do
+    {
+        got++;
+        if(q.count)
+        {
+            q.count--;
+        }
+    }
+    while(got < max && xQueueReceive(q.handle, buffer + (got * q.message_size), 0) == pdTRUE);
+
+    return exit::OK;
+}
+
+size_t queue::post_bulk(const uint8_t* msg, size_t count, uint64_t time, error** error) OS_NOEXCEPT
+{
+    return post_bulk_until(msg, count, deadline_from_ms(time), error);
+}
+
+size_t queue::post_bulk_until(const uint8_t* msg, size_t count, tick deadline, error** error) OS_NOEXCEPT
+{
+    size_t posted = 0;
+
+    if(q.handle == nullptr)
+    {
+        if(error)
+        {
+            *error = OS_ERROR_BUILD("xQueueCreate() fail.", error_type::OS_EFAULT);
+            OS_ERROR_PTR_SET_POSITION(*error);
+        }
+        return 0;
+    }
+
+    if(msg == nullptr || count == 0)
+    {
+        if(error)
+        {
+            *error = OS_ERROR_BUILD("Invalid argument.", error_type::OS_EINVAL);
+            OS_ERROR_PTR_SET_POSITION(*error);
+        }
+        return 0;
+    }
+
+    // block only for the first free slot, then fill what is left
+    if(xQueueSendToBack(q.handle, msg, ticks_until(deadline)) != pdTRUE)
+    {
+        return 0;
+    }
+
+    do
+    {
+        posted++;
+        q.count++;
+    }
+    while(posted < count && xQueueSendToBack(q.handle, msg + (posted * q.message_size), 0) == pdTRUE);
+
+    return posted;
+}
+
+uint8_t* queue::reserve(uint64_t time, error** error) OS_NOEXCEPT
+{
+    return reserve_until(deadline_from_ms(time), error);
+}
+
+uint8_t* queue::reserve_until(tick deadline, error** error) OS_NOEXCEPT
+{
+    if(q.handle == nullptr)
+    {
+        if(error)
+        {
+            *error = OS_ERROR_BUILD("xQueueCreate() fail.", error_type::OS_EFAULT);
+            OS_ERROR_PTR_SET_POSITION(*error);
+        }
+        return nullptr;
+    }
+
+    if(q.reserved == nullptr)
+    {
+        if(error)
+        {
+            *error = OS_ERROR_BUILD("Out off memory.", error_type::OS_ENOMEM);
+            OS_ERROR_PTR_SET_POSITION(*error);
+        }
+        return nullptr;
+    }
+
+    // a single staging slot: one reservation at a time, commit() copies it once
+    bool busy = false;
+    taskENTER_CRITICAL();
+    busy = q.reserve_busy;
+    q.reserve_busy = true;
+    taskEXIT_CRITICAL();
+    if(busy)
+    {
+        if(error)
+        {
+            *error = OS_ERROR_BUILD("Slot already reserved.", error_type::OS_EBUSY);
+            OS_ERROR_PTR_SET_POSITION(*error);
+        }
+        return nullptr;
+    }
+
+    q.reserve_time = deadline;
+    return q.reserved;
+}
+
+osal::exit queue::commit(uint8_t* slot, error** error) OS_NOEXCEPT
+{
+    if(slot == nullptr || slot != q.reserved || !q.reserve_busy)
+    {
+        if(error)
+        {
+            *error = OS_ERROR_BUILD("Slot not reserved.", error_type::OS_EINVAL);
+            OS_ERROR_PTR_SET_POSITION(*error);
+        }
+        return exit::KO;
+    }
+
+    // the slot is given back either way, a message that timed out is lost
+    const BaseType_t sent = xQueueSendToBack(q.handle, slot, ticks_until(q.reserve_time));
+    taskENTER_CRITICAL();
+    q.reserve_busy = false;
+    taskEXIT_CRITICAL();
+
+    if(sent == pdTRUE)
+    {
+        q.count++;
+        return exit::OK;
+    }
+
+    if(error)
+    {
+        *error = OS_ERROR_BUILD("Timeout expired.", error_type::OS_ETIMEDOUT);
+        OS_ERROR_PTR_SET_POSITION(*error);
+    }
+    return exit::KO;
+}
+
+const uint8_t* queue::acquire(uint64_t time, error** error) OS_NOEXCEPT
+{
+    return acquire_until(deadline_from_ms(time), error);
+}
+
+const uint8_t* queue::acquire_until(tick deadline, error** error) OS_NOEXCEPT
+{
+    if(q.handle == nullptr)
+    {
+        if(error)
+        {
+            *error = OS_ERROR_BUILD("xQueueCreate() fail.", error_type::OS_EFAULT);
+            OS_ERROR_PTR_SET_POSITION(*error);
+        }
+        return nullptr;
+    }
+
+    if(q.acquired == nullptr)
+    {
+        if(error)
+        {
+            *error = OS_ERROR_BUILD("Out off memory.", error_type::OS_ENOMEM);
+            OS_ERROR_PTR_SET_POSITION(*error);
+        }
+        return nullptr;
+    }
+
+    // a single staging slot: one acquisition at a time, until release()
+    bool busy = false;
+    taskENTER_CRITICAL();
+    busy = q.acquire_busy;
+    q.acquire_busy = true;
+    taskEXIT_CRITICAL();
+    if(busy)
+    {
+        if(error)
+        {
+            *error = OS_ERROR_BUILD("Slot already acquired.", error_type::OS_EBUSY);
+            OS_ERROR_PTR_SET_POSITION(*error);
+        }
+        return nullptr;
+    }
+
+    if(xQueueReceive(q.handle, q.acquired, ticks_until(deadline)) != pdTRUE)
+    {
+        taskENTER_CRITICAL();
+        q.acquire_busy = false;
+        taskEXIT_CRITICAL();
+        return nullptr;
+    }
+
+    if(q.count)
+    {
+        q.count--;
+    }
+    return q.acquired;
+}
+
+osal::exit queue::release(const uint8_t* slot, error** error) OS_NOEXCEPT
+{
+    if(slot == nullptr || slot != q.acquired || !q.acquire_busy)
+    {
+        if(error)
+        {
+            *error = OS_ERROR_BUILD("Slot not acquired.", error_type::OS_EINVAL);
+            OS_ERROR_PTR_SET_POSITION(*error);
+        }
+        return exit::KO;
+    }
+
+    taskENTER_CRITICAL();
+    q.acquire_busy = false;
+    taskEXIT_CRITICAL();
+    return exit::OK;
+}
+
 size_t queue::size() const OS_NOEXCEPT
 {
     return q.size;
@@ -0,0 +1,210 @@
+/***************************************************************************
+ * 
+ * OSAL
+ * Copyright (C) 2023/2024 Antonio Salsi <passy.linux@zresa.it>
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>. 
+ * 
+ ***************************************************************************/
+#include "osal/queue_set.hpp"
+#include "osal/event.hpp"
+#include "osal/queue.hpp"
+#include "osal/semaphore.hpp"
+
+#include <FreeRTOS.h>
+#include <queue.h>
+
+namespace osal
+{
+inline namespace v1
+{
+
+namespace
+{
+
+osal::exit queue_set_add(queue_set_data& s, QueueHandle_t handle, void* object, error** error) OS_NOEXCEPT
+{
+    if(s.handle == nullptr || handle == nullptr)
+    {
+        if(error)
+        {
+            *error = OS_ERROR_BUILD("xQueueCreateSet() fail.", error_type::OS_EFAULT);
+            OS_ERROR_PTR_SET_POSITION(*error);
+        }
+        return exit::KO;
+    }
+
+    if(s.count == s.size)
+    {
+        if(error)
+        {
+            *error = OS_ERROR_BUILD("Queue set full.", error_type::OS_ENOSPC);
+            OS_ERROR_PTR_SET_POSITION(*error);
+        }
+        return exit::KO;
+    }
+
+    // fails when the member is not empty or already belongs to a set
+    if(xQueueAddToSet(handle, s.handle) != pdPASS)
+    {
+        if(error)
+        {
+            *error = OS_ERROR_BUILD("xQueueAddToSet() fail.", error_type::OS_EINVAL);
+            OS_ERROR_PTR_SET_POSITION(*error);
+        }
+        return exit::KO;
+    }
+
+    s.members[s.count++] = {handle, object};
+    return exit::OK;
+}
+
+osal::exit queue_set_remove(queue_set_data& s, QueueHandle_t handle, error** error) OS_NOEXCEPT
+{
+    for(size_t i = 0; i < s.count; i++)
+    {
+        if(s.members[i].handle == handle)
+        {
+            // fails when the member is not empty
+            if(xQueueRemoveFromSet(handle, s.handle) != pdPASS)
+            {
+                if(error)
+                {
+                    *error = OS_ERROR_BUILD("xQueueRemoveFromSet() fail.", error_type::OS_EBUSY);
+                    OS_ERROR_PTR_SET_POSITION(*error);
+                }
+                return exit::KO;
+            }
+            s.members[i] = s.members[--s.count];
+            return exit::OK;
+        }
+    }
+
+    if(error)
+    {
+        *error = OS_ERROR_BUILD("Not a member of the queue set.", error_type::OS_ENOENT);
+        OS_ERROR_PTR_SET_POSITION(*error);
+    }
+    return exit::KO;
+}
+
+osal::exit queue_set_unsupported(error** error) OS_NOEXCEPT
+{
+    if(error)
+    {
+        *error = OS_ERROR_BUILD("Event groups cannot be added to a queue set.", error_type::OS_EOPNOTSUPP);
+        OS_ERROR_PTR_SET_POSITION(*error);
+    }
+    return exit::KO;
+}
+
+}
+
+queue_set::queue_set(size_t size, error** error) OS_NOEXCEPT
+    : s {
+        xQueueCreateSet(size),
+        new queue_set_member[size],
+        size,
+        0
+    }
+{
+    if((s.handle == nullptr || s.members == nullptr) && error)
+    {
+        *error = OS_ERROR_BUILD("xQueueCreateSet() fail.", error_type::OS_EFAULT);
+        OS_ERROR_PTR_SET_POSITION(*error);
+    }
+}
+
+queue_set::~queue_set() OS_NOEXCEPT
+{
+    while(s.count)
+    {
+        xQueueRemoveFromSet(s.members[--s.count].handle, s.handle);
+    }
+
+    if(s.handle)
+    {
+        vQueueDelete(s.handle);
+        s.handle = nullptr;
+    }
+
+    delete[] s.members;
+    s.members = nullptr;
+}
+
+osal::exit queue_set::add(class queue& q, error** error) OS_NOEXCEPT
+{
+    return queue_set_add(s, q.q.handle, &q, error);
+}
+
+osal::exit queue_set::add(class semaphore& sem, error** error) OS_NOEXCEPT
+{
+    return queue_set_add(s, sem.sem.handle, &sem, error);
+}
+
+osal::exit queue_set::add(class event&, uint32_t, error** error) OS_NOEXCEPT
+{
+    return queue_set_unsupported(error);
+}
+
+osal::exit queue_set::remove(class queue& q, error** error) OS_NOEXCEPT
+{
+    return queue_set_remove(s, q.q.handle, error);
+}
+
+osal::exit queue_set::remove(class semaphore& sem, error** error) OS_NOEXCEPT
+{
+    return queue_set_remove(s, sem.sem.handle, error);
+}
+
+osal::exit queue_set::remove(class event&, error** error) OS_NOEXCEPT
+{
+    return queue_set_unsupported(error);
+}
+
+void* queue_set::select(uint64_t time, error** error) OS_NOEXCEPT
+{
+    return select_until(deadline_from_ms(time), error);
+}
+
+void* queue_set::select_until(tick deadline, error** error) OS_NOEXCEPT
+{
+    if(s.handle == nullptr)
+    {
+        if(error)
+        {
+            *error = OS_ERROR_BUILD("xQueueCreateSet() fail.", error_type::OS_EFAULT);
+            OS_ERROR_PTR_SET_POSITION(*error);
+        }
+        return nullptr;
+    }
+
+    QueueSetMemberHandle_t handle = xQueueSelectFromSet(s.handle, ticks_until(deadline));
+    for(size_t i = 0; handle && i < s.count; i++)
+    {
+        if(s.members[i].handle == handle)
+        {
+            return s.members[i].object;
+        }
+    }
+
+    if(error)
+    {
+        *error = OS_ERROR_BUILD("Timeout expired.", error_type::OS_ETIMEDOUT);
+        OS_ERROR_PTR_SET_POSITION(*error);
+    }
+    return nullptr;
+}
+
+}
+}
@@ -45,6 +45,11 @@ semaphore::~semaphore()
 }
 
 osal::exit semaphore::wait(uint64_t time, error** error) OS_NOEXCEPT
+{
+    return wait_until(deadline_from_ms(time), error);
+}
+
+osal::exit semaphore::wait_until(tick deadline, error** error) OS_NOEXCEPT
 {
     if(sem.handle == nullptr)
     {
@@ -55,7 +60,7 @@ osal::exit semaphore::wait(uint64_t time, error** error) OS_NOEXCEPT
         }
         return exit::KO;
     }
-    if (xSemaphoreTake (sem.handle, tmo_to_ticks(time)) == pdTRUE)
+    if (xSemaphoreTake (sem.handle, ticks_until(deadline)) == pdTRUE)
     {
         return exit::OK;
     }
@@ -0,0 +1,113 @@
+/***************************************************************************
+ * 
+ * OSAL
+ * Copyright (C) 2023/2024 Antonio Salsi <passy.linux@zresa.it>
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>. 
+ * 
+ ***************************************************************************/
+#include "osal/static_queue.hpp"
+
+#include <FreeRTOS.h>
+#include <queue.h>
+
+namespace osal
+{
+inline namespace v1
+{
+
+static_assert(sizeof(StaticQueue_t) <= STATIC_QUEUE_CONTROL_SIZE, "STATIC_QUEUE_CONTROL_SIZE too small for StaticQueue_t");
+static_assert(alignof(StaticQueue_t) <= alignof(void*), "StaticQueue_t alignment not supported");
+
+QueueHandle_t static_queue_handle(static_queue_data& q, uint8_t* buffer, size_t size, size_t message_size) OS_NOEXCEPT
+{
+    if(q.handle == nullptr)
+    {
+        taskENTER_CRITICAL();
+        if(q.handle == nullptr)
+        {
+            q.handle = xQueueCreateStatic(size, message_size, buffer, reinterpret_cast<StaticQueue_t*>(q.control));
+        }
+        taskEXIT_CRITICAL();
+    }
+    return q.handle;
+}
+
+osal::exit static_queue_fetch(QueueHandle_t handle, void* msg, tick deadline, bool isr, error** error) OS_NOEXCEPT
+{
+    if(handle == nullptr)
+    {
+        if(error)
+        {
+            *error = OS_ERROR_BUILD("xQueueCreateStatic() fail.", error_type::OS_EFAULT);
+            OS_ERROR_PTR_SET_POSITION(*error);
+        }
+        return exit::KO;
+    }
+
+    BaseType_t success = pdFALSE;
+    if(isr)
+    {
+        success = xQueueReceiveFromISR(handle, msg, nullptr);
+        portYIELD_FROM_ISR(pdFALSE);
+    }
+    else
+    {
+        success = xQueueReceive(handle, msg, ticks_until(deadline));
+    }
+
+    return success == pdTRUE ? exit::OK : exit::KO;
+}
+
+osal::exit static_queue_post(QueueHandle_t handle, const void* msg, tick deadline, bool isr, error** error) OS_NOEXCEPT
+{
+    if(handle == nullptr)
+    {
+        if(error)
+        {
+            *error = OS_ERROR_BUILD("xQueueCreateStatic() fail.", error_type::OS_EFAULT);
+            OS_ERROR_PTR_SET_POSITION(*error);
+        }
+        return exit::KO;
+    }
+
+    BaseType_t success = pdFALSE;
+    if(isr)
+    {
+        success = xQueueSendToBackFromISR(handle, msg, nullptr);
+        portYIELD_FROM_ISR(pdFALSE);
+    }
+    else
+    {
+        success = xQueueSendToBack(handle, msg, ticks_until(deadline));
+    }
+
+    return success == pdTRUE ? exit::OK : exit::KO;
+}
+
+size_t static_queue_size(QueueHandle_t handle) OS_NOEXCEPT
+{
+    return handle ? uxQueueMessagesWaiting(handle) : 0;
+}
+
+void static_queue_delete(static_queue_data& q) OS_NOEXCEPT
+{
+    if(q.handle)
+    {
+        vQueueDelete(q.handle);
+        q.handle = nullptr;
+    }
+}
+
+}
+}
@@ -26,8 +26,8 @@ namespace osal
 inline namespace v1
 {
 
-stream_buffer::stream_buffer(size_t size, size_t trigger_size, error** error) OS_NOEXCEPT
-: sb { xStreamBufferCreate(size, trigger_size) }
+stream_buffer::stream_buffer(size_t size, size_t trigger_size, stream_buffer_mode, error** error) OS_NOEXCEPT
+: sb { xStreamBufferCreate(size, trigger_size), trigger_size }
 {
     if(sb.handle == nullptr && error)
     {
@@ -46,6 +46,11 @@ stream_buffer::~stream_buffer()
 }
 
 size_t stream_buffer::send(const uint8_t *data, size_t size, uint64_t time, error** error) OS_NOEXCEPT
+{
+    return send_until(data, size, deadline_from_ms(time), error);
+}
+
+size_t stream_buffer::send_until(const uint8_t *data, size_t size, tick deadline, error** error) OS_NOEXCEPT
 {
     if(sb.handle == nullptr)
     {
@@ -57,7 +62,28 @@ size_t stream_buffer::send(const uint8_t *data, size_t size, uint64_t time, erro
         return 0;
     }
 
-    return xStreamBufferSend(sb.handle, data, size, tmo_to_ticks(time));
+    // xStreamBufferSend() blocks until the whole request fits and then writes once: write what fits
+    // now, and when the buffer is full wait for its first free byte, so the data keeps flowing as
+    // the reader drains it until everything is sent or the deadline passes
+    size_t ret = 0;
+    while(ret < size)
+    {
+        const size_t free = xStreamBufferSpacesAvailable(sb.handle);
+        const size_t chunk = free ? (size - ret < free ? size - ret : free) : 1;
+        const size_t sent = xStreamBufferSend(sb.handle, data + ret, chunk, free ? 0 : ticks_until(deadline));
+        if(sent == 0)
+        {
+            break;
+        }
+        ret += sent;
+    }
+
+    if(ret == 0 && size > 0 && error)
+    {
+        *error = OS_ERROR_BUILD("Timeout expired.", error_type::OS_ETIMEDOUT);
+        OS_ERROR_PTR_SET_POSITION(*error);
+    }
+    return ret;
 }
 
 size_t stream_buffer::send_from_isr(const uint8_t *data, size_t size, uint64_t time, error **error) OS_NOEXCEPT
@@ -79,6 +105,31 @@ size_t stream_buffer::send_from_isr(const uint8_t *data, size_t size, uint64_t t
 }
 
 size_t stream_buffer::receive(uint8_t *data, size_t size, uint64_t time, error **error) OS_NOEXCEPT
+{
+    return receive_until(data, size, deadline_from_ms(time), error);
+}
+
+size_t stream_buffer::receive_until(uint8_t *data, size_t size, tick deadline, error **error) OS_NOEXCEPT
+{
+    if(sb.handle == nullptr)
+    {
+        if(error)
+        {
+            *error = OS_ERROR_BUILD("xStreamBufferCreate() fail.", error_type::OS_EFAULT);
+            OS_ERROR_PTR_SET_POSITION(*error);
+        }
+        return 0;
+    }
+
+    return xStreamBufferReceive(sb.handle, data, size, ticks_until(deadline));
+}
+
+size_t stream_buffer::receive_at_least(uint8_t *data, size_t size, size_t min_size, uint64_t time, error **error) OS_NOEXCEPT
+{
+    return receive_at_least_until(data, size, min_size, deadline_from_ms(time), error);
+}
+
+size_t stream_buffer::receive_at_least_until(uint8_t *data, size_t size, size_t min_size, tick deadline, error **error) OS_NOEXCEPT
 {
     if(sb.handle == nullptr)
     {
@@ -90,7 +141,17 @@ size_t stream_buffer::receive(uint8_t *data, size_t size, uint64_t time, error *
         return 0;
     }
 
-    return xStreamBufferReceive(sb.handle, data, size, tmo_to_ticks(time));
+    if(min_size == 0 || min_size == sb.trigger_size)
+    {
+        return xStreamBufferReceive(sb.handle, data, size, ticks_until(deadline));
+    }
+
+    // the trigger level is only read by the single reader, lower it for this call
+    const size_t level = min_size < size ? min_size : size;
+    xStreamBufferSetTriggerLevel(sb.handle, level);
+    const size_t ret = xStreamBufferReceive(sb.handle, data, size, ticks_until(deadline));
+    xStreamBufferSetTriggerLevel(sb.handle, sb.trigger_size);
+    return ret;
 }
 
 size_t stream_buffer::receive_from_isr(uint8_t *data, size_t size, uint64_t time, error **error) OS_NOEXCEPT
@@ -112,6 +173,116 @@ size_t stream_buffer::receive_from_isr(uint8_t *data, size_t size, uint64_t time
     return ret;
 }
 
+size_t stream_buffer::acquire_write(span (&regions)[2], uint64_t time, error** error) OS_NOEXCEPT
+{
+    return acquire_write_until(regions, deadline_from_ms(time), error);
+}
+
+size_t stream_buffer::acquire_write_until(span (&regions)[2], tick, error** error) OS_NOEXCEPT
+{
+    regions[0] = {};
+    regions[1] = {};
+    if(error)
+    {
+        *error = OS_ERROR_BUILD("The native stream buffer does not expose its storage.", error_type::OS_EOPNOTSUPP);
+        OS_ERROR_PTR_SET_POSITION(*error);
+    }
+    return 0;
+}
+
+osal::exit stream_buffer::commit_write(size_t, error** error) OS_NOEXCEPT
+{
+    if(error)
+    {
+        *error = OS_ERROR_BUILD("The native stream buffer does not expose its storage.", error_type::OS_EOPNOTSUPP);
+        OS_ERROR_PTR_SET_POSITION(*error);
+    }
+    return exit::KO;
+}
+
+size_t stream_buffer::acquire_read(span (&regions)[2], uint64_t time, error** error) OS_NOEXCEPT
+{
+    return acquire_read_until(regions, deadline_from_ms(time), error);
+}
+
+size_t stream_buffer::acquire_read_until(span (&regions)[2], tick, error** error) OS_NOEXCEPT
+{
+    regions[0] = {};
+    regions[1] = {};
+    if(error)
+    {
+        *error = OS_ERROR_BUILD("The native stream buffer does not expose its storage.", error_type::OS_EOPNOTSUPP);
+        OS_ERROR_PTR_SET_POSITION(*error);
+    }
+    return 0;
+}
+
+osal::exit stream_buffer::commit_read(size_t, error** error) OS_NOEXCEPT
+{
+    if(error)
+    {
+        *error = OS_ERROR_BUILD("The native stream buffer does not expose its storage.", error_type::OS_EOPNOTSUPP);
+        OS_ERROR_PTR_SET_POSITION(*error);
+    }
+    return exit::KO;
+}
+
+size_t stream_buffer::send_from_fd(int fd, size_t max, uint64_t time, error** error) OS_NOEXCEPT
+{
+    return send_from_fd_until(fd, max, deadline_from_ms(time), error);
+}
+
+size_t stream_buffer::send_from_fd_until(int, size_t, tick, error** error) OS_NOEXCEPT
+{
+    if(error)
+    {
+        *error = OS_ERROR_BUILD("File descriptors are not supported.", error_type::OS_EOPNOTSUPP);
+        OS_ERROR_PTR_SET_POSITION(*error);
+    }
+    return 0;
+}
+
+size_t stream_buffer::receive_to_fd(int fd, size_t max, uint64_t time, error** error) OS_NOEXCEPT
+{
+    return receive_to_fd_until(fd, max, deadline_from_ms(time), error);
+}
+
+size_t stream_buffer::receive_to_fd_until(int, size_t, tick, error** error) OS_NOEXCEPT
+{
+    if(error)
+    {
+        *error = OS_ERROR_BUILD("File descriptors are not supported.", error_type::OS_EOPNOTSUPP);
+        OS_ERROR_PTR_SET_POSITION(*error);
+    }
+    return 0;
+}
+
+osal::exit stream_buffer::set_trigger_level(size_t trigger_size, error** error) OS_NOEXCEPT
+{
+    if(sb.handle == nullptr || xStreamBufferSetTriggerLevel(sb.handle, trigger_size) == pdFALSE)
+    {
+        if(error)
+        {
+            *error = OS_ERROR_BUILD("xStreamBufferSetTriggerLevel() fail.", error_type::OS_EINVAL);
+            OS_ERROR_PTR_SET_POSITION(*error);
+        }
+        return exit::KO;
+    }
+
+    sb.trigger_size = trigger_size;
+    return exit::OK;
+}
+
+int stream_buffer::get_event_fd(error** error) OS_NOEXCEPT
+{
+    if(error)
+    {
+        *error = OS_ERROR_BUILD("File descriptors are not supported.", error_type::OS_EOPNOTSUPP);
+        OS_ERROR_PTR_SET_POSITION(*error);
+    }
+    return -1;
+}
+
 void stream_buffer::reset() OS_NOEXCEPT
 {
     if(sb.handle)
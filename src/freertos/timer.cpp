@@ -20,6 +20,7 @@
 #include "osal/thread.hpp"
 
 #include <FreeRTOS.h>
+#include <task.h>
 #include <timers.h>
 
 namespace osal
@@ -27,6 +28,19 @@ namespace osal
 inline namespace v1
 {
 
+static_assert(sizeof(StaticTimer_t) <= STATIC_TIMER_CONTROL_SIZE, "STATIC_TIMER_CONTROL_SIZE too small for StaticTimer_t");
+static_assert(alignof(StaticTimer_t) <= alignof(void*), "StaticTimer_t alignment not supported");
+
+namespace
+{
+
+void mark_done(void* done, uint32_t)
+{
+    *static_cast<volatile bool*>(done) = true;
+}
+
+}
+
 void timer_data::args_wrapper::wrap_func( TimerHandle_t timer )
 {
     if(timer == nullptr)
@@ -35,7 +49,36 @@ void timer_data::args_wrapper::wrap_func( TimerHandle_t timer )
     }
 
     auto wrapper = static_cast<timer_data::args_wrapper*>(pvTimerGetTimerID (timer));
+
+    // an auto-reload timer is already rearmed here, its expiry time is one period ahead
+    TickType_t scheduled = xTimerGetExpiryTime(timer);
+    if(xTimerGetReloadMode(timer) == pdTRUE)
+    {
+        scheduled -= xTimerGetPeriod(timer);
+    }
+    const TickType_t begin = xTaskGetTickCount();
+
+    // back to the programmed period after the start_at() offset, before the handler runs: the kernel
+    // restarts the timer from the tick it processes the command, so only the dispatch latency of
+    // this call shifts the phase. The daemon task must not block, with its command queue full the
+    // offset stays and the next expiration retries.
+    if(wrapper->rephase && xTimerIsTimerActive(timer))
+    {
+        if(xTimerChangePeriod(timer, wrapper->period, 0) == pdPASS)
+        {
+            wrapper->rephase = false;
+        }
+    }
     wrapper->fn(wrapper->timer, wrapper->arg);
+
+    constexpr uint64_t ns_per_tick = portTICK_PERIOD_MS * 1'000'000ull;
+    const uint64_t lateness = static_cast<TickType_t>(begin - scheduled) * ns_per_tick;
+    const uint64_t run_time = static_cast<TickType_t>(xTaskGetTickCount() - begin) * ns_per_tick;
+    if(wrapper->stats)
+    {
+        wrapper->stats->record(lateness, run_time, 0);
+    }
+    timer::get_global_stats().record(lateness, run_time, 0);
 }
 
 timer::timer(uint64_t us, handler fn, bool one_shot) OS_NOEXCEPT
@@ -45,31 +88,60 @@ timer::timer(uint64_t us, handler fn, bool one_shot) OS_NOEXCEPT
 {
     t.args_wrp.fn = fn;
     t.args_wrp.timer = this;
+    t.args_wrp.stats = &stats;
 }
 
 timer::~timer() OS_NOEXCEPT
 {
     if(t.handler)
     {
+        // the control block lives in this object: the timer task must process the delete command
+        // before it goes away, which cannot be awaited from the timer task itself nor before the
+        // scheduler runs the timer task; the kernel has no synchronous delete, see the class doc
+        configASSERT(xTaskGetSchedulerState() == taskSCHEDULER_RUNNING);
+        configASSERT(xTaskGetCurrentTaskHandle() != xTimerGetTimerDaemonTaskHandle());
+
         xTimerDelete (t.handler, portMAX_DELAY);
         t.handler = nullptr;
+
+        // wait for the delete command, queued before mark_done()
+        volatile bool done = false;
+        if(xTimerPendFunctionCall(mark_done, const_cast<bool*>(&done), 0, portMAX_DELAY) == pdPASS)
+        {
+            while(!done)
+            {
+                vTaskDelay(1);
+            }
+        }
     }
 }
 
 exit timer::create(void *arg, error** error) OS_NOEXCEPT
 {
     t.args_wrp.arg = arg;
-    t.handler = xTimerCreate (
+    t.args_wrp.period = (us / portTICK_PERIOD_MS) / 1'000;
+    t.args_wrp.rephase = false;
+    if(t.handler)
+    {
+        // the control block is in use: refresh the timer in place, disarmed as after creation
+        vTimerSetReloadMode(t.handler, one_shot ? pdFALSE : pdTRUE);
+        xTimerChangePeriod(t.handler, t.args_wrp.period, portMAX_DELAY);
+        xTimerStop(t.handler, portMAX_DELAY);
+        return exit::OK;
+    }
+
+    t.handler = xTimerCreateStatic (
             "os_timer",
             (us / portTICK_PERIOD_MS) / 1'000,
             one_shot ? pdFALSE : pdTRUE,
             &t.args_wrp,
-            &timer_data::args_wrapper::wrap_func);
+            &timer_data::args_wrapper::wrap_func,
+            reinterpret_cast<StaticTimer_t*>(t.control));
     if(t.handler == nullptr)
     {
         if(error)
         {
-            *error = OS_ERROR_BUILD("xStreamBufferCreate() fail.", error_type::OS_EFAULT);
+            *error = OS_ERROR_BUILD("xTimerCreateStatic() fail.", error_type::OS_EFAULT);
             OS_ERROR_PTR_SET_POSITION(*error);
         }
         return exit::KO;
@@ -81,6 +153,8 @@ exit timer::create(void *arg, error** error) OS_NOEXCEPT
 void timer::set(uint64_t us) OS_NOEXCEPT
 {
     timer::us = us;
+    t.args_wrp.period = (us / portTICK_PERIOD_MS) / 1'000;
+    t.args_wrp.rephase = false;
     if(t.handler && xTimerIsTimerActive( t.handler ))
     {
         xTimerChangePeriod(t.handler, (us / portTICK_PERIOD_MS) / 1'000, portMAX_DELAY);
@@ -90,6 +164,8 @@ void timer::set(uint64_t us) OS_NOEXCEPT
 void timer::set_from_isr(uint64_t us) OS_NOEXCEPT
 {
     timer::us = us;
+    t.args_wrp.period = (us / portTICK_PERIOD_MS) / 1'000;
+    t.args_wrp.rephase = false;
     if(t.handler && xTimerIsTimerActive( t.handler ))
     {
         xTimerChangePeriodFromISR(t.handler, (us / portTICK_PERIOD_MS) / 1'000, nullptr);
@@ -98,12 +174,45 @@ void timer::set_from_isr(uint64_t us) OS_NOEXCEPT
 
 void timer::start() const OS_NOEXCEPT
 {
-    if(t.handler)
+    if(t.handler && t.args_wrp.slack > 1)
+    {
+        // first expiration on a multiple of the largest power of two ticks within the slack, timers
+        // sharing the grid wake the timer task on the same tick
+        TickType_t grid = 1;
+        while(grid <= t.args_wrp.slack / 2)
+        {
+            grid <<= 1;
+        }
+
+        const TickType_t now = xTaskGetTickCount();
+        const TickType_t aligned = (now + t.args_wrp.period + grid - 1) & ~(grid - 1);
+        t.args_wrp.rephase = true;
+        xTimerChangePeriod(t.handler, aligned - now ? aligned - now : 1, portMAX_DELAY);
+    }
+    else if(t.handler && t.args_wrp.rephase)
+    {
+        // a one-shot start_at() left its offset as native period
+        t.args_wrp.rephase = false;
+        xTimerChangePeriod(t.handler, t.args_wrp.period, portMAX_DELAY);
+    }
+    else if(t.handler)
     {
         xTimerStart(t.handler, (us / portTICK_PERIOD_MS) / 1'000);
     }
 }
 
+void timer::start_at(tick deadline) const OS_NOEXCEPT
+{
+    if(t.handler && deadline != WAIT_FOREVER)
+    {
+        // native timers are relative: the first period ends at deadline, the auto-reload then keeps
+        // the schedule from the expected expiration time
+        const TickType_t first = ticks_until(deadline);
+        t.args_wrp.rephase = true;
+        xTimerChangePeriod(t.handler, first ? first : 1, portMAX_DELAY);
+    }
+}
+
 void timer::start_from_isr() const OS_NOEXCEPT
 {
     if(t.handler)
@@ -128,6 +237,65 @@ void timer::stop_from_isr() const OS_NOEXCEPT
     }
 }
 
+void timer::set_slack(uint64_t us) OS_NOEXCEPT
+{
+    t.args_wrp.slack = (us / portTICK_PERIOD_MS) / 1'000;
+}
+
+timer_service_stats timer::get_service_stats() OS_NOEXCEPT
+{
+    return {};
+}
+
+timer_stats& timer::get_global_stats() OS_NOEXCEPT
+{
+    static timer_stats global;
+    return global;
+}
+
+osal::exit timer::set_policy(timer_policy policy, error** error) OS_NOEXCEPT
+{
+    if(policy != timer_policy::CATCH_UP)
+    {
+        if(error)
+        {
+            *error = OS_ERROR_BUILD("FreeRTOS timers always catch up.", error_type::OS_EOPNOTSUPP);
+            OS_ERROR_PTR_SET_POSITION(*error);
+        }
+        return exit::KO;
+    }
+    return exit::OK;
+}
+
+uint32_t timer::overrun() const OS_NOEXCEPT
+{
+    return 0;
+}
+
+osal::exit timer::set_dispatch(timer_dispatch dispatch, error** error) OS_NOEXCEPT
+{
+    if(dispatch != timer_dispatch::INLINE)
+    {
+        if(error)
+        {
+            *error = OS_ERROR_BUILD("FreeRTOS timer handlers run on the timer task.", error_type::OS_EOPNOTSUPP);
+            OS_ERROR_PTR_SET_POSITION(*error);
+        }
+        return exit::KO;
+    }
+    return exit::OK;
+}
+
+uint64_t timer::coalesced() const OS_NOEXCEPT
+{
+    return 0;
+}
+
+uint64_t timer::dropped() const OS_NOEXCEPT
+{
+    return 0;
+}
+
 bool timer::is_active() const OS_NOEXCEPT
 {
     return t.handler && xTimerIsTimerActive( t.handler );
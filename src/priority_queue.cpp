@@ -0,0 +1,193 @@
+/***************************************************************************
+ * 
+ * OSAL
+ * Copyright (C) 2023/2024 Antonio Salsi <passy.linux@zresa.it>
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>. 
+ * 
+ ***************************************************************************/
+#include "osal/priority_queue.hpp"
+#include "osal/osal.hpp"
+
+#include <string.h>
+
+namespace osal
+{
+inline namespace v1
+{
+
+namespace
+{
+
+/**
+ * True when a must be fetched before b: higher priority first, then older first.
+ */
+template<typename Entry>
+inline bool before(const Entry& a, const Entry& b) OS_NOEXCEPT
+{
+    return a.priority != b.priority ? a.priority > b.priority : a.sequence < b.sequence;
+}
+
+}
+
+priority_queue::priority_queue(size_t size, size_t message_size, error** error) OS_NOEXCEPT
+    : m(error)
+    , slots(size, error)
+    , max_size(size)
+    , message_size(message_size)
+{
+    msg = new uint8_t[size * message_size];
+    heap = new entry[size];
+    free_slots = new size_t[size];
+    if (msg == nullptr || heap == nullptr || free_slots == nullptr)
+    {
+        if(error)
+        {
+            *error = OS_ERROR_BUILD("Out off memory.", error_type::OS_ENOMEM);
+            OS_ERROR_PTR_SET_POSITION(*error);
+        }
+        return;
+    }
+    memset(msg, 0, size * message_size);
+
+    for(size_t i = 0; i < size; i++)
+    {
+        free_slots[i] = size - 1 - i;
+    }
+}
+
+priority_queue::~priority_queue() OS_NOEXCEPT
+{
+    delete[] msg;
+    msg = nullptr;
+    delete[] heap;
+    heap = nullptr;
+    delete[] free_slots;
+    free_slots = nullptr;
+}
+
+osal::exit priority_queue::fetch(void* msg, uint64_t time, error** error) OS_NOEXCEPT
+{
+    return fetch_until(msg, deadline::from_ms(time), error);
+}
+
+osal::exit priority_queue::fetch_until(void* msg, tick deadline, error** error) OS_NOEXCEPT
+{
+    if(msg == nullptr)
+    {
+        if(error)
+        {
+            *error = OS_ERROR_BUILD("Invalid argument.", error_type::OS_EINVAL);
+            OS_ERROR_PTR_SET_POSITION(*error);
+        }
+        return exit::KO;
+    }
+
+    if(messages.wait_until(deadline, error) == exit::KO)
+    {
+        return exit::KO;
+    }
+
+    m.lock();
+
+    const entry top = heap[0];
+    memcpy(msg, this->msg + (top.slot * message_size), message_size);
+    free_slots[max_size - count] = top.slot;
+    count--;
+
+    // sift the last node down from the root
+    const entry last = heap[count];
+    size_t i = 0;
+    for(;;)
+    {
+        size_t child = 2 * i + 1;
+        if(child >= count)
+        {
+            break;
+        }
+        if(child + 1 < count && before(heap[child + 1], heap[child]))
+        {
+            child++;
+        }
+        if(!before(heap[child], last))
+        {
+            break;
+        }
+        heap[i] = heap[child];
+        i = child;
+    }
+    heap[i] = last;
+
+    m.unlock();
+    slots.signal();
+
+    return exit::OK;
+}
+
+osal::exit priority_queue::post(const uint8_t* msg, uint8_t priority, uint64_t time, error** error) OS_NOEXCEPT
+{
+    return post_until(msg, priority, deadline::from_ms(time), error);
+}
+
+osal::exit priority_queue::post_until(const uint8_t* msg, uint8_t priority, tick deadline, error** error) OS_NOEXCEPT
+{
+    if(msg == nullptr)
+    {
+        if(error)
+        {
+            *error = OS_ERROR_BUILD("Invalid argument.", error_type::OS_EINVAL);
+            OS_ERROR_PTR_SET_POSITION(*error);
+        }
+        return exit::KO;
+    }
+
+    if(slots.wait_until(deadline, error) == exit::KO)
+    {
+        return exit::KO;
+    }
+
+    m.lock();
+
+    const entry node{sequence++, free_slots[max_size - count - 1], priority};
+    memcpy(this->msg + (node.slot * message_size), msg, message_size);
+
+    // sift the new node up from the first free leaf
+    size_t i = count++;
+    while(i > 0)
+    {
+        const size_t parent = (i - 1) / 2;
+        if(!before(node, heap[parent]))
+        {
+            break;
+        }
+        heap[i] = heap[parent];
+        i = parent;
+    }
+    heap[i] = node;
+
+    m.unlock();
+    messages.signal();
+
+    return exit::OK;
+}
+
+size_t priority_queue::size() const OS_NOEXCEPT
+{
+    m.lock();
+    const size_t ret = count;
+    m.unlock();
+    return ret;
+}
+
+}
+}
@@ -17,7 +17,8 @@
  *
  ***************************************************************************/
 #include "osal/event.hpp"
-#include <pthread.h>
+#include "osal_sys/queue_set.hpp"
+#include "osal_sys/futex.hpp"
 
 namespace osal
 {
@@ -26,106 +27,58 @@ inline namespace v1
 
 event::event(error**) OS_NOEXCEPT
 {
-    pthread_mutexattr_t mattr{0};
-    pthread_condattr_t cattr{0};
-
-    pthread_condattr_init (&cattr);
-    pthread_condattr_setclock (&cattr, CLOCK_MONOTONIC);
-    pthread_cond_init (&e.cond, &cattr);
-    pthread_mutexattr_init (&mattr);
-    pthread_mutexattr_setprotocol (&mattr, PTHREAD_PRIO_INHERIT);
-    pthread_mutex_init (&e.mutex, &mattr);
-    e.flags = 0;
+
 }
 
 event::~event() OS_NOEXCEPT
 {
-    pthread_cond_destroy (&e.cond);
-    pthread_mutex_destroy (&e.mutex);
+
 }
 
 osal::exit event::wait(uint32_t mask, uint32_t& value, uint64_t time, error** _error) OS_NOEXCEPT
 {
-    struct timespec ts{0};
-    uint8_t error     = 0;
-    uint64_t nsec = (uint64_t)time * 1000 * 1000;
-
-
-    if (time != WAIT_FOREVER)
+    // the flags are checked first, the clock is read only when the call has to sleep
+    if (time != 0 && wait_until(mask, value, 0, nullptr) == exit::OK)
     {
-        clock_gettime (CLOCK_MONOTONIC, &ts);
-        nsec += ts.tv_nsec;
-
-        ts.tv_sec += nsec / NSECS_PER_SEC;
-        ts.tv_nsec = nsec % NSECS_PER_SEC;
+        return exit::OK;
     }
+    return wait_until(mask, value, deadline_from_ms(time), _error);
+}
 
-    pthread_mutex_lock (&e.mutex);
-
-    while ((e.flags & mask) == 0)
+osal::exit event::wait_until(uint32_t mask, uint32_t& value, tick deadline, error** _error) OS_NOEXCEPT
+{
+    timespec ts = timespec_from_tick(deadline);
+    // a waiter sleeps on its own bits only, set() of unrelated bits does not wake it
+    const uint32_t bitset = mask ? mask : FUTEX_BITSET_MATCH_ANY;
+    osal::exit ret = exit::OK;
+
+    // the waiter is counted before the flags are read, set() updates the flags before reading the
+    // count: with both seq_cst at least one of them sees the other, so no wake-up is lost
+    e.waiters.fetch_add(1, std::memory_order_seq_cst);
+    uint32_t flags = e.flags.load(std::memory_order_seq_cst);
+    while ((flags & mask) == 0)
     {
-        if (time != WAIT_FOREVER)
+        if (deadline == 0 || futex_wait(e.flags, flags, deadline != WAIT_FOREVER ? &ts : nullptr, bitset) == ETIMEDOUT)
         {
-            error = pthread_cond_timedwait (&e.cond, &e.mutex, &ts);
-            if (error)
+            flags = e.flags.load(std::memory_order_acquire);
+            if ((flags & mask) == 0)
             {
                 if(_error)
                 {
-                    switch (error_type(error))
-                    {
-                    case error_type::OS_ETIMEDOUT:
-                        *_error = OS_ERROR_BUILD("The time specified by abstime to pthread_cond_timedwait() has passed.", error_type::OS_ETIMEDOUT);
-                        OS_ERROR_PTR_SET_POSITION(*_error);
-                        break;
-                    case error_type::OS_EINVAL:
-                        *_error = OS_ERROR_BUILD("The value specified by abstime is invalid.", error_type::OS_EINVAL);
-                        OS_ERROR_PTR_SET_POSITION(*_error);
-                        break;
-                    case error_type::OS_EPERM:
-                        *_error = OS_ERROR_BUILD("The mutex was not owned by the current thread at the time of the call.", error_type::OS_EPERM);
-                        OS_ERROR_PTR_SET_POSITION(*_error);
-                        break;
-                    default:
-                        *_error = OS_ERROR_BUILD("Unmanaged error", error);
-                        OS_ERROR_PTR_SET_POSITION(*_error);
-                        break;
-                    }
+                    *_error = OS_ERROR_BUILD("Timeout expired.", error_type::OS_ETIMEDOUT);
+                    OS_ERROR_PTR_SET_POSITION(*_error);
                 }
-                goto timeout;
-            }
-        }
-        else
-        {
-            error = pthread_cond_wait (&e.cond, &e.mutex);
-            if (error)
-            {
-                if(_error)
-                {
-                    switch (error_type(error))
-                    {
-                    case error_type::OS_ETIMEDOUT:
-                        *_error = OS_ERROR_BUILD("The time specified by abstime to pthread_cond_timedwait() has passed.", error_type::OS_ETIMEDOUT);
-                        OS_ERROR_PTR_SET_POSITION(*_error);
-                        break;
-                    case error_type::OS_EINVAL:
-                        *_error = OS_ERROR_BUILD("The value specified by abstime is invalid.", error_type::OS_EINVAL);
-                        OS_ERROR_PTR_SET_POSITION(*_error);
-                        break;
-                    default:
-                        *_error = OS_ERROR_BUILD("Unmanaged error", error);
-                        OS_ERROR_PTR_SET_POSITION(*_error);
-                        break;
-                    }
-                }
-                goto timeout;
+                ret = exit::KO;
             }
+            break;
         }
+        // woken, or the flags changed before the futex call (EAGAIN), or a signal (EINTR)
+        flags = e.flags.load(std::memory_order_seq_cst);
     }
+    e.waiters.fetch_sub(1, std::memory_order_relaxed);
 
-timeout:
-    value = e.flags & mask;
-    pthread_mutex_unlock (&e.mutex);
-    return (error == 0) ? exit::OK : exit::KO;
+    value = flags & mask;
+    return ret;
 }
 
 inline osal::exit event::wait_from_isr(uint32_t mask, uint32_t& value, uint64_t time, error **error)
@@ -135,10 +88,13 @@ inline osal::exit event::wait_from_isr(uint32_t mask, uint32_t& value, uint64_t
 
 void event::set(uint32_t value)
 {
-    pthread_mutex_lock (&e.mutex);
-    e.flags |= value;
-    pthread_mutex_unlock (&e.mutex);
-    pthread_cond_signal (&e.cond);
+    // a single atomic OR while nobody waits, waiters of the raised bits are woken otherwise
+    const uint32_t raised = value & ~e.flags.fetch_or(value, std::memory_order_seq_cst);
+    if (raised && e.waiters.load(std::memory_order_seq_cst))
+    {
+        futex_wake(e.flags, INT_MAX, raised);
+    }
+    queue_set_notify(e.set);
 }
 
 inline void event::set_from_isr(uint32_t value)
@@ -148,12 +104,7 @@ inline void event::set_from_isr(uint32_t value)
 
 uint32_t event::get() OS_NOEXCEPT
 {
-    uint32_t ret = 0;
-    pthread_mutex_lock (&e.mutex);
-    ret = e.flags;
-    pthread_mutex_unlock (&e.mutex);
-    pthread_cond_signal (&e.cond);
-    return ret;
+    return e.flags.load(std::memory_order_acquire);
 }
 
 inline uint32_t event::get_from_isr() OS_NOEXCEPT
@@ -163,10 +114,8 @@ inline uint32_t event::get_from_isr() OS_NOEXCEPT
 
 void event::clear(uint32_t value)
 {
-    pthread_mutex_lock (&e.mutex);
-    e.flags &= ~value;
-    pthread_mutex_unlock (&e.mutex);
-    pthread_cond_signal (&e.cond);
+    // waiters sleep until bits are set, clearing never satisfies one of them
+    e.flags.fetch_and(~value, std::memory_order_release);
 }
 
 inline void event::clear_from_isr(uint32_t value)
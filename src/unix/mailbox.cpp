@@ -0,0 +1,178 @@
+/***************************************************************************
+ * 
+ * OSAL
+ * Copyright (C) 2023/2024 Antonio Salsi <passy.linux@zresa.it>
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>. 
+ * 
+ ***************************************************************************/
+#include "osal/mailbox.hpp"
+#include "osal_sys/futex.hpp"
+
+#include <sched.h>
+#include <string.h>
+
+namespace osal
+{
+inline namespace v1
+{
+
+mailbox::mailbox(size_t message_size, error** error) OS_NOEXCEPT
+{
+    m.msg = new uint8_t[message_size];
+    if (m.msg == nullptr)
+    {
+        if(error)
+        {
+            *error = OS_ERROR_BUILD("Out off memory.", error_type::OS_ENOMEM);
+            OS_ERROR_PTR_SET_POSITION(*error);
+        }
+        return;
+    }
+    memset(m.msg, 0, message_size);
+    m.message_size = message_size;
+}
+
+mailbox::~mailbox() OS_NOEXCEPT
+{
+    delete[] m.msg;
+    m.msg = nullptr;
+}
+
+osal::exit mailbox::overwrite(const uint8_t* msg, error** error) OS_NOEXCEPT
+{
+    if(msg == nullptr || m.msg == nullptr)
+    {
+        if(error)
+        {
+            *error = OS_ERROR_BUILD("Invalid argument.", error_type::OS_EINVAL);
+            OS_ERROR_PTR_SET_POSITION(*error);
+        }
+        return exit::KO;
+    }
+
+    // make the sequence odd: readers that overlap this write will retry
+    uint32_t sequence = m.sequence.load(std::memory_order_relaxed);
+    while ((sequence & 1) || !m.sequence.compare_exchange_weak(sequence, sequence + 1, std::memory_order_acquire, std::memory_order_relaxed))
+    {
+        if (sequence & 1)
+        {
+            sched_yield();
+            sequence = m.sequence.load(std::memory_order_relaxed);
+        }
+    }
+    std::atomic_thread_fence(std::memory_order_release);
+
+    memcpy(m.msg, msg, m.message_size);
+
+    // 0 means nothing written: the counter skips it when it wraps
+    const uint32_t next = sequence + 2;
+    m.sequence.store(next ? next : 2, std::memory_order_seq_cst);
+
+    // only the first write can find readers asleep, afterwards peek() never waits
+    if (m.waiters.load(std::memory_order_seq_cst))
+    {
+        futex_wake(m.sequence);
+    }
+
+    return exit::OK;
+}
+
+osal::exit mailbox::overwrite_from_isr(const uint8_t* msg, error** error) OS_NOEXCEPT
+{
+    return overwrite(msg, error);
+}
+
+osal::exit mailbox::peek(void* msg, uint64_t time, error** error) OS_NOEXCEPT
+{
+    // once a value is published peek never blocks, the clock is read only before the first one
+    if (time != 0 && peek_until(msg, 0, nullptr) == exit::OK)
+    {
+        return exit::OK;
+    }
+    return peek_until(msg, deadline_from_ms(time), error);
+}
+
+osal::exit mailbox::peek_until(void* msg, tick deadline, error** error) OS_NOEXCEPT
+{
+    timespec ts{0};
+
+    if(msg == nullptr || m.msg == nullptr)
+    {
+        if(error)
+        {
+            *error = OS_ERROR_BUILD("Invalid argument.", error_type::OS_EINVAL);
+            OS_ERROR_PTR_SET_POSITION(*error);
+        }
+        return exit::KO;
+    }
+
+    if (deadline != WAIT_FOREVER)
+    {
+        ts = timespec_from_tick(deadline);
+    }
+
+    for(;;)
+    {
+        const uint32_t before = m.sequence.load(std::memory_order_acquire);
+
+        if (before == 0)
+        {
+            // nothing written yet
+            if (deadline == 0)
+            {
+                break;
+            }
+
+            m.waiters.fetch_add(1, std::memory_order_seq_cst);
+            const int ret = futex_wait(m.sequence, 0, deadline != WAIT_FOREVER ? &ts : nullptr);
+            m.waiters.fetch_sub(1, std::memory_order_relaxed);
+
+            if (ret == ETIMEDOUT)
+            {
+                break;
+            }
+            continue;
+        }
+
+        if (before & 1)
+        {
+            // a write is in progress, let the writer finish
+            sched_yield();
+            continue;
+        }
+
+        memcpy(msg, m.msg, m.message_size);
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (m.sequence.load(std::memory_order_relaxed) == before)
+        {
+            return exit::OK;
+        }
+    }
+
+    if(error)
+    {
+        *error = OS_ERROR_BUILD("Timeout expired.", error_type::OS_ETIMEDOUT);
+        OS_ERROR_PTR_SET_POSITION(*error);
+    }
+    return exit::KO;
+}
+
+osal::exit mailbox::peek_from_isr(void* msg, uint64_t, error** error) OS_NOEXCEPT
+{
+    return peek(msg, 0, error);
+}
+
+}
+}
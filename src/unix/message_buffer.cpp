@@ -0,0 +1,320 @@
+/***************************************************************************
+ * 
+ * OSAL
+ * Copyright (C) 2023/2024 Antonio Salsi <passy.linux@zresa.it>
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>. 
+ * 
+ ***************************************************************************/
+#include "osal/message_buffer.hpp"
+#include "osal_sys/futex.hpp"
+
+#include <string.h>
+
+namespace osal
+{
+inline namespace v1
+{
+
+namespace
+{
+
+using length = uint32_t;    ///< Length prefix stored in front of every message.
+
+inline size_t wrap(const message_buffer_data& mb, size_t offset) OS_NOEXCEPT
+{
+    return offset >= mb.size ? offset - mb.size : offset;
+}
+
+/**
+ * Copy into the ring at offset, splitting the copy in two when it wraps.
+ */
+void copy_in(message_buffer_data& mb, size_t offset, const void* data, size_t size) OS_NOEXCEPT
+{
+    const size_t first = size < mb.size - offset ? size : mb.size - offset;
+    memcpy(mb.buffer + offset, data, first);
+    memcpy(mb.buffer, static_cast<const uint8_t*>(data) + first, size - first);
+}
+
+/**
+ * Copy out of the ring at offset, splitting the copy in two when it wraps.
+ */
+void copy_out(const message_buffer_data& mb, size_t offset, void* data, size_t size) OS_NOEXCEPT
+{
+    const size_t first = size < mb.size - offset ? size : mb.size - offset;
+    memcpy(data, mb.buffer + offset, first);
+    memcpy(static_cast<uint8_t*>(data) + first, mb.buffer, size - first);
+}
+
+/**
+ * Wait on cond until the predicate holds, mb.mutex must be held by the caller and is released on failure.
+ */
+template<typename Ready>
+osal::exit message_buffer_wait(message_buffer_data& mb, pthread_cond_t& cond, uint32_t& waiters, Ready ready, tick deadline, error** _error) OS_NOEXCEPT
+{
+    const timespec ts = timespec_from_tick(deadline);
+    int error = 0;
+
+    while (!ready())
+    {
+        waiters++;
+        if (deadline != WAIT_FOREVER)
+        {
+            error = pthread_cond_timedwait (&cond, &mb.mutex, &ts);
+        }
+        else
+        {
+            error = pthread_cond_wait (&cond, &mb.mutex);
+        }
+        waiters--;
+
+        if (error && !ready())
+        {
+            if(_error)
+            {
+                switch (error_type(error))
+                {
+                case error_type::OS_ETIMEDOUT:
+                    *_error = OS_ERROR_BUILD("The time specified by abstime to pthread_cond_timedwait() has passed.", error_type::OS_ETIMEDOUT);
+                    OS_ERROR_PTR_SET_POSITION(*_error);
+                    break;
+                case error_type::OS_EINVAL:
+                    *_error = OS_ERROR_BUILD("The value specified by abstime is invalid.", error_type::OS_EINVAL);
+                    OS_ERROR_PTR_SET_POSITION(*_error);
+                    break;
+                default:
+                    *_error = OS_ERROR_BUILD("Unmanaged error", error);
+                    OS_ERROR_PTR_SET_POSITION(*_error);
+                    break;
+                }
+            }
+            pthread_mutex_unlock (&mb.mutex);
+            return exit::KO;
+        }
+    }
+
+    return exit::OK;
+}
+
+}
+
+message_buffer::message_buffer(size_t size, error** error) OS_NOEXCEPT
+{
+    pthread_mutexattr_t mattr{0};
+    pthread_condattr_t cattr{0};
+
+    pthread_condattr_init (&cattr);
+    pthread_condattr_setclock (&cattr, CLOCK_MONOTONIC);
+    pthread_cond_init (&mb.not_empty, &cattr);
+    pthread_cond_init (&mb.not_full, &cattr);
+    pthread_mutexattr_init (&mattr);
+    pthread_mutexattr_setprotocol (&mattr, PTHREAD_PRIO_INHERIT);
+    pthread_mutex_init (&mb.mutex, &mattr);
+
+    if(size <= sizeof(length))
+    {
+        if(error)
+        {
+            *error = OS_ERROR_BUILD("Size must exceed the length prefix.", error_type::OS_EINVAL);
+            OS_ERROR_PTR_SET_POSITION(*error);
+        }
+        return;
+    }
+
+    mb.buffer = new uint8_t[size];
+    if(mb.buffer == nullptr)
+    {
+        if(error)
+        {
+            *error = OS_ERROR_BUILD("Out off memory.", error_type::OS_ENOMEM);
+            OS_ERROR_PTR_SET_POSITION(*error);
+        }
+        return;
+    }
+    mb.size = size;
+}
+
+message_buffer::~message_buffer() OS_NOEXCEPT
+{
+    pthread_cond_destroy (&mb.not_empty);
+    pthread_cond_destroy (&mb.not_full);
+    pthread_mutex_destroy (&mb.mutex);
+
+    delete[] mb.buffer;
+    mb.buffer = nullptr;
+}
+
+size_t message_buffer::send(const uint8_t* data, size_t size, uint64_t time, error** error) OS_NOEXCEPT
+{
+    return send_until(data, size, deadline_from_ms(time), error);
+}
+
+size_t message_buffer::send_until(const uint8_t* data, size_t size, tick deadline, error** error) OS_NOEXCEPT
+{
+    // an empty message would be received as 0, which stands for no message
+    if(mb.buffer == nullptr || data == nullptr || size == 0)
+    {
+        if(error)
+        {
+            *error = OS_ERROR_BUILD("Invalid argument.", error_type::OS_EINVAL);
+            OS_ERROR_PTR_SET_POSITION(*error);
+        }
+        return 0;
+    }
+
+    const size_t needed = sizeof(length) + size;
+    if(needed > mb.size)
+    {
+        if(error)
+        {
+            *error = OS_ERROR_BUILD("Message larger than the buffer.", error_type::OS_EMSGSIZE);
+            OS_ERROR_PTR_SET_POSITION(*error);
+        }
+        return 0;
+    }
+
+    pthread_mutex_lock (&mb.mutex);
+
+    if(message_buffer_wait(mb, mb.not_full, mb.send_waiters, [this, needed] { return mb.size - mb.count >= needed; }, deadline, error) == exit::KO)
+    {
+        return 0;
+    }
+
+    const length prefix = static_cast<length>(size);
+    const size_t w = wrap(mb, mb.r + mb.count);
+    copy_in(mb, w, &prefix, sizeof(prefix));
+    copy_in(mb, wrap(mb, w + sizeof(prefix)), data, size);
+    mb.count += needed;
+
+    const bool wake = mb.receive_waiters > 0;
+    pthread_mutex_unlock (&mb.mutex);
+    if(wake)
+    {
+        pthread_cond_signal (&mb.not_empty);
+    }
+
+    return size;
+}
+
+size_t message_buffer::send_from_isr(const uint8_t* data, size_t size, error** error) OS_NOEXCEPT
+{
+    return send_until(data, size, 0, error);
+}
+
+size_t message_buffer::receive(uint8_t* data, size_t size, uint64_t time, error** error) OS_NOEXCEPT
+{
+    return receive_until(data, size, deadline_from_ms(time), error);
+}
+
+size_t message_buffer::receive_until(uint8_t* data, size_t size, tick deadline, error** error) OS_NOEXCEPT
+{
+    if(mb.buffer == nullptr || (data == nullptr && size))
+    {
+        if(error)
+        {
+            *error = OS_ERROR_BUILD("Invalid argument.", error_type::OS_EINVAL);
+            OS_ERROR_PTR_SET_POSITION(*error);
+        }
+        return 0;
+    }
+
+    pthread_mutex_lock (&mb.mutex);
+
+    if(message_buffer_wait(mb, mb.not_empty, mb.receive_waiters, [this] { return mb.count > 0; }, deadline, error) == exit::KO)
+    {
+        return 0;
+    }
+
+    length prefix = 0;
+    copy_out(mb, mb.r, &prefix, sizeof(prefix));
+    if(prefix > size)
+    {
+        pthread_mutex_unlock (&mb.mutex);
+        if(error)
+        {
+            *error = OS_ERROR_BUILD("Buffer too small for the next message.", error_type::OS_EMSGSIZE);
+            OS_ERROR_PTR_SET_POSITION(*error);
+        }
+        return 0;
+    }
+
+    copy_out(mb, wrap(mb, mb.r + sizeof(prefix)), data, prefix);
+    mb.r = wrap(mb, mb.r + sizeof(prefix) + prefix);
+    mb.count -= sizeof(prefix) + prefix;
+
+    // senders wait for different amounts of room, let each of them check
+    const bool wake = mb.send_waiters > 0;
+    const bool more = mb.count > 0 && mb.receive_waiters > 0;
+    pthread_mutex_unlock (&mb.mutex);
+    if(wake)
+    {
+        pthread_cond_broadcast (&mb.not_full);
+    }
+    if(more)
+    {
+        pthread_cond_signal (&mb.not_empty);
+    }
+
+    return prefix;
+}
+
+size_t message_buffer::receive_from_isr(uint8_t* data, size_t size, error** error) OS_NOEXCEPT
+{
+    return receive_until(data, size, 0, error);
+}
+
+size_t message_buffer::next_size() const OS_NOEXCEPT
+{
+    length prefix = 0;
+
+    pthread_mutex_lock (&mb.mutex);
+    if(mb.count)
+    {
+        copy_out(mb, mb.r, &prefix, sizeof(prefix));
+    }
+    pthread_mutex_unlock (&mb.mutex);
+
+    return prefix;
+}
+
+void message_buffer::reset() OS_NOEXCEPT
+{
+    pthread_mutex_lock (&mb.mutex);
+    mb.r = 0;
+    mb.count = 0;
+    const bool wake = mb.send_waiters > 0;
+    pthread_mutex_unlock (&mb.mutex);
+    if(wake)
+    {
+        pthread_cond_broadcast (&mb.not_full);
+    }
+}
+
+bool message_buffer::is_empty() const OS_NOEXCEPT
+{
+    pthread_mutex_lock (&mb.mutex);
+    const bool ret = mb.count == 0;
+    pthread_mutex_unlock (&mb.mutex);
+    return ret;
+}
+
+size_t message_buffer::bytes_free() const OS_NOEXCEPT
+{
+    pthread_mutex_lock (&mb.mutex);
+    const size_t ret = mb.size - mb.count;
+    pthread_mutex_unlock (&mb.mutex);
+    return ret;
+}
+
+}
+}
@@ -17,6 +17,7 @@
  *
  ***************************************************************************/
 #include "osal/osal.hpp"
+#include "osal_sys/futex.hpp"
 
 #include <time.h>
 #include <signal.h>
@@ -83,6 +84,27 @@ tick tick_from_us (uint64_t us) OS_NOEXCEPT
     return static_cast<tick>(us) * 1'000;
 }
 
+tick deadline_from_ms(uint64_t time) OS_NOEXCEPT
+{
+    if (time == WAIT_FOREVER || time == 0)
+    {
+        return time;
+    }
+
+    return tick_current() + time * 1'000'000;
+}
+
+deadline deadline::from_ms(uint64_t time) OS_NOEXCEPT
+{
+    // same convention as the millisecond overloads: 0 is already expired, WAIT_FOREVER is kept
+    return deadline{deadline_from_ms(time)};
+}
+
+bool deadline::expired() const OS_NOEXCEPT
+{
+    return at != WAIT_FOREVER && tick_current() >= at;
+}
+
 void tick_sleep (tick tick) OS_NOEXCEPT
 {
     if(!main_loop_started)
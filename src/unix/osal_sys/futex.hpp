@@ -0,0 +1,178 @@
+/***************************************************************************
+ *
+ * OSAL
+ * Copyright (C) 2023/2024 Antonio Salsi <passy.linux@zresa.it>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ***************************************************************************/
+#pragma once
+
+#include "osal/error.hpp"
+#include "osal/types.hpp"
+#include "osal_sys/osal_sys.hpp"
+
+#include <atomic>
+#include <errno.h>
+#include <limits.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+namespace osal
+{
+inline namespace v1
+{
+
+/**
+ * @brief Converts an absolute tick into a CLOCK_MONOTONIC time point.
+ *
+ * @param deadline Absolute tick in nanoseconds, as returned by tick_current().
+ * @return The time point.
+ */
+inline timespec timespec_from_tick(tick deadline) OS_NOEXCEPT
+{
+    timespec ts{0};
+    ts.tv_sec = deadline / NSECS_PER_SEC;
+    ts.tv_nsec = deadline % NSECS_PER_SEC;
+    return ts;
+}
+
+/**
+ * @brief Sleeps while the futex word holds the expected value.
+ *
+ * @param word The futex word.
+ * @param expected The value the caller observed; the call returns at once if the word has changed.
+ * @param abs Absolute CLOCK_MONOTONIC timeout or nullptr to wait forever.
+ * @param bitset Wake-up mask, only a futex_wake() sharing at least one bit wakes the caller.
+ * @return 0 when woken, otherwise the errno value (ETIMEDOUT, EAGAIN or EINTR).
+ */
+inline int futex_wait(std::atomic<uint32_t>& word, uint32_t expected, const timespec* abs, uint32_t bitset = FUTEX_BITSET_MATCH_ANY) OS_NOEXCEPT
+{
+    long ret = syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAIT_BITSET_PRIVATE, expected, abs, nullptr, bitset);
+    return ret == -1 ? errno : 0;
+}
+
+/**
+ * @brief Wakes threads sleeping on the futex word.
+ *
+ * @param word The futex word.
+ * @param count Maximum number of threads to wake.
+ * @param bitset Only waiters whose mask shares at least one bit are woken.
+ */
+inline void futex_wake(std::atomic<uint32_t>& word, int count = INT_MAX, uint32_t bitset = FUTEX_BITSET_MATCH_ANY) OS_NOEXCEPT
+{
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAKE_BITSET_PRIVATE, count, nullptr, nullptr, bitset);
+}
+
+/**
+ * @brief Sleeps on one side of a single producer/single consumer ring until ready() holds.
+ *
+ * The waiting flag is raised before the ring is checked again, the other side publishes its index
+ * before reading the flag (spsc_notify()): the two seq_cst fences guarantee that at least one of
+ * them sees the other, so no wake-up is lost.
+ *
+ * @param waiting Futex word, non-zero while this side sleeps.
+ * @param ready Predicate re-checked after every wake-up.
+ * @param deadline Absolute tick, 0 to fail at once, or WAIT_FOREVER.
+ * @param _error Optional pointer to an error object to be populated on timeout.
+ * @param level Non-zero value stored in the futex word while sleeping, spsc_notify(waiting, available)
+ *              wakes the caller only once available reaches it.
+ * @return OK once ready() holds, KO on timeout.
+ */
+template<typename Ready>
+osal::exit spsc_wait(std::atomic<uint32_t>& waiting, Ready ready, tick deadline, error** _error, uint32_t level = 1) OS_NOEXCEPT
+{
+    timespec ts{0};
+
+    if (deadline == 0)
+    {
+        if(_error)
+        {
+            *_error = OS_ERROR_BUILD("Timeout expired.", error_type::OS_ETIMEDOUT);
+            OS_ERROR_PTR_SET_POSITION(*_error);
+        }
+        return exit::KO;
+    }
+
+    if (deadline != WAIT_FOREVER)
+    {
+        ts = timespec_from_tick(deadline);
+    }
+
+    while (true)
+    {
+        waiting.store(level, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (ready())
+        {
+            waiting.store(0, std::memory_order_relaxed);
+            return exit::OK;
+        }
+
+        int error = futex_wait(waiting, level, deadline != WAIT_FOREVER ? &ts : nullptr);
+        if (error == ETIMEDOUT)
+        {
+            waiting.store(0, std::memory_order_relaxed);
+            if (ready())
+            {
+                return exit::OK;
+            }
+            if(_error)
+            {
+                *_error = OS_ERROR_BUILD("Timeout expired.", error_type::OS_ETIMEDOUT);
+                OS_ERROR_PTR_SET_POSITION(*_error);
+            }
+            return exit::KO;
+        }
+        if (ready())
+        {
+            waiting.store(0, std::memory_order_relaxed);
+            return exit::OK;
+        }
+    }
+}
+
+/**
+ * @brief Wakes the other side of the ring if it raised its waiting flag.
+ *
+ * @param waiting Futex word of the side to wake.
+ */
+inline void spsc_notify(std::atomic<uint32_t>& waiting) OS_NOEXCEPT
+{
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (waiting.load(std::memory_order_relaxed) && waiting.exchange(0, std::memory_order_relaxed))
+    {
+        futex_wake(waiting, 1);
+    }
+}
+
+/**
+ * @brief Wakes the other side of the ring if it sleeps on a level that has been reached.
+ *
+ * @param waiting Futex word of the side to wake, holding the level passed to spsc_wait().
+ * @param available Amount now available to the sleeping side.
+ */
+inline void spsc_notify(std::atomic<uint32_t>& waiting, size_t available) OS_NOEXCEPT
+{
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    const uint32_t level = waiting.load(std::memory_order_relaxed);
+    if (level && available >= level && waiting.exchange(0, std::memory_order_relaxed))
+    {
+        futex_wake(waiting, 1);
+    }
+}
+
+}
+}
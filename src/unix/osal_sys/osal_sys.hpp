@@ -17,18 +17,28 @@
  *
  ***************************************************************************/
 #pragma once
+#include "osal/types.hpp"
+
 #include <stdlib.h>
 #include <stdint.h>
 #include <pthread.h>
 #include <time.h>
 
+#include <atomic>
+
 namespace osal
 {
 inline namespace v1
 {
 
+constexpr inline const size_t CACHE_LINE_SIZE = 64;
+
 class thread;
 class timer;
+class queue;
+class semaphore;
+class event;
+struct queue_set_data;
 
 using thread_data = pthread_t;
 using mutex_data = pthread_mutex_t;
@@ -38,19 +48,23 @@ struct semaphore_data
     pthread_cond_t cond{};
     pthread_mutex_t mutex{};
     size_t count = 0;
+    std::atomic<queue_set_data*> set{nullptr};  ///< Queue set notified by signal(), written by queue_set add()/remove().
 };
 
 struct event_data
 {
-    pthread_cond_t cond{};
-    pthread_mutex_t mutex{};
-    uint32_t flags = 0;
+    std::atomic<uint32_t> flags{0};     ///< Event bits, also the futex word the waiters sleep on.
+    std::atomic<uint32_t> waiters{0};   ///< Threads in wait_until(), set() skips the wake-up while 0.
+    std::atomic<queue_set_data*> set{nullptr};  ///< Queue set notified by set(), written by queue_set add()/remove().
 };
 
 struct queue_data
 {
-    pthread_cond_t cond{};
+    pthread_cond_t not_empty_cond{};    ///< LOCKED: waited by fetch() and acquire().
+    pthread_cond_t not_full_cond{};     ///< LOCKED: waited by post() and reserve().
     pthread_mutex_t mutex{};
+    uint32_t fetch_waiters = 0;         ///< LOCKED: threads sleeping on not_empty_cond, guarded by mutex.
+    uint32_t post_waiters = 0;          ///< LOCKED: threads sleeping on not_full_cond, guarded by mutex.
     size_t r = 0;
     size_t w = 0;
     size_t count = 0;
@@ -58,37 +72,134 @@ struct queue_data
     size_t message_size = 0;
     uint8_t* msg = nullptr;
     size_t buffer_size = 0;
+    bool reserved = false;      ///< LOCKED: slot w handed out by reserve() and not yet committed.
+    bool acquired = false;      ///< LOCKED: slot r handed out by acquire() and not yet released.
+
+    // queue_mode::SPSC: Lamport ring with one spare slot, head and tail wrap at size + 1
+    // queue_mode::MPMC: head and tail are free running positions claimed by CAS
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> head{0};   ///< Next slot to read.
+    size_t tail_cache = 0;                                  ///< SPSC consumer copy of tail, refreshed only when the ring looks empty.
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> tail{0};   ///< Next slot to write.
+    size_t head_cache = 0;                                  ///< SPSC producer copy of head, refreshed only when the ring looks full.
+    alignas(CACHE_LINE_SIZE) std::atomic<uint32_t> consumer_waiting{0}; ///< Futex word, SPSC: 1 while the consumer sleeps, MPMC: number of sleeping consumers.
+    std::atomic<uint32_t> producer_waiting{0};              ///< Futex word, SPSC: 1 while the producer sleeps, MPMC: number of sleeping producers.
+    std::atomic<uint32_t> not_empty{0};                     ///< MPMC futex word bumped when a message is published to sleeping consumers.
+    std::atomic<uint32_t> not_full{0};                      ///< MPMC futex word bumped when a slot is released to sleeping producers.
+    std::atomic<size_t>* sequence = nullptr;                ///< MPMC per-slot sequence: pos when free for the writer, pos + 1 when full.
+    std::atomic<uint8_t>* claim = nullptr;                  ///< MPMC per-slot zero-copy state: handed out by reserve(), by acquire() or neither.
+    std::atomic<queue_set_data*> set{nullptr};              ///< Queue set notified when a message is published.
+};
+
+struct mailbox_data
+{
+    alignas(CACHE_LINE_SIZE) std::atomic<uint32_t> sequence{0}; ///< Seqlock and futex word: odd while a write is in progress, 0 until the first write.
+    std::atomic<uint32_t> waiters{0};                           ///< Readers sleeping until the first write.
+    size_t message_size = 0;
+    uint8_t* msg = nullptr;
 };
 
+struct queue_set_member
+{
+    class queue* q = nullptr;
+    class semaphore* sem = nullptr;
+    class event* ev = nullptr;
+    uint32_t mask = 0;                      ///< Event bits that make ev ready.
+};
+
+struct queue_set_data
+{
+    std::atomic<uint32_t> ready{0};         ///< Futex word bumped by every notification.
+    std::atomic<uint32_t> waiters{0};       ///< Threads sleeping in select().
+    queue_set_member* members = nullptr;
+    size_t size = 0;
+    size_t count = 0;
+    size_t next = 0;                        ///< Member scanned first by the next select().
+};
+
+/**
+ * @brief Bytes reserved for the static_queue mutex, conditions and indices, checked in static_queue.cpp.
+ */
+constexpr inline const size_t STATIC_QUEUE_CONTROL_SIZE = sizeof(void*) * 32;
+
+struct static_queue_data
+{
+    alignas(void*) uint8_t control[STATIC_QUEUE_CONTROL_SIZE]{};   ///< Opaque storage, set up on first use so that static_queue stays constant-initializable.
+    std::atomic<uint8_t> state{0};                                  ///< 0 until first use, 1 while the control block is set up, 2 once ready.
+};
 
 struct stream_buffer_data
 {
-    pthread_cond_t cond{};
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> head{0};   ///< Free-running read index, advanced by the reader only.
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> tail{0};   ///< Free-running write index, advanced by the writer only.
+    alignas(CACHE_LINE_SIZE) std::atomic<uint32_t> reader_waiting{0}; ///< Futex word, the level the sleeping reader waits for, 0 while awake.
+    std::atomic<uint32_t> writer_waiting{0};                ///< Futex word, 1 while the writer sleeps on a full buffer.
+    std::atomic<uint32_t> event_level{0};                   ///< Level that signals event_fd, 0 while disarmed.
+    std::atomic<int> event_fd{-1};                          ///< eventfd created on demand by get_event_fd().
+    std::atomic<size_t> trigger_size{0};
+    size_t size = 0;                                        ///< Capacity in bytes, as requested.
+    size_t mask = 0;                                        ///< Storage size minus one, the storage is a power of two.
+    bool mirrored = false;                                  ///< Storage mapped twice, buffer spans 2 * (mask + 1) bytes.
+    uint8_t* buffer = nullptr;
+};
+
+struct message_buffer_data
+{
     pthread_mutex_t mutex{};
-    size_t trigger_size{};
-    size_t r = 0;
-    size_t w = 0;
-    size_t end = 0;
-    size_t count = 0;
+    pthread_cond_t not_empty{};                             ///< Waited by receivers while no message is stored.
+    pthread_cond_t not_full{};                              ///< Waited by senders while their message does not fit.
+    uint32_t receive_waiters = 0;                           ///< Threads sleeping on not_empty, guarded by mutex.
+    uint32_t send_waiters = 0;                              ///< Threads sleeping on not_full, guarded by mutex.
+    size_t r = 0;                                           ///< Offset of the oldest length prefix.
+    size_t count = 0;                                       ///< Bytes stored, length prefixes included.
     size_t size = 0;
     uint8_t* buffer = nullptr;
 };
 
 
+struct timer_wheel;
+
 struct timer_data
 {
-    timer_t timer_id{};
-    class thread* thread = nullptr;
-    pid_t thread_id{};
-    bool exit = false;
+    timer_data* next = nullptr;                 ///< Wheel slot links, guarded by the wheel mutex.
+    timer_data* prev = nullptr;
+    timer_data** slot = nullptr;                ///< Head of the list holding the timer, nullptr while disarmed.
+    timer_wheel* wheel = nullptr;               ///< Service shard, set by timer::create().
+    class timer* owner = nullptr;
     void* (*fn) (class timer*, void*) = nullptr;
     void* arg = nullptr;
-    uint32_t us = 0;
+    struct timer_stats* stats = nullptr;        ///< Histograms of the owner, fed on every handler call.
+    uint64_t expiry = 0;                        ///< Absolute CLOCK_MONOTONIC expiration in nanoseconds.
+    std::atomic<uint64_t> period{0};            ///< Interval in nanoseconds, set() may change it while the service re-arms.
+    std::atomic<uint64_t> slack{0};             ///< Tolerated delay in nanoseconds, lets the service batch wakeups.
+    uint32_t overrun = 0;                       ///< Expirations missed before the running inline handler call, written by the service.
     bool one_shot = true;
+    std::atomic<bool> catch_up{false};          ///< timer_policy::CATCH_UP, missed expirations are all dispatched.
+    std::atomic<bool> armed{false};             ///< Written under the wheel mutex, read by timer::is_active().
+    std::atomic<bool> pooled{false};            ///< timer_dispatch::POOL, handlers run on the worker pool.
+
+    timer_data* pool_next = nullptr;            ///< Worker pool FIFO link, the pool fields are guarded by the pool mutex.
+    uint32_t pool_overrun = 0;                  ///< Overrun handed to the next pooled call.
+    uint64_t pool_scheduled = 0;                ///< Scheduled expiration of the next pooled call.
+    bool queued = false;                        ///< Waiting in the pool FIFO.
+    bool busy = false;                          ///< Handler running on a worker.
+    bool again = false;                         ///< Expired while busy, queued again when the handler returns.
+    std::atomic<uint64_t> coalesced{0};         ///< Expirations merged into a call already queued or pending.
+    std::atomic<uint64_t> dropped{0};           ///< Queued calls discarded by stop().
 };
 
 using tick = uint64_t;
 
+/**
+ * @brief Builds the absolute tick reached after a relative timeout.
+ *
+ * A zero timeout maps to tick 0, already expired, without reading the clock. The relative calls
+ * of the lock-free primitives make a non-blocking attempt first and build the deadline only when
+ * that fails, so the clock stays off their fast path.
+ *
+ * @param time Timeout in milliseconds or WAIT_FOREVER.
+ * @return The absolute tick in nanoseconds, WAIT_FOREVER is kept as is.
+ */
+tick deadline_from_ms(uint64_t time) OS_NOEXCEPT;
 
 }
 }
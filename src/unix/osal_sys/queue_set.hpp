@@ -0,0 +1,52 @@
+/***************************************************************************
+ * 
+ * OSAL
+ * Copyright (C) 2023/2024 Antonio Salsi <passy.linux@zresa.it>
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>. 
+ * 
+ ***************************************************************************/
+#pragma once
+
+#include "osal_sys/futex.hpp"
+
+namespace osal
+{
+inline namespace v1
+{
+
+/**
+ * @brief Wakes one thread blocked in queue_set::select() on the set of a member, if any.
+ *
+ * Called by members after they became ready; a member outside any set is ignored.
+ *
+ * @param member_set The set field of the member.
+ */
+inline void queue_set_notify(std::atomic<queue_set_data*>& member_set) OS_NOEXCEPT
+{
+    queue_set_data* set = member_set.load(std::memory_order_acquire);
+    if(set == nullptr)
+    {
+        return;
+    }
+
+    // pairs with the waiters increment in select(): either the selector sees the new value or we see it sleeping
+    set->ready.fetch_add(1, std::memory_order_seq_cst);
+    if(set->waiters.load(std::memory_order_seq_cst))
+    {
+        futex_wake(set->ready, 1);
+    }
+}
+
+}
+}
@@ -0,0 +1,99 @@
+/***************************************************************************
+ * 
+ * OSAL
+ * Copyright (C) 2023/2024 Antonio Salsi <passy.linux@zresa.it>
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>. 
+ * 
+ ***************************************************************************/
+#pragma once
+
+namespace osal
+{
+inline namespace v1
+{
+
+/**
+ * @brief Waits for a message and copies it out of buffer.
+ *
+ * The mutex and conditions are set up on the first call made on the queue.
+ */
+osal::exit static_queue_fetch(static_queue_data& q, const uint8_t* buffer, size_t size, size_t message_size, void* msg, tick deadline, error** error) OS_NOEXCEPT;
+
+/**
+ * @brief Waits for a free slot and copies the message into buffer.
+ *
+ * The mutex and conditions are set up on the first call made on the queue.
+ */
+osal::exit static_queue_post(static_queue_data& q, uint8_t* buffer, size_t size, size_t message_size, const void* msg, tick deadline, error** error) OS_NOEXCEPT;
+
+/**
+ * @brief Returns the number of messages stored, 0 before the first call.
+ */
+size_t static_queue_size(static_queue_data& q) OS_NOEXCEPT;
+
+/**
+ * @brief Releases the mutex and conditions, if they were set up.
+ */
+void static_queue_delete(static_queue_data& q) OS_NOEXCEPT;
+
+template<typename T, size_t N>
+static_queue<T, N>::~static_queue() OS_NOEXCEPT
+{
+    static_queue_delete(q);
+}
+
+template<typename T, size_t N>
+osal::exit static_queue<T, N>::fetch(T& msg, uint64_t time, error** error) OS_NOEXCEPT
+{
+    return fetch_until(msg, deadline_from_ms(time), error);
+}
+
+template<typename T, size_t N>
+osal::exit static_queue<T, N>::fetch_until(T& msg, tick deadline, error** error) OS_NOEXCEPT
+{
+    return static_queue_fetch(q, buffer, N, sizeof(T), &msg, deadline, error);
+}
+
+template<typename T, size_t N>
+osal::exit static_queue<T, N>::fetch_from_isr(T& msg, uint64_t time, error** error) OS_NOEXCEPT
+{
+    return fetch(msg, time, error);
+}
+
+template<typename T, size_t N>
+osal::exit static_queue<T, N>::post(const T& msg, uint64_t time, error** error) OS_NOEXCEPT
+{
+    return post_until(msg, deadline_from_ms(time), error);
+}
+
+template<typename T, size_t N>
+osal::exit static_queue<T, N>::post_until(const T& msg, tick deadline, error** error) OS_NOEXCEPT
+{
+    return static_queue_post(q, buffer, N, sizeof(T), &msg, deadline, error);
+}
+
+template<typename T, size_t N>
+osal::exit static_queue<T, N>::post_from_isr(const T& msg, uint64_t time, error** error) OS_NOEXCEPT
+{
+    return post(msg, time, error);
+}
+
+template<typename T, size_t N>
+size_t static_queue<T, N>::size() const OS_NOEXCEPT
+{
+    return static_queue_size(q);
+}
+
+}
+}
@@ -0,0 +1,127 @@
+/***************************************************************************
+ * 
+ * OSAL
+ * Copyright (C) 2023/2024 Antonio Salsi <passy.linux@zresa.it>
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>. 
+ * 
+ ***************************************************************************/
+#pragma once
+
+#include "osal/error.hpp"
+#include "osal/thread.hpp"
+#include "osal/timer.hpp"
+
+#include <pthread.h>
+
+#ifndef OS_TIMER_SERVICE_THREADS
+#define OS_TIMER_SERVICE_THREADS (1)    ///< Number of wheels, each serviced by its own thread.
+#endif
+
+#ifndef OS_TIMER_WORKER_THREADS
+#define OS_TIMER_WORKER_THREADS (2)     ///< Threads of the pool running timer_dispatch::POOL handlers.
+#endif
+
+namespace osal
+{
+inline namespace v1
+{
+
+constexpr inline const size_t TIMER_WHEEL_LEVELS = 4;
+constexpr inline const size_t TIMER_WHEEL_BITS = 6;
+constexpr inline const size_t TIMER_WHEEL_SLOTS = 1 << TIMER_WHEEL_BITS;
+constexpr inline const uint64_t TIMER_WHEEL_TICK_NS = 1'000'000;
+
+/**
+ * @brief Hierarchical timing wheel shared by many timers and serviced by one thread.
+ *
+ * Level 0 holds the next 64 ticks one slot per tick, each further level covers 64 times the range
+ * of the previous one with 64 times coarser slots, so four levels of 1 ms ticks span about 4.6
+ * hours; farther timers are parked in the last slot and re-filed when it cascades. Slots are
+ * intrusive lists of timer_data, starting and stopping a timer is O(1) under the mutex. The
+ * service blocks in read() on an absolute timerfd: no signal, no polling period, and a timer armed
+ * earlier than the current wake just moves the timerfd. It sleeps until the earliest expiration
+ * plus the slack of its timer and serves every timer due by then in the same wakeup.
+ */
+struct timer_wheel
+{
+    pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+    pthread_cond_t idle;                        ///< Signalled when a handler returns.
+    int fd = -1;                                ///< CLOCK_MONOTONIC timerfd the service blocks on, armed at wake.
+    timer_data* slots[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS]{};
+    timer_data* expired = nullptr;              ///< Due timers whose handler has not run yet.
+    timer_data* running = nullptr;              ///< Timer whose handler is executing.
+    uint64_t origin = 0;                        ///< CLOCK_MONOTONIC nanoseconds of tick 0.
+    uint64_t current = 0;                       ///< First tick not fully processed yet.
+    uint64_t wake = 0;                          ///< Absolute nanoseconds the service sleeps until, WAIT_FOREVER if idle.
+    size_t count = 0;                           ///< Timers filed in the slots.
+    pthread_t service{};                        ///< Servicing thread, handlers run on it.
+    timer_service_stats stats{};
+    class thread worker;                        ///< "os_timer" service thread.
+
+    timer_wheel() OS_NOEXCEPT;
+};
+
+/**
+ * @brief Returns a wheel for a new timer, starting the service threads on first use.
+ *
+ * The wheels live in static storage and are never torn down, so timers with static storage
+ * duration can be destroyed at any point of the program exit.
+ *
+ * @param error Optional pointer to an error object to be populated in case of failure.
+ * @return The wheel, nullptr if the service could not be started.
+ */
+timer_wheel* timer_wheel_get(error** error) OS_NOEXCEPT;
+
+/**
+ * @brief Sums the counters of all the wheels.
+ *
+ * @return The counters, all 0 before the first timer is created.
+ */
+timer_service_stats timer_wheel_stats() OS_NOEXCEPT;
+
+/**
+ * @brief Starts the worker pool on first use.
+ *
+ * @param error Optional pointer to an error object to be populated in case of failure.
+ * @return OK once the workers run, KO if they could not be started.
+ */
+osal::exit timer_pool_start(error** error) OS_NOEXCEPT;
+
+/**
+ * @brief Arms or re-arms a timer to expire at an absolute time.
+ *
+ * @param t The timer, its wheel must be set.
+ * @param expiry Absolute CLOCK_MONOTONIC expiration in nanoseconds.
+ */
+void timer_wheel_start(timer_data& t, uint64_t expiry) OS_NOEXCEPT;
+
+/**
+ * @brief Returns the overrun of the handler call running on the calling thread.
+ *
+ * @param t The timer.
+ * @return The expirations merged into the pooled call when called by its worker, otherwise the
+ *         overrun of the last inline call.
+ */
+uint32_t timer_wheel_overrun(const timer_data& t) OS_NOEXCEPT;
+
+/**
+ * @brief Disarms a timer, a due or queued expiration whose handler has not started yet is dropped.
+ *
+ * @param t The timer.
+ * @param wait Also wait for a running handler of this timer to return, unless called by the handler itself.
+ */
+void timer_wheel_stop(timer_data& t, bool wait) OS_NOEXCEPT;
+
+}
+}
@@ -17,15 +17,495 @@
  *
  ***************************************************************************/
 #include "osal/queue.hpp"
+#include "osal_sys/futex.hpp"
+#include "osal_sys/queue_set.hpp"
+
+#include <string.h>
 
 namespace osal
 {
 inline namespace v1
 {
 
-queue::queue(size_t size, size_t message_size, error** error) OS_NOEXCEPT
+namespace
+{
+
+inline size_t spsc_next(const queue_data& q, size_t index) OS_NOEXCEPT
+{
+    return ++index == q.size + 1 ? 0 : index;
+}
+
+inline size_t spsc_distance(const queue_data& q, size_t from, size_t to) OS_NOEXCEPT
+{
+    return to >= from ? to - from : q.size + 1 - from + to;
+}
+
+osal::exit spsc_wait_readable(queue_data& q, size_t head, tick deadline, error** error) OS_NOEXCEPT
+{
+    if (head == q.tail_cache)
+    {
+        q.tail_cache = q.tail.load(std::memory_order_acquire);
+        if (head == q.tail_cache)
+        {
+            auto ready = [&q, head]
+            {
+                q.tail_cache = q.tail.load(std::memory_order_acquire);
+                return head != q.tail_cache;
+            };
+            return spsc_wait(q.consumer_waiting, ready, deadline, error);
+        }
+    }
+    return exit::OK;
+}
+
+osal::exit spsc_wait_writable(queue_data& q, size_t tail, tick deadline, error** error) OS_NOEXCEPT
+{
+    if (spsc_distance(q, q.head_cache, tail) == q.size)
+    {
+        q.head_cache = q.head.load(std::memory_order_acquire);
+        if (spsc_distance(q, q.head_cache, tail) == q.size)
+        {
+            auto ready = [&q, tail]
+            {
+                q.head_cache = q.head.load(std::memory_order_acquire);
+                return spsc_distance(q, q.head_cache, tail) != q.size;
+            };
+            return spsc_wait(q.producer_waiting, ready, deadline, error);
+        }
+    }
+    return exit::OK;
+}
+
+osal::exit spsc_fetch(queue_data& q, void* msg, tick deadline, error** error) OS_NOEXCEPT
+{
+    const size_t head = q.head.load(std::memory_order_relaxed);
+
+    if (spsc_wait_readable(q, head, deadline, error) == exit::KO)
+    {
+        return exit::KO;
+    }
+
+    memcpy(msg, q.msg + (head * q.message_size), q.message_size);
+
+    q.head.store(spsc_next(q, head), std::memory_order_release);
+    spsc_notify(q.producer_waiting);
+
+    return exit::OK;
+}
+
+osal::exit spsc_post(queue_data& q, const uint8_t* msg, tick deadline, error** error) OS_NOEXCEPT
+{
+    const size_t tail = q.tail.load(std::memory_order_relaxed);
+
+    if (spsc_wait_writable(q, tail, deadline, error) == exit::KO)
+    {
+        return exit::KO;
+    }
+
+    memcpy(q.msg + (tail * q.message_size), msg, q.message_size);
+
+    q.tail.store(spsc_next(q, tail), std::memory_order_release);
+    spsc_notify(q.consumer_waiting);
+    queue_set_notify(q.set);
+
+    return exit::OK;
+}
+
+size_t spsc_fetch_bulk(queue_data& q, uint8_t* msg, size_t max, tick deadline, error** error) OS_NOEXCEPT
+{
+    const size_t head = q.head.load(std::memory_order_relaxed);
+    const size_t slots = q.size + 1;
+
+    q.tail_cache = q.tail.load(std::memory_order_acquire);
+    if (spsc_wait_readable(q, head, deadline, error) == exit::KO)
+    {
+        return 0;
+    }
+
+    const size_t n = spsc_distance(q, head, q.tail_cache) < max ? spsc_distance(q, head, q.tail_cache) : max;
+    const size_t first = (slots - head) < n ? slots - head : n;
+
+    memcpy(msg, q.msg + (head * q.message_size), first * q.message_size);
+    memcpy(msg + (first * q.message_size), q.msg, (n - first) * q.message_size);
+
+    q.head.store((head + n) % slots, std::memory_order_release);
+    spsc_notify(q.producer_waiting);
+
+    return n;
+}
+
+size_t spsc_post_bulk(queue_data& q, const uint8_t* msg, size_t count, tick deadline, error** error) OS_NOEXCEPT
+{
+    const size_t tail = q.tail.load(std::memory_order_relaxed);
+    const size_t slots = q.size + 1;
+
+    q.head_cache = q.head.load(std::memory_order_acquire);
+    if (spsc_wait_writable(q, tail, deadline, error) == exit::KO)
+    {
+        return 0;
+    }
+
+    const size_t free = q.size - spsc_distance(q, q.head_cache, tail);
+    const size_t n = free < count ? free : count;
+    const size_t first = (slots - tail) < n ? slots - tail : n;
+
+    memcpy(q.msg + (tail * q.message_size), msg, first * q.message_size);
+    memcpy(q.msg, msg + (first * q.message_size), (n - first) * q.message_size);
+
+    q.tail.store((tail + n) % slots, std::memory_order_release);
+    spsc_notify(q.consumer_waiting);
+    queue_set_notify(q.set);
+
+    return n;
+}
+
+/**
+ * Sleep until the predicate holds. The waiter count is raised before the futex word is sampled and
+ * the ring is checked again, so a notifier that publishes after the check always bumps the word and
+ * the futex refuses to sleep on the stale value.
+ */
+template<typename Ready>
+osal::exit mpmc_wait(std::atomic<uint32_t>& word, std::atomic<uint32_t>& waiting, Ready ready, tick deadline, error** _error) OS_NOEXCEPT
+{
+    timespec ts{0};
+
+    if (deadline == 0)
+    {
+        if(_error)
+        {
+            *_error = OS_ERROR_BUILD("Timeout expired.", error_type::OS_ETIMEDOUT);
+            OS_ERROR_PTR_SET_POSITION(*_error);
+        }
+        return exit::KO;
+    }
+
+    if (deadline != WAIT_FOREVER)
+    {
+        ts = timespec_from_tick(deadline);
+    }
+
+    waiting.fetch_add(1, std::memory_order_seq_cst);
+    while (true)
+    {
+        const uint32_t key = word.load(std::memory_order_seq_cst);
+        if (ready())
+        {
+            waiting.fetch_sub(1, std::memory_order_relaxed);
+            return exit::OK;
+        }
+
+        if (futex_wait(word, key, deadline != WAIT_FOREVER ? &ts : nullptr) == ETIMEDOUT)
+        {
+            waiting.fetch_sub(1, std::memory_order_relaxed);
+            if (ready())
+            {
+                return exit::OK;
+            }
+            if(_error)
+            {
+                *_error = OS_ERROR_BUILD("Timeout expired.", error_type::OS_ETIMEDOUT);
+                OS_ERROR_PTR_SET_POSITION(*_error);
+            }
+            return exit::KO;
+        }
+    }
+}
+
+inline void mpmc_notify(std::atomic<uint32_t>& word, std::atomic<uint32_t>& waiting, int count = 1) OS_NOEXCEPT
+{
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (waiting.load(std::memory_order_relaxed))
+    {
+        word.fetch_add(1, std::memory_order_relaxed);
+        futex_wake(word, count);
+    }
+}
+
+bool mpmc_try_claim_read(queue_data& q, size_t& index) OS_NOEXCEPT
+{
+    size_t pos = q.head.load(std::memory_order_relaxed);
+
+    while (true)
+    {
+        index = pos % q.size;
+        const size_t seq = q.sequence[index].load(std::memory_order_acquire);
+        const intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+        if (diff == 0)
+        {
+            if (q.head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+            {
+                return true;
+            }
+        }
+        else if (diff < 0)
+        {
+            return false;
+        }
+        else
+        {
+            pos = q.head.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+bool mpmc_try_claim_write(queue_data& q, size_t& index) OS_NOEXCEPT
 {
-    q.buffer_size = size * message_size;
+    size_t pos = q.tail.load(std::memory_order_relaxed);
+
+    while (true)
+    {
+        index = pos % q.size;
+        const size_t seq = q.sequence[index].load(std::memory_order_acquire);
+        const intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+        if (diff == 0)
+        {
+            if (q.tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+            {
+                return true;
+            }
+        }
+        else if (diff < 0)
+        {
+            return false;
+        }
+        else
+        {
+            pos = q.tail.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+// zero-copy state of an MPMC slot, see queue_data::claim
+constexpr uint8_t SLOT_FREE = 0;
+constexpr uint8_t SLOT_RESERVED = 1;
+constexpr uint8_t SLOT_ACQUIRED = 2;
+
+/**
+ * Takes back a slot handed out by mpmc_reserve() or mpmc_acquire(): the state is cleared once, so
+ * a second commit or release, or a slot never handed out, is refused before it touches the
+ * sequence numbers.
+ */
+inline bool mpmc_unclaim(queue_data& q, size_t index, uint8_t state) OS_NOEXCEPT
+{
+    return q.claim[index].compare_exchange_strong(state, SLOT_FREE, std::memory_order_acq_rel, std::memory_order_relaxed);
+}
+
+// the claimed slot is owned by the caller, so its sequence still holds the claimed position
+inline void mpmc_release_slot(queue_data& q, size_t index) OS_NOEXCEPT
+{
+    q.sequence[index].store(q.sequence[index].load(std::memory_order_relaxed) - 1 + q.size, std::memory_order_release);
+}
+
+inline void mpmc_publish_slot(queue_data& q, size_t index) OS_NOEXCEPT
+{
+    q.sequence[index].store(q.sequence[index].load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+bool mpmc_try_fetch(queue_data& q, void* msg) OS_NOEXCEPT
+{
+    size_t index = 0;
+    if (!mpmc_try_claim_read(q, index))
+    {
+        return false;
+    }
+
+    memcpy(msg, q.msg + (index * q.message_size), q.message_size);
+    mpmc_release_slot(q, index);
+    return true;
+}
+
+bool mpmc_try_post(queue_data& q, const uint8_t* msg) OS_NOEXCEPT
+{
+    size_t index = 0;
+    if (!mpmc_try_claim_write(q, index))
+    {
+        return false;
+    }
+
+    memcpy(q.msg + (index * q.message_size), msg, q.message_size);
+    mpmc_publish_slot(q, index);
+    return true;
+}
+
+osal::exit mpmc_fetch_no_notify(queue_data& q, void* msg, tick deadline, error** error) OS_NOEXCEPT
+{
+    if (!mpmc_try_fetch(q, msg))
+    {
+        auto ready = [&q, msg] { return mpmc_try_fetch(q, msg); };
+        return mpmc_wait(q.not_empty, q.consumer_waiting, ready, deadline, error);
+    }
+    return exit::OK;
+}
+
+osal::exit mpmc_post_no_notify(queue_data& q, const uint8_t* msg, tick deadline, error** error) OS_NOEXCEPT
+{
+    if (!mpmc_try_post(q, msg))
+    {
+        auto ready = [&q, msg] { return mpmc_try_post(q, msg); };
+        return mpmc_wait(q.not_full, q.producer_waiting, ready, deadline, error);
+    }
+    return exit::OK;
+}
+
+osal::exit mpmc_fetch(queue_data& q, void* msg, tick deadline, error** error) OS_NOEXCEPT
+{
+    if (mpmc_fetch_no_notify(q, msg, deadline, error) == exit::KO)
+    {
+        return exit::KO;
+    }
+
+    mpmc_notify(q.not_full, q.producer_waiting);
+    return exit::OK;
+}
+
+osal::exit mpmc_post(queue_data& q, const uint8_t* msg, tick deadline, error** error) OS_NOEXCEPT
+{
+    if (mpmc_post_no_notify(q, msg, deadline, error) == exit::KO)
+    {
+        return exit::KO;
+    }
+
+    mpmc_notify(q.not_empty, q.consumer_waiting);
+
+    queue_set_notify(q.set);
+    return exit::OK;
+}
+
+size_t mpmc_fetch_bulk(queue_data& q, uint8_t* msg, size_t max, tick deadline, error** error) OS_NOEXCEPT
+{
+    size_t n = 0;
+
+    if (max == 0 || mpmc_fetch_no_notify(q, msg, deadline, error) == exit::KO)
+    {
+        return 0;
+    }
+
+    for (n = 1; n < max && mpmc_try_fetch(q, msg + (n * q.message_size)); n++);
+
+    mpmc_notify(q.not_full, q.producer_waiting, n);
+    return n;
+}
+
+size_t mpmc_post_bulk(queue_data& q, const uint8_t* msg, size_t count, tick deadline, error** error) OS_NOEXCEPT
+{
+    size_t n = 0;
+
+    if (count == 0 || mpmc_post_no_notify(q, msg, deadline, error) == exit::KO)
+    {
+        return 0;
+    }
+
+    for (n = 1; n < count && mpmc_try_post(q, msg + (n * q.message_size)); n++);
+
+    mpmc_notify(q.not_empty, q.consumer_waiting, n);
+
+    queue_set_notify(q.set);
+    return n;
+}
+
+uint8_t* mpmc_reserve(queue_data& q, tick deadline, error** error) OS_NOEXCEPT
+{
+    size_t index = 0;
+    if (!mpmc_try_claim_write(q, index))
+    {
+        auto ready = [&q, &index] { return mpmc_try_claim_write(q, index); };
+        if (mpmc_wait(q.not_full, q.producer_waiting, ready, deadline, error) == exit::KO)
+        {
+            return nullptr;
+        }
+    }
+    q.claim[index].store(SLOT_RESERVED, std::memory_order_release);
+    return q.msg + (index * q.message_size);
+}
+
+const uint8_t* mpmc_acquire(queue_data& q, tick deadline, error** error) OS_NOEXCEPT
+{
+    size_t index = 0;
+    if (!mpmc_try_claim_read(q, index))
+    {
+        auto ready = [&q, &index] { return mpmc_try_claim_read(q, index); };
+        if (mpmc_wait(q.not_empty, q.consumer_waiting, ready, deadline, error) == exit::KO)
+        {
+            return nullptr;
+        }
+    }
+    q.claim[index].store(SLOT_ACQUIRED, std::memory_order_release);
+    return q.msg + (index * q.message_size);
+}
+
+/**
+ * Tells whether slot points at the start of a message slot of the ring and returns its index.
+ */
+bool slot_index(const queue_data& q, const uint8_t* slot, size_t& index) OS_NOEXCEPT
+{
+    if (slot < q.msg || slot >= q.msg + q.buffer_size || (slot - q.msg) % q.message_size)
+    {
+        return false;
+    }
+    index = (slot - q.msg) / q.message_size;
+    return true;
+}
+
+/**
+ * Wait on cond until the predicate holds, q.mutex must be held by the caller.
+ * The sleeper is counted in waiters so that the other side signals only when somebody waits.
+ */
+template<typename Ready>
+uint8_t locked_wait(queue_data& q, pthread_cond_t& cond, uint32_t& waiters, Ready ready, tick deadline, const timespec& ts, error** _error) OS_NOEXCEPT
+{
+    uint8_t error = 0;
+
+    while (!ready())
+    {
+        waiters++;
+        if (deadline != WAIT_FOREVER)
+        {
+            error = pthread_cond_timedwait (&cond, &q.mutex, &ts);
+        }
+        else
+        {
+            error = pthread_cond_wait (&cond, &q.mutex);
+        }
+        waiters--;
+
+        if (error)
+        {
+            if(_error)
+            {
+                switch (error_type(error))
+                {
+                case error_type::OS_ETIMEDOUT:
+                    *_error = OS_ERROR_BUILD("The time specified by abstime to pthread_cond_timedwait() has passed.", error_type::OS_ETIMEDOUT);
+                    OS_ERROR_PTR_SET_POSITION(*_error);
+                    break;
+                case error_type::OS_EINVAL:
+                    *_error = OS_ERROR_BUILD("The value specified by abstime is invalid.", error_type::OS_EINVAL);
+                    OS_ERROR_PTR_SET_POSITION(*_error);
+                    break;
+                case error_type::OS_EPERM:
+                    *_error = OS_ERROR_BUILD("The mutex was not owned by the current thread at the time of the call.", error_type::OS_EPERM);
+                    OS_ERROR_PTR_SET_POSITION(*_error);
+                    break;
+                default:
+                    *_error = OS_ERROR_BUILD("Unmanaged error", error);
+                    OS_ERROR_PTR_SET_POSITION(*_error);
+                    break;
+                }
+            }
+            break;
+        }
+    }
+
+    return error;
+}
+
+}
+
+queue::queue(size_t size, size_t message_size, queue_mode mode, error** error) OS_NOEXCEPT
+    : mode(mode)
+{
+    // SPSC keeps one slot empty to tell a full ring from an empty one
+    q.buffer_size = (mode == queue_mode::SPSC ? size + 1 : size) * message_size;
 
     pthread_mutexattr_t mattr{0};
     pthread_condattr_t cattr{0};
@@ -42,9 +522,30 @@ queue::queue(size_t size, size_t message_size, error** error) OS_NOEXCEPT
     }
     memset(q.msg, 0, q.buffer_size);
 
+    if (mode == queue_mode::MPMC)
+    {
+        q.sequence = new std::atomic<size_t>[size];
+        q.claim = new std::atomic<uint8_t>[size];
+        if (q.sequence == nullptr || q.claim == nullptr)
+        {
+            if(error)
+            {
+                *error = OS_ERROR_BUILD("Out off memory.", error_type::OS_ENOMEM);
+                OS_ERROR_PTR_SET_POSITION(*error);
+            }
+            return;
+        }
+        for(size_t i = 0; i < size; i++)
+        {
+            q.sequence[i].store(i, std::memory_order_relaxed);
+            q.claim[i].store(SLOT_FREE, std::memory_order_relaxed);
+        }
+    }
+
     pthread_condattr_init (&cattr);
     pthread_condattr_setclock (&cattr, CLOCK_MONOTONIC);
-    pthread_cond_init (&q.cond, &cattr);
+    pthread_cond_init (&q.not_empty_cond, &cattr);
+    pthread_cond_init (&q.not_full_cond, &cattr);
     pthread_mutexattr_init (&mattr);
     pthread_mutexattr_setprotocol (&mattr, PTHREAD_PRIO_INHERIT);
     pthread_mutex_init (&q.mutex, &mattr);
@@ -59,7 +560,8 @@ queue::queue(size_t size, size_t message_size, error** error) OS_NOEXCEPT
 
 queue::~queue() OS_NOEXCEPT
 {
-    pthread_cond_destroy (&q.cond);
+    pthread_cond_destroy (&q.not_empty_cond);
+    pthread_cond_destroy (&q.not_full_cond);
     pthread_mutex_destroy (&q.mutex);
 
     if(q.msg)
@@ -71,13 +573,27 @@ queue::~queue() OS_NOEXCEPT
         delete[] q.msg;
         q.msg = nullptr;
     }
+
+    delete[] q.sequence;
+    q.sequence = nullptr;
+    delete[] q.claim;
+    q.claim = nullptr;
+}
+
+osal::exit queue::fetch(void* msg, uint64_t time, error** error) OS_NOEXCEPT
+{
+    // a non-blocking attempt first: the lock-free paths read the clock only when they have to block
+    if (time != 0 && fetch_until(msg, 0, nullptr) == exit::OK)
+    {
+        return exit::OK;
+    }
+    return fetch_until(msg, deadline_from_ms(time), error);
 }
 
-osal::exit queue::fetch(void* msg, uint64_t time, error** _error) OS_NOEXCEPT
+osal::exit queue::fetch_until(void* msg, tick deadline, error** _error) OS_NOEXCEPT
 {
     timespec ts{0};
     uint8_t error     = 0;
-    uint64_t nsec = (uint64_t)time * 1'000'000;
 
     if(msg == nullptr)
     {
@@ -89,190 +605,368 @@ osal::exit queue::fetch(void* msg, uint64_t time, error** _error) OS_NOEXCEPT
         return exit::KO;
     }
 
-
-    if (time != WAIT_FOREVER)
+    if(mode == queue_mode::SPSC)
     {
-        clock_gettime (CLOCK_MONOTONIC, &ts);
-        nsec += ts.tv_nsec;
+        return spsc_fetch(q, msg, deadline, _error);
+    }
+    else if(mode == queue_mode::MPMC)
+    {
+        return mpmc_fetch(q, msg, deadline, _error);
+    }
 
-        ts.tv_sec += nsec / NSECS_PER_SEC;
-        ts.tv_nsec = nsec % NSECS_PER_SEC;
+    if (deadline != WAIT_FOREVER)
+    {
+        ts = timespec_from_tick(deadline);
     }
 
     pthread_mutex_lock (&q.mutex);
 
-    while (q.count == 0)
+    error = locked_wait(q, q.not_empty_cond, q.fetch_waiters, [this] { return q.count > 0 && !q.acquired; }, deadline, ts, _error);
+    if (error == 0)
     {
-        if (time != WAIT_FOREVER)
-        {
-            error = pthread_cond_timedwait (&q.cond, &q.mutex, &ts);
-            if (error)
-            {
-                if(_error)
-                {
-                    switch (error_type(error))
-                    {
-                    case error_type::OS_ETIMEDOUT:
-                        *_error = OS_ERROR_BUILD("The time specified by abstime to pthread_cond_timedwait() has passed.", error_type::OS_ETIMEDOUT);
-                        OS_ERROR_PTR_SET_POSITION(*_error);
-                        break;
-                    case error_type::OS_EINVAL:
-                        *_error = OS_ERROR_BUILD("The value specified by abstime is invalid.", error_type::OS_EINVAL);
-                        OS_ERROR_PTR_SET_POSITION(*_error);
-                        break;
-                    case error_type::OS_EPERM:
-                        *_error = OS_ERROR_BUILD("The mutex was not owned by the current thread at the time of the call.", error_type::OS_EPERM);
-                        OS_ERROR_PTR_SET_POSITION(*_error);
-                        break;
-                    default:
-                        *_error = OS_ERROR_BUILD("Unmanaged error", error);
-                        OS_ERROR_PTR_SET_POSITION(*_error);
-                        break;
-                    }
-                }
-                goto timeout;
-            }
-        }
-        else
+        memset(msg, 0, q.message_size);
+        memcpy(msg, q.msg + ( q.r * q.message_size), q.message_size);
+
+        q.r++;
+
+        if (q.r == q.size)
+            q.r = 0;
+
+        q.count--;
+    }
+
+    const bool wake = error == 0 && q.post_waiters;
+    pthread_mutex_unlock (&q.mutex);
+    if (wake)
+    {
+        pthread_cond_signal (&q.not_full_cond);
+    }
+
+    return (error == 0) ? exit::OK : exit::KO;
+}
+
+exit queue::fetch_from_isr(void* msg, uint64_t time, error** error) OS_NOEXCEPT
+{
+    return fetch(msg, time, error);
+}
+
+osal::exit queue::fetch_bulk(void* msg, size_t max, size_t& got, uint64_t time, error** error) OS_NOEXCEPT
+{
+    if (time != 0 && fetch_bulk_until(msg, max, got, 0, nullptr) == exit::OK)
+    {
+        return exit::OK;
+    }
+    return fetch_bulk_until(msg, max, got, deadline_from_ms(time), error);
+}
+
+osal::exit queue::fetch_bulk_until(void* msg, size_t max, size_t& got, tick deadline, error** _error) OS_NOEXCEPT
+{
+    timespec ts{0};
+    uint8_t error     = 0;
+    auto buffer = static_cast<uint8_t*>(msg);
+
+    got = 0;
+    if(msg == nullptr || max == 0)
+    {
+        if(_error)
         {
-            error = pthread_cond_wait (&q.cond, &q.mutex);
-            if (error)
-            {
-                if(_error)
-                {
-                    switch (error_type(error))
-                    {
-                    case error_type::OS_ETIMEDOUT:
-                        *_error = OS_ERROR_BUILD("The time specified by abstime to pthread_cond_timedwait() has passed.", error_type::OS_ETIMEDOUT);
-                        OS_ERROR_PTR_SET_POSITION(*_error);
-                        break;
-                    case error_type::OS_EINVAL:
-                        *_error = OS_ERROR_BUILD("The value specified by abstime is invalid.", error_type::OS_EINVAL);
-                        OS_ERROR_PTR_SET_POSITION(*_error);
-                        break;
-                    default:
-                        *_error = OS_ERROR_BUILD("Unmanaged error", error);
-                        OS_ERROR_PTR_SET_POSITION(*_error);
-                        break;
-                    }
-                }
-                goto timeout;
-            }
+            *_error = OS_ERROR_BUILD("Invalid argument.", error_type::OS_EINVAL);
+            OS_ERROR_PTR_SET_POSITION(*_error);
         }
+        return exit::KO;
+    }
+
+    if(mode == queue_mode::SPSC)
+    {
+        got = spsc_fetch_bulk(q, buffer, max, deadline, _error);
+        return got ? exit::OK : exit::KO;
+    }
+    else if(mode == queue_mode::MPMC)
+    {
+        got = mpmc_fetch_bulk(q, buffer, max, deadline, _error);
+        return got ? exit::OK : exit::KO;
+    }
+
+    if (deadline != WAIT_FOREVER)
+    {
+        ts = timespec_from_tick(deadline);
+    }
+
+    pthread_mutex_lock (&q.mutex);
+
+    error = locked_wait(q, q.not_empty_cond, q.fetch_waiters, [this] { return q.count > 0 && !q.acquired; }, deadline, ts, _error);
+    if (error == 0)
+    {
+        got = q.count < max ? q.count : max;
+
+        // at most two copies: up to the end of the ring, then from its start
+        const size_t first = (q.size - q.r) < got ? q.size - q.r : got;
+        memcpy(buffer, q.msg + (q.r * q.message_size), first * q.message_size);
+        memcpy(buffer + (first * q.message_size), q.msg, (got - first) * q.message_size);
+
+        q.r = (q.r + got) % q.size;
+        q.count -= got;
+    }
+
+    const bool wake = got && q.post_waiters;
+    pthread_mutex_unlock (&q.mutex);
+    if (wake)
+    {
+        // several slots may have been released, let every producer recheck
+        pthread_cond_broadcast (&q.not_full_cond);
     }
 
-    memset(msg, 0, q.message_size);
-    if(q.count == 0)
+    return (error == 0) ? exit::OK : exit::KO;
+}
+
+osal::exit queue::post(const uint8_t* msg, uint64_t time, error** error) OS_NOEXCEPT
+{
+    if (time != 0 && post_until(msg, 0, nullptr) == exit::OK)
+    {
+        return exit::OK;
+    }
+    return post_until(msg, deadline_from_ms(time), error);
+}
+
+osal::exit queue::post_until(const uint8_t* msg, tick deadline, error** _error) OS_NOEXCEPT
+{
+    timespec ts{0};
+    uint8_t error     = 0;
+
+    if(msg == nullptr)
     {
         if(_error)
         {
-            *_error = OS_ERROR_BUILD("Message size 0.", error_type::OS_EUCLEAN);
+            *_error = OS_ERROR_BUILD("Invalid argument.", error_type::OS_EINVAL);
             OS_ERROR_PTR_SET_POSITION(*_error);
         }
         return exit::KO;
     }
 
-    memcpy(msg, q.msg + ( q.r * q.message_size), q.message_size);
+    if(mode == queue_mode::SPSC)
+    {
+        return spsc_post(q, msg, deadline, _error);
+    }
+    else if(mode == queue_mode::MPMC)
+    {
+        return mpmc_post(q, msg, deadline, _error);
+    }
 
-    q.r++;
+    if (deadline != WAIT_FOREVER)
+    {
+        ts = timespec_from_tick(deadline);
+    }
 
-    if (q.r == q.size)
-        q.r = 0;
+    pthread_mutex_lock (&q.mutex);
 
-    q.count--;
+    error = locked_wait(q, q.not_full_cond, q.post_waiters, [this] { return q.count < q.size && !q.reserved; }, deadline, ts, _error);
+    if (error == 0)
+    {
+        memcpy(q.msg + (q.w * q.message_size), msg, q.message_size);
+
+        q.w++;
+
+        if (q.w == q.size)
+            q.w = 0;
 
-timeout:
+        q.count++;
+    }
+
+    const bool wake = error == 0 && q.fetch_waiters;
     pthread_mutex_unlock (&q.mutex);
-    pthread_cond_signal (&q.cond);
+    if (wake)
+    {
+        pthread_cond_signal (&q.not_empty_cond);
+    }
+    if (error == 0)
+    {
+        queue_set_notify(q.set);
+    }
 
     return (error == 0) ? exit::OK : exit::KO;
 }
 
-inline exit queue::fetch_from_isr(void* msg, uint64_t time, error** error) OS_NOEXCEPT
+exit queue::post_from_isr(const uint8_t* msg, uint64_t time, error** error) OS_NOEXCEPT
 {
-    return fetch(msg, time, error);
+    return post(msg, time, error);
 }
 
-osal::exit queue::post(const uint8_t* msg, uint64_t time, error** _error) OS_NOEXCEPT
+size_t queue::post_bulk(const uint8_t* msg, size_t count, uint64_t time, error** error) OS_NOEXCEPT
+{
+    const size_t posted = time != 0 ? post_bulk_until(msg, count, 0, nullptr) : 0;
+    if (posted)
+    {
+        return posted;
+    }
+    return post_bulk_until(msg, count, deadline_from_ms(time), error);
+}
+
+size_t queue::post_bulk_until(const uint8_t* msg, size_t count, tick deadline, error** _error) OS_NOEXCEPT
 {
     timespec ts{0};
     uint8_t error     = 0;
-    uint64_t nsec = (uint64_t)time * 1000 * 1000;
+    size_t posted = 0;
+
+    if(msg == nullptr || count == 0)
+    {
+        if(_error)
+        {
+            *_error = OS_ERROR_BUILD("Invalid argument.", error_type::OS_EINVAL);
+            OS_ERROR_PTR_SET_POSITION(*_error);
+        }
+        return 0;
+    }
+
+    if(mode == queue_mode::SPSC)
+    {
+        return spsc_post_bulk(q, msg, count, deadline, _error);
+    }
+    else if(mode == queue_mode::MPMC)
+    {
+        return mpmc_post_bulk(q, msg, count, deadline, _error);
+    }
+
+    if (deadline != WAIT_FOREVER)
+    {
+        ts = timespec_from_tick(deadline);
+    }
+
+    pthread_mutex_lock (&q.mutex);
+
+    error = locked_wait(q, q.not_full_cond, q.post_waiters, [this] { return q.count < q.size && !q.reserved; }, deadline, ts, _error);
+    if (error == 0)
+    {
+        posted = (q.size - q.count) < count ? q.size - q.count : count;
+
+        // at most two copies: up to the end of the ring, then from its start
+        const size_t first = (q.size - q.w) < posted ? q.size - q.w : posted;
+        memcpy(q.msg + (q.w * q.message_size), msg, first * q.message_size);
+        memcpy(q.msg, msg + (first * q.message_size), (posted - first) * q.message_size);
+
+        q.w = (q.w + posted) % q.size;
+        q.count += posted;
+    }
+
+    const bool wake = posted && q.fetch_waiters;
+    pthread_mutex_unlock (&q.mutex);
+    if (wake)
+    {
+        // several messages may have been published, let every consumer recheck
+        pthread_cond_broadcast (&q.not_empty_cond);
+    }
+    if (posted)
+    {
+        queue_set_notify(q.set);
+    }
+
+    return posted;
+}
+
+uint8_t* queue::reserve(uint64_t time, error** error) OS_NOEXCEPT
+{
+    uint8_t* const slot = time != 0 ? reserve_until(0, nullptr) : nullptr;
+    if (slot)
+    {
+        return slot;
+    }
+    return reserve_until(deadline_from_ms(time), error);
+}
 
+uint8_t* queue::reserve_until(tick deadline, error** _error) OS_NOEXCEPT
+{
+    timespec ts{0};
+    uint8_t* slot = nullptr;
 
-    if (time != WAIT_FOREVER)
+    if(mode == queue_mode::SPSC)
     {
-        clock_gettime (CLOCK_MONOTONIC, &ts);
-        nsec += ts.tv_nsec;
+        const size_t tail = q.tail.load(std::memory_order_relaxed);
+        return spsc_wait_writable(q, tail, deadline, _error) == exit::OK ? q.msg + (tail * q.message_size) : nullptr;
+    }
+    else if(mode == queue_mode::MPMC)
+    {
+        return mpmc_reserve(q, deadline, _error);
+    }
 
-        ts.tv_sec += nsec / NSECS_PER_SEC;
-        ts.tv_nsec = nsec % NSECS_PER_SEC;
+    if (deadline != WAIT_FOREVER)
+    {
+        ts = timespec_from_tick(deadline);
     }
 
     pthread_mutex_lock (&q.mutex);
 
-    while (q.count == q.size)
+    if (locked_wait(q, q.not_full_cond, q.post_waiters, [this] { return q.count < q.size && !q.reserved; }, deadline, ts, _error) == 0)
+    {
+        q.reserved = true;
+        slot = q.msg + (q.w * q.message_size);
+    }
+
+    pthread_mutex_unlock (&q.mutex);
+
+    return slot;
+}
+
+osal::exit queue::commit(uint8_t* slot, error** error) OS_NOEXCEPT
+{
+    size_t index = 0;
+
+    if(slot == nullptr || !slot_index(q, slot, index))
+    {
+        if(error)
+        {
+            *error = OS_ERROR_BUILD("Invalid argument.", error_type::OS_EINVAL);
+            OS_ERROR_PTR_SET_POSITION(*error);
+        }
+        return exit::KO;
+    }
+
+    if(mode == queue_mode::SPSC)
     {
-        if (time != WAIT_FOREVER)
+        const size_t tail = q.tail.load(std::memory_order_relaxed);
+        if(index != tail)
         {
-            error = pthread_cond_timedwait (&q.cond, &q.mutex, &ts);
-            if (error)
+            if(error)
             {
-                if(_error)
-                {
-                    switch (error_type(error))
-                    {
-                    case error_type::OS_ETIMEDOUT:
-                        *_error = OS_ERROR_BUILD("The time specified by abstime to pthread_cond_timedwait() has passed.", error_type::OS_ETIMEDOUT);
-                        OS_ERROR_PTR_SET_POSITION(*_error);
-                        break;
-                    case error_type::OS_EINVAL:
-                        *_error = OS_ERROR_BUILD("The value specified by abstime is invalid.", error_type::OS_EINVAL);
-                        OS_ERROR_PTR_SET_POSITION(*_error);
-                        break;
-                    case error_type::OS_EPERM:
-                        *_error = OS_ERROR_BUILD("The mutex was not owned by the current thread at the time of the call.", error_type::OS_EPERM);
-                        OS_ERROR_PTR_SET_POSITION(*_error);
-                        break;
-                    default:
-                        *_error = OS_ERROR_BUILD("Unmanaged error", error);
-                        OS_ERROR_PTR_SET_POSITION(*_error);
-                        break;
-                    }
-                }
-                goto timeout;
+                *error = OS_ERROR_BUILD("Slot not reserved.", error_type::OS_EINVAL);
+                OS_ERROR_PTR_SET_POSITION(*error);
             }
+            return exit::KO;
         }
-        else
+        q.tail.store(spsc_next(q, tail), std::memory_order_release);
+        spsc_notify(q.consumer_waiting);
+        queue_set_notify(q.set);
+        return exit::OK;
+    }
+    else if(mode == queue_mode::MPMC)
+    {
+        if(!mpmc_unclaim(q, index, SLOT_RESERVED))
         {
-            error = pthread_cond_wait (&q.cond, &q.mutex);
-            if (error)
+            if(error)
             {
-                if(_error)
-                {
-                    switch (error_type(error))
-                    {
-                    case error_type::OS_ETIMEDOUT:
-                        *_error = OS_ERROR_BUILD("The time specified by abstime to pthread_cond_timedwait() has passed.", error_type::OS_ETIMEDOUT);
-                        OS_ERROR_PTR_SET_POSITION(*_error);
-                        break;
-                    case error_type::OS_EINVAL:
-                        *_error = OS_ERROR_BUILD("The value specified by abstime is invalid.", error_type::OS_EINVAL);
-                        OS_ERROR_PTR_SET_POSITION(*_error);
-                        break;
-                    default:
-                        *_error = OS_ERROR_BUILD("Unmanaged error", error);
-                        OS_ERROR_PTR_SET_POSITION(*_error);
-                        break;
-                    }
-                }
-                goto timeout;
+                *error = OS_ERROR_BUILD("Slot not reserved.", error_type::OS_EINVAL);
+                OS_ERROR_PTR_SET_POSITION(*error);
             }
+            return exit::KO;
         }
+        mpmc_publish_slot(q, index);
+        mpmc_notify(q.not_empty, q.consumer_waiting);
+        queue_set_notify(q.set);
+        return exit::OK;
     }
 
-    memcpy(q.msg + (q.w * q.message_size), msg, q.message_size);
+    pthread_mutex_lock (&q.mutex);
+
+    if(!q.reserved || index != q.w)
+    {
+        pthread_mutex_unlock (&q.mutex);
+        if(error)
+        {
+            *error = OS_ERROR_BUILD("Slot not reserved.", error_type::OS_EINVAL);
+            OS_ERROR_PTR_SET_POSITION(*error);
+        }
+        return exit::KO;
+    }
 
+    q.reserved = false;
     q.w++;
 
     if (q.w == q.size)
@@ -280,22 +974,169 @@ osal::exit queue::post(const uint8_t* msg, uint64_t time, error** _error) OS_NOE
 
     q.count++;
 
-timeout:
+    // a consumer may wait for the message and a producer may have been held back by the reservation
+    const bool wake_consumer = q.fetch_waiters;
+    const bool wake_producer = q.post_waiters && q.count < q.size;
     pthread_mutex_unlock (&q.mutex);
-    pthread_cond_signal (&q.cond);
+    if (wake_consumer)
+    {
+        pthread_cond_signal (&q.not_empty_cond);
+    }
+    if (wake_producer)
+    {
+        pthread_cond_signal (&q.not_full_cond);
+    }
+    queue_set_notify(q.set);
 
-    return (error == 0) ? exit::OK : exit::KO;
+    return exit::OK;
 }
 
-inline exit queue::post_from_isr(const uint8_t* msg, uint64_t time, error** error) OS_NOEXCEPT
+const uint8_t* queue::acquire(uint64_t time, error** error) OS_NOEXCEPT
 {
-    return post(msg, time, error);
+    const uint8_t* const slot = time != 0 ? acquire_until(0, nullptr) : nullptr;
+    if (slot)
+    {
+        return slot;
+    }
+    return acquire_until(deadline_from_ms(time), error);
+}
+
+const uint8_t* queue::acquire_until(tick deadline, error** _error) OS_NOEXCEPT
+{
+    timespec ts{0};
+    const uint8_t* slot = nullptr;
+
+    if(mode == queue_mode::SPSC)
+    {
+        const size_t head = q.head.load(std::memory_order_relaxed);
+        return spsc_wait_readable(q, head, deadline, _error) == exit::OK ? q.msg + (head * q.message_size) : nullptr;
+    }
+    else if(mode == queue_mode::MPMC)
+    {
+        return mpmc_acquire(q, deadline, _error);
+    }
+
+    if (deadline != WAIT_FOREVER)
+    {
+        ts = timespec_from_tick(deadline);
+    }
+
+    pthread_mutex_lock (&q.mutex);
+
+    if (locked_wait(q, q.not_empty_cond, q.fetch_waiters, [this] { return q.count > 0 && !q.acquired; }, deadline, ts, _error) == 0)
+    {
+        q.acquired = true;
+        slot = q.msg + (q.r * q.message_size);
+    }
+
+    pthread_mutex_unlock (&q.mutex);
+
+    return slot;
+}
+
+osal::exit queue::release(const uint8_t* slot, error** error) OS_NOEXCEPT
+{
+    size_t index = 0;
+
+    if(slot == nullptr || !slot_index(q, slot, index))
+    {
+        if(error)
+        {
+            *error = OS_ERROR_BUILD("Invalid argument.", error_type::OS_EINVAL);
+            OS_ERROR_PTR_SET_POSITION(*error);
+        }
+        return exit::KO;
+    }
+
+    if(mode == queue_mode::SPSC)
+    {
+        const size_t head = q.head.load(std::memory_order_relaxed);
+        if(index != head)
+        {
+            if(error)
+            {
+                *error = OS_ERROR_BUILD("Slot not acquired.", error_type::OS_EINVAL);
+                OS_ERROR_PTR_SET_POSITION(*error);
+            }
+            return exit::KO;
+        }
+        q.head.store(spsc_next(q, head), std::memory_order_release);
+        spsc_notify(q.producer_waiting);
+        return exit::OK;
+    }
+    else if(mode == queue_mode::MPMC)
+    {
+        if(!mpmc_unclaim(q, index, SLOT_ACQUIRED))
+        {
+            if(error)
+            {
+                *error = OS_ERROR_BUILD("Slot not acquired.", error_type::OS_EINVAL);
+                OS_ERROR_PTR_SET_POSITION(*error);
+            }
+            return exit::KO;
+        }
+        mpmc_release_slot(q, index);
+        mpmc_notify(q.not_full, q.producer_waiting);
+        return exit::OK;
+    }
+
+    pthread_mutex_lock (&q.mutex);
+
+    if(!q.acquired || index != q.r)
+    {
+        pthread_mutex_unlock (&q.mutex);
+        if(error)
+        {
+            *error = OS_ERROR_BUILD("Slot not acquired.", error_type::OS_EINVAL);
+            OS_ERROR_PTR_SET_POSITION(*error);
+        }
+        return exit::KO;
+    }
+
+    q.acquired = false;
+    q.r++;
+
+    if (q.r == q.size)
+        q.r = 0;
+
+    q.count--;
+
+    // a producer may wait for the slot and a consumer may have been held back by the acquisition
+    const bool wake_producer = q.post_waiters;
+    const bool wake_consumer = q.fetch_waiters && q.count > 0;
+    pthread_mutex_unlock (&q.mutex);
+    if (wake_producer)
+    {
+        pthread_cond_signal (&q.not_full_cond);
+    }
+    if (wake_consumer)
+    {
+        pthread_cond_signal (&q.not_empty_cond);
+    }
+
+    return exit::OK;
 }
 
 size_t queue::size() const OS_NOEXCEPT
 {
+    if(mode == queue_mode::SPSC)
+    {
+        const size_t head = q.head.load(std::memory_order_acquire);
+        const size_t tail = q.tail.load(std::memory_order_acquire);
+        return tail >= head ? tail - head : q.size + 1 - head + tail;
+    }
+    else if(mode == queue_mode::MPMC)
+    {
+        const size_t head = q.head.load(std::memory_order_acquire);
+        const size_t tail = q.tail.load(std::memory_order_acquire);
+        return tail > head ? tail - head : 0;
+    }
 
-    return q.count;
+    // count is written under the mutex only, queue_set::select() probes it from other threads
+    pthread_mutex_lock (&q.mutex);
+    const size_t ret = q.count;
+    pthread_mutex_unlock (&q.mutex);
+    return ret;
 }
 
 }
@@ -0,0 +1,281 @@
+/***************************************************************************
+ * 
+ * OSAL
+ * Copyright (C) 2023/2024 Antonio Salsi <passy.linux@zresa.it>
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>. 
+ * 
+ ***************************************************************************/
+#include "osal/queue_set.hpp"
+#include "osal/event.hpp"
+#include "osal/queue.hpp"
+#include "osal/semaphore.hpp"
+#include "osal_sys/queue_set.hpp"
+
+namespace osal
+{
+inline namespace v1
+{
+
+namespace
+{
+
+/**
+ * Probe a semaphore under its own lock, signal() and wait() update the count with plain accesses.
+ */
+bool semaphore_ready(semaphore_data& sem) OS_NOEXCEPT
+{
+    pthread_mutex_lock (&sem.mutex);
+    const bool ready = sem.count > 0;
+    pthread_mutex_unlock (&sem.mutex);
+    return ready;
+}
+
+/**
+ * Append a member, the caller has checked that the object does not belong to a set.
+ */
+osal::exit queue_set_append(queue_set_data& s, const queue_set_member& member, error** error) OS_NOEXCEPT
+{
+    if(s.count == s.size)
+    {
+        if(error)
+        {
+            *error = OS_ERROR_BUILD("Queue set full.", error_type::OS_ENOSPC);
+            OS_ERROR_PTR_SET_POSITION(*error);
+        }
+        return exit::KO;
+    }
+
+    s.members[s.count++] = member;
+    return exit::OK;
+}
+
+/**
+ * Drop the member matching pred, the last member takes its place.
+ */
+template<typename Match>
+osal::exit queue_set_erase(queue_set_data& s, Match match, error** error) OS_NOEXCEPT
+{
+    for(size_t i = 0; i < s.count; i++)
+    {
+        if(match(s.members[i]))
+        {
+            s.members[i] = s.members[--s.count];
+            return exit::OK;
+        }
+    }
+
+    if(error)
+    {
+        *error = OS_ERROR_BUILD("Not a member of the queue set.", error_type::OS_ENOENT);
+        OS_ERROR_PTR_SET_POSITION(*error);
+    }
+    return exit::KO;
+}
+
+osal::exit queue_set_busy(error** error) OS_NOEXCEPT
+{
+    if(error)
+    {
+        *error = OS_ERROR_BUILD("Already member of a queue set.", error_type::OS_EEXIST);
+        OS_ERROR_PTR_SET_POSITION(*error);
+    }
+    return exit::KO;
+}
+
+}
+
+queue_set::queue_set(size_t size, error** error) OS_NOEXCEPT
+{
+    s.members = new queue_set_member[size];
+    if (s.members == nullptr)
+    {
+        if(error)
+        {
+            *error = OS_ERROR_BUILD("Out off memory.", error_type::OS_ENOMEM);
+            OS_ERROR_PTR_SET_POSITION(*error);
+        }
+        return;
+    }
+    s.size = size;
+}
+
+queue_set::~queue_set() OS_NOEXCEPT
+{
+    while(s.count)
+    {
+        const queue_set_member& member = s.members[s.count - 1];
+        if(member.q)
+        {
+            remove(*member.q);
+        }
+        else if(member.sem)
+        {
+            remove(*member.sem);
+        }
+        else
+        {
+            remove(*member.ev);
+        }
+    }
+
+    delete[] s.members;
+    s.members = nullptr;
+}
+
+osal::exit queue_set::add(class queue& q, error** error) OS_NOEXCEPT
+{
+    if(q.q.set.load(std::memory_order_relaxed))
+    {
+        return queue_set_busy(error);
+    }
+
+    if(queue_set_append(s, {&q, nullptr, nullptr, 0}, error) == exit::KO)
+    {
+        return exit::KO;
+    }
+    q.q.set.store(&s, std::memory_order_release);
+    return exit::OK;
+}
+
+osal::exit queue_set::add(class semaphore& sem, error** error) OS_NOEXCEPT
+{
+    if(sem.sem.set.load(std::memory_order_relaxed))
+    {
+        return queue_set_busy(error);
+    }
+
+    if(queue_set_append(s, {nullptr, &sem, nullptr, 0}, error) == exit::KO)
+    {
+        return exit::KO;
+    }
+    sem.sem.set.store(&s, std::memory_order_release);
+    return exit::OK;
+}
+
+osal::exit queue_set::add(class event& ev, uint32_t mask, error** error) OS_NOEXCEPT
+{
+    if(ev.e.set.load(std::memory_order_relaxed))
+    {
+        return queue_set_busy(error);
+    }
+
+    if(queue_set_append(s, {nullptr, nullptr, &ev, mask}, error) == exit::KO)
+    {
+        return exit::KO;
+    }
+    ev.e.set.store(&s, std::memory_order_release);
+    return exit::OK;
+}
+
+osal::exit queue_set::remove(class queue& q, error** error) OS_NOEXCEPT
+{
+    if(queue_set_erase(s, [&q](const queue_set_member& m) { return m.q == &q; }, error) == exit::KO)
+    {
+        return exit::KO;
+    }
+    q.q.set.store(nullptr, std::memory_order_release);
+    return exit::OK;
+}
+
+osal::exit queue_set::remove(class semaphore& sem, error** error) OS_NOEXCEPT
+{
+    if(queue_set_erase(s, [&sem](const queue_set_member& m) { return m.sem == &sem; }, error) == exit::KO)
+    {
+        return exit::KO;
+    }
+    sem.sem.set.store(nullptr, std::memory_order_release);
+    return exit::OK;
+}
+
+osal::exit queue_set::remove(class event& ev, error** error) OS_NOEXCEPT
+{
+    if(queue_set_erase(s, [&ev](const queue_set_member& m) { return m.ev == &ev; }, error) == exit::KO)
+    {
+        return exit::KO;
+    }
+    ev.e.set.store(nullptr, std::memory_order_release);
+    return exit::OK;
+}
+
+void* queue_set::select(uint64_t time, error** error) OS_NOEXCEPT
+{
+    return select_until(deadline_from_ms(time), error);
+}
+
+void* queue_set::select_until(tick deadline, error** error) OS_NOEXCEPT
+{
+    timespec ts{0};
+
+    if (deadline != WAIT_FOREVER)
+    {
+        ts = timespec_from_tick(deadline);
+    }
+
+    for(bool last = false; ; )
+    {
+        const uint32_t ready = s.ready.load(std::memory_order_acquire);
+
+        // start after the member returned last time so that a busy member cannot starve the others
+        for(size_t n = 0; n < s.count; n++)
+        {
+            const size_t i = (s.next + n) % s.count;
+            const queue_set_member& member = s.members[i];
+            void* object = nullptr;
+
+            if(member.q && member.q->size() > 0)
+            {
+                object = member.q;
+            }
+            else if(member.sem && semaphore_ready(member.sem->sem))
+            {
+                object = member.sem;
+            }
+            else if(member.ev && (member.ev->e.flags.load(std::memory_order_acquire) & member.mask))
+            {
+                object = member.ev;
+            }
+
+            if(object)
+            {
+                s.next = i + 1;
+                return object;
+            }
+        }
+
+        if(deadline == 0 || last)
+        {
+            break;
+        }
+
+        s.waiters.fetch_add(1, std::memory_order_seq_cst);
+        const int ret = futex_wait(s.ready, ready, deadline != WAIT_FOREVER ? &ts : nullptr);
+        s.waiters.fetch_sub(1, std::memory_order_relaxed);
+
+        if(ret == ETIMEDOUT)
+        {
+            // a member may have become ready right before the deadline: scan once more
+            last = true;
+        }
+    }
+
+    if(error)
+    {
+        *error = OS_ERROR_BUILD("Timeout expired.", error_type::OS_ETIMEDOUT);
+        OS_ERROR_PTR_SET_POSITION(*error);
+    }
+    return nullptr;
+}
+
+}
+}
@@ -17,6 +17,8 @@
  *
  ***************************************************************************/
 #include "osal/semaphore.hpp"
+#include "osal_sys/queue_set.hpp"
+#include "osal_sys/futex.hpp"
 
 #include <pthread.h>
 #include <errno.h>
@@ -49,24 +51,18 @@ semaphore::~semaphore()
 
 osal::exit semaphore::wait(uint64_t time, error** _error) OS_NOEXCEPT
 {
-    timespec ts{0};
-    uint8_t error     = 0;
-    uint64_t nsec = (uint64_t)time * 1'000'000;
-
+    return wait_until(deadline_from_ms(time), _error);
+}
 
-    clock_gettime (CLOCK_MONOTONIC, &ts);
-    nsec += ts.tv_nsec;
-    if (nsec > NSECS_PER_SEC)
-    {
-        ts.tv_sec += nsec / NSECS_PER_SEC;
-        nsec %= NSECS_PER_SEC;
-    }
-    ts.tv_nsec = nsec;
+osal::exit semaphore::wait_until(tick deadline, error** _error) OS_NOEXCEPT
+{
+    timespec ts = timespec_from_tick(deadline);
+    uint8_t error     = 0;
 
     pthread_mutex_lock (&sem.mutex);
     while (sem.count == 0)
     {
-        if (time != WAIT_FOREVER)
+        if (deadline != WAIT_FOREVER)
         {
             error = pthread_cond_timedwait (&sem.cond, &sem.mutex, &ts);
             if (error)
@@ -142,6 +138,7 @@ void semaphore::signal()
     sem.count++;
     pthread_mutex_unlock (&sem.mutex);
     pthread_cond_signal (&sem.cond);
+    queue_set_notify(sem.set);
 }
 
 void semaphore::signal_from_isr() OS_NOEXCEPT
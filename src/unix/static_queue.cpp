@@ -0,0 +1,220 @@
+/***************************************************************************
+ * 
+ * OSAL
+ * Copyright (C) 2023/2024 Antonio Salsi <passy.linux@zresa.it>
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>. 
+ * 
+ ***************************************************************************/
+#include "osal/static_queue.hpp"
+#include "osal_sys/futex.hpp"
+
+#include <new>
+#include <sched.h>
+#include <string.h>
+
+namespace osal
+{
+inline namespace v1
+{
+
+namespace
+{
+
+/**
+ * Mutex, conditions and indices living in static_queue_data::control.
+ */
+struct static_queue_control
+{
+    pthread_mutex_t mutex{};
+    pthread_cond_t not_empty{};
+    pthread_cond_t not_full{};
+    size_t r = 0;
+    size_t w = 0;
+    size_t count = 0;
+};
+
+static_assert(sizeof(static_queue_control) <= STATIC_QUEUE_CONTROL_SIZE, "STATIC_QUEUE_CONTROL_SIZE too small for static_queue_control");
+static_assert(alignof(static_queue_control) <= alignof(void*), "static_queue_control alignment not supported");
+
+constexpr uint8_t CONTROL_NONE = 0;
+constexpr uint8_t CONTROL_SETUP = 1;
+constexpr uint8_t CONTROL_READY = 2;
+
+/**
+ * Returns the control block, the first caller sets it up while concurrent first callers wait.
+ */
+static_queue_control& control(static_queue_data& q) OS_NOEXCEPT
+{
+    auto c = reinterpret_cast<static_queue_control*>(q.control);
+
+    uint8_t state = q.state.load(std::memory_order_acquire);
+    if (state == CONTROL_READY)
+    {
+        return *c;
+    }
+
+    if (state == CONTROL_NONE && q.state.compare_exchange_strong(state, CONTROL_SETUP, std::memory_order_acquire))
+    {
+        pthread_mutexattr_t mattr{0};
+        pthread_condattr_t cattr{0};
+
+        c = new (q.control) static_queue_control;
+        pthread_condattr_init (&cattr);
+        pthread_condattr_setclock (&cattr, CLOCK_MONOTONIC);
+        pthread_cond_init (&c->not_empty, &cattr);
+        pthread_cond_init (&c->not_full, &cattr);
+        pthread_mutexattr_init (&mattr);
+        pthread_mutexattr_setprotocol (&mattr, PTHREAD_PRIO_INHERIT);
+        pthread_mutex_init (&c->mutex, &mattr);
+
+        q.state.store(CONTROL_READY, std::memory_order_release);
+        return *c;
+    }
+
+    while (q.state.load(std::memory_order_acquire) != CONTROL_READY)
+    {
+        sched_yield();
+    }
+    return *c;
+}
+
+/**
+ * Lock the queue and wait on cond until the predicate holds, on success the mutex is left held.
+ */
+template<typename Ready>
+osal::exit static_queue_wait(static_queue_control& c, pthread_cond_t& cond, Ready ready, tick deadline, error** _error) OS_NOEXCEPT
+{
+    const timespec ts = timespec_from_tick(deadline);
+    int error = 0;
+
+    pthread_mutex_lock (&c.mutex);
+
+    while (!ready())
+    {
+        if (deadline == 0)
+        {
+            error = ETIMEDOUT;
+        }
+        else if (deadline != WAIT_FOREVER)
+        {
+            error = pthread_cond_timedwait (&cond, &c.mutex, &ts);
+        }
+        else
+        {
+            error = pthread_cond_wait (&cond, &c.mutex);
+        }
+
+        if (error && !ready())
+        {
+            if(_error)
+            {
+                switch (error_type(error))
+                {
+                case error_type::OS_ETIMEDOUT:
+                    *_error = OS_ERROR_BUILD("The time specified by abstime to pthread_cond_timedwait() has passed.", error_type::OS_ETIMEDOUT);
+                    OS_ERROR_PTR_SET_POSITION(*_error);
+                    break;
+                case error_type::OS_EINVAL:
+                    *_error = OS_ERROR_BUILD("The value specified by abstime is invalid.", error_type::OS_EINVAL);
+                    OS_ERROR_PTR_SET_POSITION(*_error);
+                    break;
+                default:
+                    *_error = OS_ERROR_BUILD("Unmanaged error", error);
+                    OS_ERROR_PTR_SET_POSITION(*_error);
+                    break;
+                }
+            }
+            pthread_mutex_unlock (&c.mutex);
+            return exit::KO;
+        }
+    }
+
+    return exit::OK;
+}
+
+}
+
+osal::exit static_queue_fetch(static_queue_data& q, const uint8_t* buffer, size_t size, size_t message_size, void* msg, tick deadline, error** error) OS_NOEXCEPT
+{
+    static_queue_control& c = control(q);
+
+    if(static_queue_wait(c, c.not_empty, [&c] { return c.count > 0; }, deadline, error) == exit::KO)
+    {
+        return exit::KO;
+    }
+
+    memcpy(msg, buffer + c.r * message_size, message_size);
+    c.r++;
+    if (c.r == size)
+    {
+        c.r = 0;
+    }
+    c.count--;
+
+    pthread_mutex_unlock (&c.mutex);
+    pthread_cond_signal (&c.not_full);
+    return exit::OK;
+}
+
+osal::exit static_queue_post(static_queue_data& q, uint8_t* buffer, size_t size, size_t message_size, const void* msg, tick deadline, error** error) OS_NOEXCEPT
+{
+    static_queue_control& c = control(q);
+
+    if(static_queue_wait(c, c.not_full, [&c, size] { return c.count < size; }, deadline, error) == exit::KO)
+    {
+        return exit::KO;
+    }
+
+    memcpy(buffer + c.w * message_size, msg, message_size);
+    c.w++;
+    if (c.w == size)
+    {
+        c.w = 0;
+    }
+    c.count++;
+
+    pthread_mutex_unlock (&c.mutex);
+    pthread_cond_signal (&c.not_empty);
+    return exit::OK;
+}
+
+size_t static_queue_size(static_queue_data& q) OS_NOEXCEPT
+{
+    if (q.state.load(std::memory_order_acquire) != CONTROL_READY)
+    {
+        return 0;
+    }
+
+    static_queue_control& c = control(q);
+    pthread_mutex_lock (&c.mutex);
+    const size_t ret = c.count;
+    pthread_mutex_unlock (&c.mutex);
+    return ret;
+}
+
+void static_queue_delete(static_queue_data& q) OS_NOEXCEPT
+{
+    if (q.state.load(std::memory_order_acquire) == CONTROL_READY)
+    {
+        static_queue_control& c = control(q);
+        pthread_cond_destroy (&c.not_empty);
+        pthread_cond_destroy (&c.not_full);
+        pthread_mutex_destroy (&c.mutex);
+        c.~static_queue_control();
+        q.state.store(CONTROL_NONE, std::memory_order_relaxed);
+    }
+}
+
+}
+}
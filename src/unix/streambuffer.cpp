@@ -1,267 +1,328 @@
 /***************************************************************************
- *
+ * 
  * OSAL
- * Copyright (C) 2023 / 2024  Antonio Salsi <passy.linux@zresa.it>
- *
+ * Copyright (C) 2023/2024 Antonio Salsi <passy.linux@zresa.it>
+ * 
  * This program is free software: you can redistribute it and/or modify
  * it under the terms of the GNU General Public License as published by
  * the Free Software Foundation, either version 3 of the License
- *
+ * 
  * This program is distributed in the hope that it will be useful,
  * but WITHOUT ANY WARRANTY; without even the implied warranty of
  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
  * GNU General Public License for more details.
- *
+ * 
  * You should have received a copy of the GNU General Public License
- * along with this program.  If not, see <http://www.gnu.org/licenses/>.
- *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>. 
+ * 
  ***************************************************************************/
 #include "osal/streambuffer.hpp"
+#include "osal_sys/futex.hpp"
 
-#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
 
 namespace osal
 {
 inline namespace v1
 {
 
-stream_buffer::stream_buffer(size_t size, size_t trigger_size, error** error) OS_NOEXCEPT
+namespace
 {
-    pthread_mutexattr_t mattr;
-    pthread_condattr_t cattr;
 
+inline size_t min(size_t a, size_t b) OS_NOEXCEPT
+{
+    return a < b ? a : b;
+}
+
+/**
+ * Bytes of a region starting at offset that can be addressed linearly, the mirror makes the
+ * bytes past the end of the storage alias its start.
+ */
+inline size_t contiguous(const stream_buffer_data& sb, size_t offset, size_t size) OS_NOEXCEPT
+{
+    return sb.mirrored ? size : min(size, sb.mask + 1 - offset);
+}
+
+/**
+ * Copy into the ring at a free-running index, splitting the copy in two when it wraps.
+ */
+inline void ring_write(stream_buffer_data& sb, size_t index, const uint8_t* data, size_t size) OS_NOEXCEPT
+{
+    const size_t offset = index & sb.mask;
+    const size_t first = contiguous(sb, offset, size);
+
+    memcpy(sb.buffer + offset, data, first);
+    if (first < size)
+    {
+        memcpy(sb.buffer, data + first, size - first);
+    }
+}
+
+/**
+ * Copy out of the ring at a free-running index, splitting the copy in two when it wraps.
+ */
+inline void ring_read(const stream_buffer_data& sb, size_t index, uint8_t* data, size_t size) OS_NOEXCEPT
+{
+    const size_t offset = index & sb.mask;
+    const size_t first = contiguous(sb, offset, size);
+
+    memcpy(data, sb.buffer + offset, first);
+    if (first < size)
+    {
+        memcpy(data + first, sb.buffer, size - first);
+    }
+}
 
-    sb.buffer = new uint8_t(size);
-    if (sb.buffer == nullptr)
+/**
+ * Map a memfd of storage bytes twice, back to back, inside one reserved range of 2 * storage bytes.
+ */
+uint8_t* mirror_map(size_t storage, error** error) OS_NOEXCEPT
+{
+    const int fd = memfd_create("osal_stream_buffer", MFD_CLOEXEC);
+    if (fd == -1)
     {
         if(error)
         {
-            *error = OS_ERROR_BUILD("Out off memory.", error_type::OS_ENOMEM);
+            *error = OS_ERROR_BUILD("memfd_create() fail.", errno);
             OS_ERROR_PTR_SET_POSITION(*error);
         }
-        return;
+        return nullptr;
     }
-    memset(sb.buffer, 0, size);
 
-    pthread_condattr_init (&cattr);
-    pthread_condattr_setclock (&cattr, CLOCK_MONOTONIC);
-    pthread_cond_init (&sb.cond, &cattr);
-    pthread_mutexattr_init (&mattr);
-    pthread_mutexattr_setprotocol (&mattr, PTHREAD_PRIO_INHERIT);
-    pthread_mutex_init (&sb.mutex, &mattr);
+    uint8_t* base = nullptr;
+    if (ftruncate(fd, storage) == 0)
+    {
+        // reserve the whole range first so that the two views cannot land on a foreign mapping
+        void* range = mmap(nullptr, storage * 2, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (range != MAP_FAILED)
+        {
+            base = static_cast<uint8_t*>(range);
+            if (mmap(base, storage, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED
+                || mmap(base + storage, storage, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED)
+            {
+                munmap(base, storage * 2);
+                base = nullptr;
+            }
+        }
+    }
 
-    sb.trigger_size = trigger_size;
-    sb.r = 0;
-    sb.w = 0;
-    sb.end = 0;
-    sb.count = 0;
-    sb.size  = size;
+    if (base == nullptr && error)
+    {
+        *error = OS_ERROR_BUILD("Mirrored mapping fail.", errno);
+        OS_ERROR_PTR_SET_POSITION(*error);
+    }
 
+    // the mappings keep the memory alive
+    close(fd);
+    return base;
 }
 
-stream_buffer::~stream_buffer()
+inline uint32_t futex_level(size_t level) OS_NOEXCEPT
 {
-    pthread_cond_destroy (&sb.cond);
-    pthread_mutex_destroy (&sb.mutex);
+    return level < UINT32_MAX ? static_cast<uint32_t>(level) : UINT32_MAX;
+}
 
-    if(sb.buffer)
+/**
+ * Signal the event descriptor once the armed level is reached, the caller has already ordered
+ * its index store before this load.
+ */
+inline void notify_event(stream_buffer_data& sb, size_t available) OS_NOEXCEPT
+{
+    const uint32_t level = sb.event_level.load(std::memory_order_acquire);
+    if (level && available >= level && sb.event_level.exchange(0, std::memory_order_relaxed))
     {
-        for(size_t i = 0; i < sb.size; i++)
-        {
-            sb.buffer[i] = 0;
-        }
-        reset();
-        delete[] sb.buffer;
-        sb.buffer = nullptr;
+        eventfd_write(sb.event_fd.load(std::memory_order_relaxed), 1);
     }
 }
 
-size_t stream_buffer::send(const uint8_t *data, size_t size, uint64_t time, error** _error) OS_NOEXCEPT
+/**
+ * Wake the reader if it sleeps on a level that available reaches, then the event descriptor.
+ */
+inline void notify_reader(stream_buffer_data& sb, size_t available) OS_NOEXCEPT
 {
-    timespec ts{0};
-    uint8_t error     = 0;
-    uint64_t nsec = (uint64_t)time * 1'000'000;
+    spsc_notify(sb.reader_waiting, available);
+    notify_event(sb, available);
+}
 
-    if(data == nullptr)
+/**
+ * Arm the event descriptor, if any, at the trigger level.
+ */
+inline void arm_event(stream_buffer_data& sb) OS_NOEXCEPT
+{
+    if (sb.event_fd.load(std::memory_order_relaxed) >= 0)
     {
-        if(_error)
+        const size_t trigger = sb.trigger_size.load(std::memory_order_relaxed);
+        // release: a writer that sees the level also sees event_fd
+        sb.event_level.store(futex_level(trigger ? trigger : 1), std::memory_order_release);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+    }
+}
+
+/**
+ * Wait until the reader sees at least level bytes, or the trigger level when level is 0. The
+ * sleeping reader publishes its level in the futex word so that the writer wakes it only once
+ * enough data is stored; a trigger level changed meanwhile is picked up on the next round.
+ */
+osal::exit wait_readable(stream_buffer_data& sb, size_t head, size_t& tail, size_t level, tick deadline, error** _error) OS_NOEXCEPT
+{
+    arm_event(sb);
+    tail = sb.tail.load(std::memory_order_acquire);
+
+    while (true)
+    {
+        const size_t trigger = sb.trigger_size.load(std::memory_order_relaxed);
+        const size_t wanted = level ? level : trigger;
+        if (tail - head >= wanted)
         {
-            *_error = OS_ERROR_BUILD("Data nullptr", error_type::OS_EINVAL);
-            OS_ERROR_PTR_SET_POSITION(*_error);
+            return exit::OK;
+        }
+
+        auto ready = [&sb, head, &tail, level, wanted, trigger]
+        {
+            tail = sb.tail.load(std::memory_order_acquire);
+            return tail - head >= wanted || (level == 0 && sb.trigger_size.load(std::memory_order_relaxed) != trigger);
+        };
+
+        if (spsc_wait(sb.reader_waiting, ready, deadline, _error, futex_level(wanted)) == exit::KO)
+        {
+            return exit::KO;
         }
-        return false;
     }
+}
 
-    if(sb.count == sb.size)
+}
+
+stream_buffer::stream_buffer(size_t size, size_t trigger_size, stream_buffer_mode mode, error** error) OS_NOEXCEPT
+{
+    if (size == 0)
     {
-        if(_error)
+        if(error)
         {
-            *_error = OS_ERROR_BUILD("sb.count == sb.size", error_type::OS_EINVAL);
-            OS_ERROR_PTR_SET_POSITION(*_error);
+            *error = OS_ERROR_BUILD("Invalid size.", error_type::OS_EINVAL);
+            OS_ERROR_PTR_SET_POSITION(*error);
         }
-        return false;
+        return;
     }
 
-    if (time != WAIT_FOREVER)
+    // power-of-two storage so that the free-running indices are reduced with a mask, the mirror
+    // needs whole pages: page sizes are powers of two as well
+    size_t storage = mode == stream_buffer_mode::MIRRORED ? static_cast<size_t>(sysconf(_SC_PAGESIZE)) : 1;
+    while (storage < size)
     {
-        clock_gettime (CLOCK_MONOTONIC, &ts);
-        nsec += ts.tv_nsec;
-
-        ts.tv_sec += nsec / NSECS_PER_SEC;
-        ts.tv_nsec = nsec % NSECS_PER_SEC;
+        storage <<= 1;
     }
 
-    pthread_mutex_lock (&sb.mutex);
-
-    size_t ret = sb.count;
-//    bool check_cond_wait_init = false;
-
-    while (sb.count == sb.size)
+    if (mode == stream_buffer_mode::MIRRORED)
     {
-        if (time != WAIT_FOREVER)
+        sb.buffer = mirror_map(storage, error);
+        if (sb.buffer == nullptr)
         {
-//            check_cond_wait_init = true;
-
-            error = pthread_cond_timedwait (&sb.cond, &sb.mutex, &ts);
-            if (error)
-            {
-                if(_error)
-                {
-                    switch (error_type(error))
-                    {
-                    case error_type::OS_ETIMEDOUT:
-                        *_error = OS_ERROR_BUILD("The time specified by abstime to pthread_cond_timedwait() has passed.", error_type::OS_ETIMEDOUT);
-                        OS_ERROR_PTR_SET_POSITION(*_error);
-                        break;
-                    case error_type::OS_EINVAL:
-                        *_error = OS_ERROR_BUILD("The value specified by abstime is invalid.", error_type::OS_EINVAL);
-                        OS_ERROR_PTR_SET_POSITION(*_error);
-                        break;
-                    case error_type::OS_EPERM:
-                        *_error = OS_ERROR_BUILD("The mutex was not owned by the current thread at the time of the call.", error_type::OS_EPERM);
-                        OS_ERROR_PTR_SET_POSITION(*_error);
-                        break;
-                    default:
-                        *_error = OS_ERROR_BUILD("Unmanaged error", error);
-                        OS_ERROR_PTR_SET_POSITION(*_error);
-                        break;
-                    }
-                }
-                goto timeout;
-            }
+            return;
         }
-        else
+        sb.mirrored = true;
+    }
+    else
+    {
+        sb.buffer = new uint8_t[storage];
+        if (sb.buffer == nullptr)
         {
-            error = pthread_cond_wait (&sb.cond, &sb.mutex);
-            if (error)
+            if(error)
             {
-                if(_error)
-                {
-                    switch (error_type(error))
-                    {
-                    case error_type::OS_ETIMEDOUT:
-                        *_error = OS_ERROR_BUILD("The time specified by abstime to pthread_cond_timedwait() has passed.", error_type::OS_ETIMEDOUT);
-                        OS_ERROR_PTR_SET_POSITION(*_error);
-                        break;
-                    case error_type::OS_EINVAL:
-                        *_error = OS_ERROR_BUILD("The value specified by abstime is invalid.", error_type::OS_EINVAL);
-                        OS_ERROR_PTR_SET_POSITION(*_error);
-                        break;
-                    default:
-                        *_error = OS_ERROR_BUILD("Unmanaged error", error);
-                        OS_ERROR_PTR_SET_POSITION(*_error);
-                        break;
-                    }
-                }
-                goto timeout;
+                *error = OS_ERROR_BUILD("Out off memory.", error_type::OS_ENOMEM);
+                OS_ERROR_PTR_SET_POSITION(*error);
             }
+            return;
         }
+        memset(sb.buffer, 0, storage);
     }
 
+    sb.trigger_size.store(trigger_size < size ? trigger_size : size, std::memory_order_relaxed);
+    sb.size = size;
+    sb.mask = storage - 1;
+}
 
-
-    if( (sb.w + size) >= sb.size && sb.r > 0)
+stream_buffer::~stream_buffer()
+{
+    if(sb.buffer)
     {
-        //I write the available space on buffer
-        size_t data_to_write  = sb.size - sb.w;
-        size_t data_override  = size - data_to_write;
-        memcpy(sb.buffer + sb.w, data, data_to_write);
-        sb.count += data_to_write;
-
-        sb.end = sb.w;
-        sb.w += data_to_write;
-
-        //i write on already read data
-        if(data_override <= sb.r)
+        memset(sb.buffer, 0, sb.mask + 1);
+        if (sb.mirrored)
         {
-            //I can write all remaining data
-            memcpy(sb.buffer, data + data_to_write, data_override);
-            sb.w = data_override;
-            sb.count += data_override;
-
+            munmap(sb.buffer, (sb.mask + 1) * 2);
         }
         else
         {
-            //Partial writing, I trunk some data
-            memcpy(sb.buffer, data + data_to_write, sb.r);
-            sb.w = sb.r;
-            sb.count += sb.r;
-            error = 1;
+            delete[] sb.buffer;
         }
+        sb.buffer = nullptr;
     }
-    else if(sb.r == 0)
+    if(sb.event_fd >= 0)
     {
-        //not override
-        if( (sb.w + size) <= sb.size)
-        {
-            memcpy(sb.buffer + sb.w, data, size);
+        close(sb.event_fd);
+        sb.event_fd = -1;
+    }
+}
 
-            sb.count += size;
+size_t stream_buffer::send(const uint8_t *data, size_t size, uint64_t time, error** _error) OS_NOEXCEPT
+{
+    // what fits is written first: the clock is read only when the ring is full and the call has to block
+    const size_t sent = time != 0 ? send_until(data, size, 0, nullptr) : 0;
+    if (sent == size && data)
+    {
+        return sent;
+    }
+    return sent + send_until(data + sent, size - sent, deadline_from_ms(time), sent ? nullptr : _error);
+}
 
-            sb.w  += size;
-        }
-        else
+size_t stream_buffer::send_until(const uint8_t *data, size_t size, tick deadline, error** _error) OS_NOEXCEPT
+{
+    if(data == nullptr || sb.buffer == nullptr)
+    {
+        if(_error)
         {
-            memcpy(sb.buffer + sb.w, data, sb.size - sb.w);
-
-            sb.count += sb.size - sb.w;
-
-            sb.w  += sb.size - sb.w;
-
+            *_error = OS_ERROR_BUILD("Data nullptr", error_type::OS_EINVAL);
+            OS_ERROR_PTR_SET_POSITION(*_error);
         }
+        return 0;
     }
-    else if(sb.r > 0)
-    {
-        size_t size_available = abs(static_cast<long long>(sb.r - sb.w));
 
-        if(size <= size_available)
-        {
-            memcpy(sb.buffer + sb.w, data, size);
+    size_t tail = sb.tail.load(std::memory_order_relaxed);
+    size_t head = sb.head.load(std::memory_order_acquire);
+    size_t sent = 0;
 
-            sb.count += size;
-
-            sb.w  += size;
-        }
-        else
+    while (sent < size)
+    {
+        if (tail - head == sb.size)
         {
-            memcpy(sb.buffer + sb.r, data, size);
-
-            sb.count += size;
-
-            sb.r  += size;
+            auto ready = [this, &head, tail]
+            {
+                head = sb.head.load(std::memory_order_acquire);
+                return tail - head < sb.size;
+            };
 
-            error = 1;
+            // a partial send is not an error, the caller gets the number of bytes written
+            if (spsc_wait(sb.writer_waiting, ready, deadline, sent ? nullptr : _error) == exit::KO)
+            {
+                break;
+            }
         }
 
-    }
+        const size_t chunk = min(size - sent, sb.size - (tail - head));
 
+        ring_write(sb, tail, data + sent, chunk);
+        tail += chunk;
+        sent += chunk;
+        sb.tail.store(tail, std::memory_order_release);
 
-timeout:
-    pthread_mutex_unlock (&sb.mutex);
-    pthread_cond_signal (&sb.cond);
+        // the reader is woken only once the level it sleeps on is reached
+        notify_reader(sb, tail - head);
+    }
 
-    //return (error == 0);
-    return error ? 0 : sb.count - ret;
+    return sent;
 }
 
 inline size_t stream_buffer::send_from_isr(const uint8_t *data, size_t size, uint64_t time, error **error) OS_NOEXCEPT
@@ -271,243 +332,359 @@ inline size_t stream_buffer::send_from_isr(const uint8_t *data, size_t size, uin
 
 size_t stream_buffer::receive(uint8_t *data, size_t size, uint64_t time, error **_error) OS_NOEXCEPT
 {
-    timespec ts{0};
-    uint8_t error     = 0;
-    uint64_t nsec = (uint64_t)time * 1'000'000;
-    size_t already_received = 0;
+    const size_t received = time != 0 ? receive_until(data, size, 0, nullptr) : 0;
+    if (received)
+    {
+        return received;
+    }
+    return receive_until(data, size, deadline_from_ms(time), _error);
+}
 
-    if(data == nullptr)
+size_t stream_buffer::receive_until(uint8_t *data, size_t size, tick deadline, error **_error) OS_NOEXCEPT
+{
+    if(data == nullptr || sb.buffer == nullptr)
     {
         if(_error)
         {
             *_error = OS_ERROR_BUILD("Data nullptr", error_type::OS_EINVAL);
             OS_ERROR_PTR_SET_POSITION(*_error);
         }
-        return false;
+        return 0;
     }
 
+    return receive_at_least_until(data, size, 0, deadline, _error);
+}
 
-    if (time != WAIT_FOREVER)
+size_t stream_buffer::receive_at_least(uint8_t *data, size_t size, size_t min_size, uint64_t time, error **_error) OS_NOEXCEPT
+{
+    const size_t received = time != 0 ? receive_at_least_until(data, size, min_size, 0, nullptr) : 0;
+    if (received)
     {
-        clock_gettime (CLOCK_MONOTONIC, &ts);
-        nsec += ts.tv_nsec;
-
-        ts.tv_sec += nsec / NSECS_PER_SEC;
-        ts.tv_nsec = nsec % NSECS_PER_SEC;
+        return received;
     }
+    return receive_at_least_until(data, size, min_size, deadline_from_ms(time), _error);
+}
 
-    pthread_mutex_lock (&sb.mutex);
-
-//    bool check_cond_wait_init = false;
-    while (sb.count < sb.trigger_size)
+size_t stream_buffer::receive_at_least_until(uint8_t *data, size_t size, size_t min_size, tick deadline, error **_error) OS_NOEXCEPT
+{
+    if(data == nullptr || sb.buffer == nullptr)
     {
-        if (time != WAIT_FOREVER)
-        {
-//            check_cond_wait_init = true;
-
-            error = pthread_cond_timedwait (&sb.cond, &sb.mutex, &ts);
-            if (error)
-            {
-                if(_error)
-                {
-                    switch (error_type(error))
-                    {
-                    case error_type::OS_ETIMEDOUT:
-                        *_error = OS_ERROR_BUILD("The time specified by abstime to pthread_cond_timedwait() has passed.", error_type::OS_ETIMEDOUT);
-                        OS_ERROR_PTR_SET_POSITION(*_error);
-                        break;
-                    case error_type::OS_EINVAL:
-                        *_error = OS_ERROR_BUILD("The value specified by abstime is invalid.", error_type::OS_EINVAL);
-                        OS_ERROR_PTR_SET_POSITION(*_error);
-                        break;
-                    case error_type::OS_EPERM:
-                        *_error = OS_ERROR_BUILD("The mutex was not owned by the current thread at the time of the call.", error_type::OS_EPERM);
-                        OS_ERROR_PTR_SET_POSITION(*_error);
-                        break;
-                    default:
-                        *_error = OS_ERROR_BUILD("Unmanaged error", error);
-                        OS_ERROR_PTR_SET_POSITION(*_error);
-                        break;
-                    }
-                }
-                goto timeout;
-            }
-        }
-        else
+        if(_error)
         {
-            error = pthread_cond_wait (&sb.cond, &sb.mutex);
-            if (error)
-            {
-                if(_error)
-                {
-                    switch (error_type(error))
-                    {
-                    case error_type::OS_ETIMEDOUT:
-                        *_error = OS_ERROR_BUILD("The time specified by abstime to pthread_cond_timedwait() has passed.", error_type::OS_ETIMEDOUT);
-                        OS_ERROR_PTR_SET_POSITION(*_error);
-                        break;
-                    case error_type::OS_EINVAL:
-                        *_error = OS_ERROR_BUILD("The value specified by abstime is invalid.", error_type::OS_EINVAL);
-                        OS_ERROR_PTR_SET_POSITION(*_error);
-                        break;
-                    default:
-                        *_error = OS_ERROR_BUILD("Unmanaged error", error);
-                        OS_ERROR_PTR_SET_POSITION(*_error);
-                        break;
-                    }
-                }
-                goto timeout;
-            }
+            *_error = OS_ERROR_BUILD("Data nullptr", error_type::OS_EINVAL);
+            OS_ERROR_PTR_SET_POSITION(*_error);
         }
+        return 0;
     }
 
-    if(sb.count == 0)
+    if (size == 0)
     {
-        return false;
+        return 0;
     }
 
-    if(sb.r < sb.w && sb.end == 0)
-    {
-        //space available
-        size_t data_available = sb.w - sb.r;
-        if(data_available == 0 && sb.count)
-        {
-            data_available = sb.count;
-        }
+    // 0 stands for the trigger level, a per-call minimum never exceeds what can be stored or taken
+    const size_t head = sb.head.load(std::memory_order_relaxed);
+    size_t tail = 0;
 
-        if(size <= data_available)
-        {
-            memcpy(data, sb.buffer + sb.r, size);
+    if (wait_readable(sb, head, tail, min(min_size, min(size, sb.size)), deadline, _error) == exit::KO)
+    {
+        return 0;
+    }
 
-            sb.r += size;
+    const size_t received = min(size, tail - head);
+    if (received == 0)
+    {
+        return 0;
+    }
 
-            sb.count -= size;
+    ring_read(sb, head, data, received);
+    sb.head.store(head + received, std::memory_order_release);
+    spsc_notify(sb.writer_waiting);
 
-            already_received  = size;
-        }
-        else
-        {
-            memcpy(data, sb.buffer + sb.r, data_available);
+    return received;
+}
 
-            sb.r += data_available;
+size_t stream_buffer::receive_from_isr(uint8_t *data, size_t size, uint64_t time, error **error) OS_NOEXCEPT
+{
+    return receive(data, size, time, error);
+}
 
-            sb.count -= data_available;
+size_t stream_buffer::acquire_write(span (&regions)[2], uint64_t time, error** _error) OS_NOEXCEPT
+{
+    const size_t free = time != 0 ? acquire_write_until(regions, 0, nullptr) : 0;
+    if (free)
+    {
+        return free;
+    }
+    return acquire_write_until(regions, deadline_from_ms(time), _error);
+}
 
-            size -= data_available;
+size_t stream_buffer::acquire_write_until(span (&regions)[2], tick deadline, error** _error) OS_NOEXCEPT
+{
+    regions[0] = {};
+    regions[1] = {};
 
-            already_received  = data_available;
+    if(sb.buffer == nullptr)
+    {
+        if(_error)
+        {
+            *_error = OS_ERROR_BUILD("Buffer nullptr", error_type::OS_EINVAL);
+            OS_ERROR_PTR_SET_POSITION(*_error);
         }
+        return 0;
     }
-    else if(sb.r >= sb.w && sb.end > 0)
+
+    const size_t tail = sb.tail.load(std::memory_order_relaxed);
+    size_t head = sb.head.load(std::memory_order_acquire);
+
+    if (tail - head == sb.size)
     {
-        //rotation but not all data are read before end
-        size_t data_available_between_r_and_size = sb.size - sb.r;
+        auto ready = [this, &head, tail]
+        {
+            head = sb.head.load(std::memory_order_acquire);
+            return tail - head < sb.size;
+        };
 
-        if(data_available_between_r_and_size && size <= data_available_between_r_and_size)
+        if (spsc_wait(sb.writer_waiting, ready, deadline, _error) == exit::KO)
         {
-            memcpy(data + already_received, sb.buffer + sb.r, size);
+            return 0;
+        }
+    }
 
-            sb.r += size;
+    const size_t free = sb.size - (tail - head);
+    const size_t offset = tail & sb.mask;
+    const size_t first = contiguous(sb, offset, free);
 
-            sb.count -= size;
+    regions[0] = {sb.buffer + offset, first};
+    regions[1] = {sb.buffer, free - first};
+    return free;
+}
 
-            already_received = size;
+osal::exit stream_buffer::commit_write(size_t size, error** _error) OS_NOEXCEPT
+{
+    const size_t tail = sb.tail.load(std::memory_order_relaxed);
+    const size_t head = sb.head.load(std::memory_order_acquire);
 
-            data_available_between_r_and_size = size;
+    if (size > sb.size - (tail - head))
+    {
+        if(_error)
+        {
+            *_error = OS_ERROR_BUILD("Size exceeds the acquired space.", error_type::OS_EINVAL);
+            OS_ERROR_PTR_SET_POSITION(*_error);
+        }
+        return exit::KO;
+    }
 
-            size = 0;
+    sb.tail.store(tail + size, std::memory_order_release);
+    notify_reader(sb, tail + size - head);
+    return exit::OK;
+}
 
-        }
-        else if(data_available_between_r_and_size && size > data_available_between_r_and_size)
+size_t stream_buffer::acquire_read(span (&regions)[2], uint64_t time, error** _error) OS_NOEXCEPT
+{
+    const size_t stored = time != 0 ? acquire_read_until(regions, 0, nullptr) : 0;
+    if (stored)
+    {
+        return stored;
+    }
+    return acquire_read_until(regions, deadline_from_ms(time), _error);
+}
+
+size_t stream_buffer::acquire_read_until(span (&regions)[2], tick deadline, error** _error) OS_NOEXCEPT
+{
+    regions[0] = {};
+    regions[1] = {};
+
+    if(sb.buffer == nullptr)
+    {
+        if(_error)
         {
-            memcpy(data + already_received, sb.buffer + sb.r, data_available_between_r_and_size);
+            *_error = OS_ERROR_BUILD("Buffer nullptr", error_type::OS_EINVAL);
+            OS_ERROR_PTR_SET_POSITION(*_error);
+        }
+        return 0;
+    }
 
-            sb.r += data_available_between_r_and_size;
+    const size_t head = sb.head.load(std::memory_order_relaxed);
+    size_t tail = 0;
 
-            sb.count -= data_available_between_r_and_size;
+    if (wait_readable(sb, head, tail, 0, deadline, _error) == exit::KO)
+    {
+        return 0;
+    }
 
-            already_received = data_available_between_r_and_size;
+    const size_t stored = tail - head;
+    const size_t offset = head & sb.mask;
+    const size_t first = contiguous(sb, offset, stored);
 
-            size -= data_available_between_r_and_size;
+    regions[0] = {sb.buffer + offset, first};
+    regions[1] = {sb.buffer, stored - first};
+    return stored;
+}
 
-            data_available_between_r_and_size = 0;
+osal::exit stream_buffer::commit_read(size_t size, error** _error) OS_NOEXCEPT
+{
+    const size_t head = sb.head.load(std::memory_order_relaxed);
 
+    if (size > sb.tail.load(std::memory_order_acquire) - head)
+    {
+        if(_error)
+        {
+            *_error = OS_ERROR_BUILD("Size exceeds the acquired data.", error_type::OS_EINVAL);
+            OS_ERROR_PTR_SET_POSITION(*_error);
         }
+        return exit::KO;
+    }
 
-        if(size && size <= sb.w)
-        {
-            memcpy(data + already_received, sb.buffer, size);
+    sb.head.store(head + size, std::memory_order_release);
+    spsc_notify(sb.writer_waiting);
+    return exit::OK;
+}
 
-            sb.r = size;
+size_t stream_buffer::send_from_fd(int fd, size_t max, uint64_t time, error** _error) OS_NOEXCEPT
+{
+    return send_from_fd_until(fd, max, deadline_from_ms(time), _error);
+}
 
-            sb.count -= size;
+size_t stream_buffer::send_from_fd_until(int fd, size_t max, tick deadline, error** _error) OS_NOEXCEPT
+{
+    span regions[2];
 
-            already_received += size;
+    if (acquire_write_until(regions, deadline, _error) == 0)
+    {
+        return 0;
+    }
 
-            size = 0;
+    iovec iov[2];
+    iov[0] = {regions[0].data, min(regions[0].size, max)};
+    iov[1] = {regions[1].data, min(regions[1].size, max - iov[0].iov_len)};
 
-        }
-        else if(size && size > sb.w)
+    const ssize_t ret = readv(fd, iov, iov[1].iov_len ? 2 : 1);
+    if (ret < 0)
+    {
+        if(_error)
         {
-            memcpy(data + already_received, sb.buffer, sb.w);
+            *_error = OS_ERROR_BUILD("readv() fail.", errno);
+            OS_ERROR_PTR_SET_POSITION(*_error);
+        }
+        return 0;
+    }
 
-            sb.r = sb.w;
+    commit_write(ret);
+    return ret;
+}
 
-            sb.count -= sb.w;
+size_t stream_buffer::receive_to_fd(int fd, size_t max, uint64_t time, error** _error) OS_NOEXCEPT
+{
+    return receive_to_fd_until(fd, max, deadline_from_ms(time), _error);
+}
 
-            already_received = sb.w;
+size_t stream_buffer::receive_to_fd_until(int fd, size_t max, tick deadline, error** _error) OS_NOEXCEPT
+{
+    span regions[2];
 
-            size -= sb.w;
+    if (acquire_read_until(regions, deadline, _error) == 0)
+    {
+        return 0;
+    }
 
+    iovec iov[2];
+    iov[0] = {regions[0].data, min(regions[0].size, max)};
+    iov[1] = {regions[1].data, min(regions[1].size, max - iov[0].iov_len)};
+
+    const ssize_t ret = writev(fd, iov, iov[1].iov_len ? 2 : 1);
+    if (ret < 0)
+    {
+        if(_error)
+        {
+            *_error = OS_ERROR_BUILD("writev() fail.", errno);
+            OS_ERROR_PTR_SET_POSITION(*_error);
         }
+        return 0;
     }
 
-    if(sb.count == 0)
+    commit_read(ret);
+    return ret;
+}
+
+osal::exit stream_buffer::set_trigger_level(size_t trigger_size, error** _error) OS_NOEXCEPT
+{
+    if (trigger_size > sb.size)
     {
-        sb.r = 0;
-        sb.w = 0;
-        sb.end = 0;
+        if(_error)
+        {
+            *_error = OS_ERROR_BUILD("Trigger level exceeds the buffer size.", error_type::OS_EINVAL);
+            OS_ERROR_PTR_SET_POSITION(*_error);
+        }
+        return exit::KO;
     }
 
-timeout:
-    pthread_mutex_unlock (&sb.mutex);
-    pthread_cond_signal (&sb.cond);
+    sb.trigger_size.store(trigger_size, std::memory_order_relaxed);
 
-    // return (error == 0);
-    return error ? 0 : already_received;
+    // a reader sleeping on the old level re-evaluates it
+    spsc_notify(sb.reader_waiting);
+    return exit::OK;
 }
 
-size_t stream_buffer::receive_from_isr(uint8_t *data, size_t size, uint64_t time, error **error) OS_NOEXCEPT
+int stream_buffer::get_event_fd(error** _error) OS_NOEXCEPT
 {
-    return receive(data, size, time, error);
+    int fd = sb.event_fd.load(std::memory_order_acquire);
+    if (fd >= 0)
+    {
+        return fd;
+    }
+
+    fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (fd == -1)
+    {
+        if(_error)
+        {
+            *_error = OS_ERROR_BUILD("eventfd() fail.", errno);
+            OS_ERROR_PTR_SET_POSITION(*_error);
+        }
+        return -1;
+    }
+
+    // concurrent first calls each create a descriptor, the one published first is shared
+    int published = -1;
+    if (!sb.event_fd.compare_exchange_strong(published, fd, std::memory_order_acq_rel, std::memory_order_acquire))
+    {
+        close(fd);
+        return published;
+    }
+
+    // data already stored signals at once
+    arm_event(sb);
+    notify_event(sb, size());
+    return fd;
 }
 
 void stream_buffer::reset() OS_NOEXCEPT
 {
-    sb.r = 0;
-    sb.w = 0;
-    sb.end = 0;
-    memset(sb.buffer, '\0', sb.size);
+    sb.head.store(sb.tail.load(std::memory_order_acquire), std::memory_order_release);
+    spsc_notify(sb.writer_waiting);
 }
 
 bool stream_buffer::is_empty() const OS_NOEXCEPT
 {
-    return sb.count == 0;
+    return size() == 0;
 }
 
 bool stream_buffer::is_full() const OS_NOEXCEPT
 {
-    return (sb.size - sb.count) == 0;
+    return size() == sb.size;
 }
 
 size_t stream_buffer::size() const OS_NOEXCEPT
 {
-    return sb.count;
+    // head first: the tail read afterwards can only be ahead of it
+    const size_t head = sb.head.load(std::memory_order_acquire);
+    return sb.tail.load(std::memory_order_acquire) - head;
 }
 
 size_t stream_buffer::bytes_free() const
 {
-    return sb.size - sb.count;
+    return sb.size - size();
 }
 
 }
@@ -17,13 +17,9 @@
  *
  ***************************************************************************/
 #include "osal/timer.hpp"
-#include "osal/thread.hpp"
-
-#include <signal.h>
-#include <pthread.h>
-#include <sys/syscall.h>
-#include <unistd.h>
+#include "osal_sys/timer_wheel.hpp"
 
+#include <time.h>
 
 namespace osal
 {
@@ -32,40 +28,15 @@ inline namespace v1
 
 namespace
 {
-constexpr inline const uint8_t TIMER_PRIO = 30;
-constexpr inline const uint32_t TIMER_HEAP = 1024;
-}
 
-void* timer_thread (void * arg)
+inline uint64_t now_ns() OS_NOEXCEPT
 {
-    auto timer = static_cast<class timer*>(arg);
-    sigset_t sigset{0};
-    siginfo_t si{0};
-    timespec tmo{0};
-
-    timer->t.thread_id = (pid_t)syscall (SYS_gettid);
-
-    /* Add SIGALRM */
-    sigemptyset (&sigset);
-    sigprocmask (SIG_BLOCK, &sigset, nullptr);
-    sigaddset (&sigset, SIGALRM);
-
-    tmo.tv_sec  = 0;
-    tmo.tv_nsec = 500'000'000;
-
-    while (!timer->t.exit)
-    {
-        uint8_t sig = sigtimedwait (&sigset, &si, &tmo);
-        if (sig == SIGALRM)
-        {
-            if (timer->t.fn)
-                timer->t.fn (timer, timer->t.arg);
-        }
-    }
-    return nullptr;
+    timespec ts{0};
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * NSECS_PER_SEC + ts.tv_nsec;
 }
 
-
+}
 
 timer::timer(uint64_t us, handler fn, bool one_shot) OS_NOEXCEPT
     : us(us)
@@ -77,122 +48,132 @@ timer::timer(uint64_t us, handler fn, bool one_shot) OS_NOEXCEPT
 
 timer::~timer() OS_NOEXCEPT
 {
-    t.exit = true;
-    //pthread_join (timer->thread, nullptr);
-    t.thread->join();
-    delete t.thread;
-    t.thread = nullptr;
-    timer_delete (t.timer_id);
+    if(t.wheel)
+    {
+        timer_wheel_stop(t, true);
+        t.wheel = nullptr;
+    }
 }
 
-exit timer::create(void *arg, error** error)
+exit timer::create(void *arg, error** error) OS_NOEXCEPT
 {
-    sigevent sev{0};
-    sigset_t sigset{0};
-
-    /* Block SIGALRM in calling thread */
-    sigemptyset (&sigset);
-    sigaddset (&sigset, SIGALRM);
-    sigprocmask (SIG_BLOCK, &sigset, nullptr);
+    if(t.wheel)
+    {
+        timer_wheel_stop(t, true);
+    }
 
-    t.exit      = false;
-    t.thread_id = 0;
+    t.owner     = this;
     t.fn        = fn;
     t.arg       = arg;
-    t.us        = us;
-    t.one_shot   = one_shot;
+    t.stats     = &stats;
+    t.period.store(us * 1'000, std::memory_order_relaxed);
+    t.one_shot  = one_shot;
 
-    /* Create timer thread */
-    //kiwi_os_thread_create (&t.thread, "os_timer", TIMER_PRIO, 1024, os_timer_thread, this);
-    t.thread = new thread("os_timer", TIMER_PRIO, TIMER_HEAP, timer_thread);
-    if(t.thread == nullptr)
+    // every timer is filed in a shared wheel, no thread or kernel timer per instance
+    t.wheel = timer_wheel_get(error);
+    return t.wheel ? exit::OK : exit::KO;
+}
+
+void timer::set(uint64_t us) OS_NOEXCEPT
+{
+    timer::us = us;
+    t.period.store(us * 1'000, std::memory_order_relaxed);
+    if(t.wheel && t.armed.load(std::memory_order_relaxed))
     {
-        if(error)
-        {
-            *error = OS_ERROR_BUILD("Out off memory.", error_type::OS_ENOMEM);
-            OS_ERROR_PTR_SET_POSITION(*error);
-        }
-        return exit::KO;
+        start();
     }
-    if(t.thread->create(this) == exit::KO)
+}
+
+void timer::set_from_isr(uint64_t us) OS_NOEXCEPT
+{
+    set(us);
+}
+
+void timer::start() const OS_NOEXCEPT
+{
+    if(t.wheel)
     {
-        if(error)
-        {
-            *error = OS_ERROR_BUILD("Impossible create timer.", error_type::OS_ENODATA);
-            OS_ERROR_PTR_SET_POSITION(*error);
-        }
-        return exit::KO;
+        timer_wheel_start(t, now_ns() + t.period.load(std::memory_order_relaxed));
     }
+}
 
-    /* Wait until timer thread sets its (kernel) thread id */
-    do
+void timer::start_at(tick deadline) const OS_NOEXCEPT
+{
+    if(t.wheel && deadline != WAIT_FOREVER)
     {
-        sched_yield();
-    } while (t.thread_id == 0);
+        timer_wheel_start(t, deadline);
+    }
+}
 
-    /* Create timer */
-    sev.sigev_notify            = SIGEV_THREAD_ID;
-    sev.sigev_value.sival_ptr   = this;
-    sev._sigev_un._tid          = t.thread_id;
-    sev.sigev_signo             = SIGALRM;
-    sev.sigev_notify_attributes = nullptr;
+void timer::start_from_isr() const OS_NOEXCEPT
+{
+    start();
+}
 
-    if (timer_create (CLOCK_MONOTONIC, &sev, &t.timer_id) == -1)
+void timer::stop() const OS_NOEXCEPT
+{
+    if(t.wheel)
     {
-        // free (timer);
-        return exit::KO;
+        timer_wheel_stop(t, false);
     }
-    return exit::OK;
 }
 
-inline void timer::set(uint64_t us) OS_NOEXCEPT
+void timer::stop_from_isr() const OS_NOEXCEPT
 {
-    t.us = us;
+    stop();
 }
 
-inline void timer::set_from_isr(uint64_t us) OS_NOEXCEPT
+osal::exit timer::set_policy(timer_policy policy, error**) OS_NOEXCEPT
 {
-    timer::us = us;
+    t.catch_up.store(policy == timer_policy::CATCH_UP, std::memory_order_relaxed);
+    return exit::OK;
 }
 
-void timer::start() const OS_NOEXCEPT
+uint32_t timer::overrun() const OS_NOEXCEPT
 {
-    itimerspec its{0};
+    return timer_wheel_overrun(t);
+}
 
+void timer::set_slack(uint64_t us) OS_NOEXCEPT
+{
+    t.slack.store(us * 1'000, std::memory_order_relaxed);
+}
 
-    /* Start timer */
-    its.it_value.tv_sec     = 0;
-    its.it_value.tv_nsec    = 1000 * t.us;
-    its.it_interval.tv_sec  = (t.one_shot) ? 0 : its.it_value.tv_sec;
-    its.it_interval.tv_nsec = (t.one_shot) ? 0 : its.it_value.tv_nsec;
-    timer_settime (t.timer_id, 0, &its, nullptr);
+timer_service_stats timer::get_service_stats() OS_NOEXCEPT
+{
+    return timer_wheel_stats();
 }
 
-inline  void timer::start_from_isr() const OS_NOEXCEPT
+timer_stats& timer::get_global_stats() OS_NOEXCEPT
 {
-    start();
+    static timer_stats global;
+    return global;
 }
 
-void timer::stop() const OS_NOEXCEPT
+osal::exit timer::set_dispatch(timer_dispatch dispatch, error** error) OS_NOEXCEPT
 {
-    itimerspec its {0};
+    if(dispatch == timer_dispatch::POOL && timer_pool_start(error) == exit::KO)
+    {
+        return exit::KO;
+    }
 
-    /* Stop timer */
-    its.it_value.tv_sec     = 0;
-    its.it_value.tv_nsec    = 0;
-    its.it_interval.tv_sec  = 0;
-    its.it_interval.tv_nsec = 0;
-    timer_settime (t.timer_id, 0, &its, nullptr);
+    t.pooled.store(dispatch == timer_dispatch::POOL, std::memory_order_relaxed);
+    return exit::OK;
 }
 
-inline void timer::stop_from_isr() const OS_NOEXCEPT
+uint64_t timer::coalesced() const OS_NOEXCEPT
 {
-    stop();
+    return t.coalesced.load(std::memory_order_relaxed);
+}
+
+uint64_t timer::dropped() const OS_NOEXCEPT
+{
+    return t.dropped.load(std::memory_order_relaxed);
 }
 
-inline bool timer::is_active() const OS_NOEXCEPT
+bool timer::is_active() const OS_NOEXCEPT
 {
-    return !t.exit;
+    return t.armed.load(std::memory_order_relaxed);
 }
 
 }
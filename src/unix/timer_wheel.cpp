@@ -0,0 +1,696 @@
+/***************************************************************************
+ * 
+ * OSAL
+ * Copyright (C) 2023/2024 Antonio Salsi <passy.linux@zresa.it>
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>. 
+ * 
+ ***************************************************************************/
+#include "osal/log.hpp"
+#include "osal_sys/timer_wheel.hpp"
+#include "osal_sys/futex.hpp"
+
+#include <new>
+#include <unistd.h>
+#include <sys/prctl.h>
+#include <sys/timerfd.h>
+
+namespace osal
+{
+inline namespace v1
+{
+
+namespace
+{
+
+constexpr inline const uint8_t TIMER_PRIO = 30;
+constexpr inline const uint32_t TIMER_HEAP = 1024;
+
+/**
+ * Workers running pooled handlers. Each timer is queued at most once: an expiration that finds
+ * its call still queued, or a second one while it runs, is merged into that call.
+ */
+struct timer_pool
+{
+    pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+    pthread_cond_t work = PTHREAD_COND_INITIALIZER;    ///< Signalled when a timer is queued.
+    pthread_cond_t idle = PTHREAD_COND_INITIALIZER;    ///< Broadcast when a handler returns.
+    timer_data* head = nullptr;
+    timer_data* tail = nullptr;
+};
+
+/**
+ * Pooled call running on a worker, reached through pool_current by overrun() and pool_stop().
+ */
+struct pool_call
+{
+    timer_data* timer = nullptr;
+    uint32_t overrun = 0;       ///< Expirations merged into this call.
+    bool gone = false;          ///< Stopped and awaited by its own handler, the timer may be destroyed.
+};
+
+timer_pool pool;
+thread_local pool_call* pool_current = nullptr;
+alignas(class thread) uint8_t pool_storage[sizeof(class thread) * OS_TIMER_WORKER_THREADS];
+pthread_once_t pool_once = PTHREAD_ONCE_INIT;
+std::atomic<bool> pool_running{false};
+
+alignas(timer_wheel) uint8_t wheels_storage[sizeof(timer_wheel) * OS_TIMER_SERVICE_THREADS];
+std::atomic<timer_wheel*> wheels{nullptr};
+pthread_once_t wheels_once = PTHREAD_ONCE_INIT;
+std::atomic<size_t> wheels_next{0};
+
+inline uint64_t now_ns() OS_NOEXCEPT
+{
+    timespec ts{0};
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * NSECS_PER_SEC + ts.tv_nsec;
+}
+
+/**
+ * Records a handler call in the histograms of its timer and in the global ones. A handler may
+ * destroy its own timer, the stats of a timer stopped by its handler are passed as nullptr.
+ */
+inline void record_call(timer_stats* stats, uint32_t overrun, uint64_t scheduled, uint64_t begin, uint64_t end) OS_NOEXCEPT
+{
+    const uint64_t lateness = begin > scheduled ? begin - scheduled : 0;
+    if (stats)
+    {
+        stats->record(lateness, end - begin, overrun);
+    }
+    timer::get_global_stats().record(lateness, end - begin, overrun);
+}
+
+inline void list_push(timer_data** head, timer_data& t) OS_NOEXCEPT
+{
+    t.prev = nullptr;
+    t.next = *head;
+    if (*head)
+    {
+        (*head)->prev = &t;
+    }
+    *head = &t;
+    t.slot = head;
+}
+
+inline void list_unlink(timer_data& t) OS_NOEXCEPT
+{
+    if (t.prev)
+    {
+        t.prev->next = t.next;
+    }
+    else
+    {
+        *t.slot = t.next;
+    }
+    if (t.next)
+    {
+        t.next->prev = t.prev;
+    }
+    t.next = t.prev = nullptr;
+    t.slot = nullptr;
+}
+
+inline uint64_t tick_of(const timer_wheel& w, uint64_t expiry) OS_NOEXCEPT
+{
+    return expiry > w.origin ? (expiry - w.origin) / TIMER_WHEEL_TICK_NS : 0;
+}
+
+/**
+ * File a timer in the level whose range covers its distance from the current tick.
+ */
+void wheel_insert(timer_wheel& w, timer_data& t) OS_NOEXCEPT
+{
+    uint64_t tick = tick_of(w, t.expiry);
+    if (tick < w.current)
+    {
+        tick = w.current;
+    }
+
+    size_t level = 0;
+    while (level < TIMER_WHEEL_LEVELS - 1 && tick - w.current >= uint64_t{1} << (TIMER_WHEEL_BITS * (level + 1)))
+    {
+        level++;
+    }
+
+    // beyond the last level: park in its farthest slot, the cascade files it again
+    const uint64_t range = uint64_t{1} << (TIMER_WHEEL_BITS * TIMER_WHEEL_LEVELS);
+    if (tick - w.current >= range)
+    {
+        tick = w.current + range - 1;
+    }
+
+    list_push(&w.slots[level][(tick >> (TIMER_WHEEL_BITS * level)) & (TIMER_WHEEL_SLOTS - 1)], t);
+    w.count++;
+}
+
+inline void wheel_remove(timer_wheel& w, timer_data& t) OS_NOEXCEPT
+{
+    if (t.slot != &w.expired)
+    {
+        w.count--;
+    }
+    list_unlink(t);
+}
+
+/**
+ * Re-file the slot of each upper level whose period starts at the current tick.
+ */
+void wheel_cascade(timer_wheel& w) OS_NOEXCEPT
+{
+    for (size_t level = TIMER_WHEEL_LEVELS - 1; level > 0; level--)
+    {
+        if (w.current & ((uint64_t{1} << (TIMER_WHEEL_BITS * level)) - 1))
+        {
+            continue;
+        }
+
+        timer_data** slot = &w.slots[level][(w.current >> (TIMER_WHEEL_BITS * level)) & (TIMER_WHEEL_SLOTS - 1)];
+        timer_data* t = *slot;
+        *slot = nullptr;
+        while (t)
+        {
+            timer_data* next = t->next;
+            w.count--;
+            wheel_insert(w, *t);
+            t = next;
+        }
+    }
+}
+
+/**
+ * Move the timers of the current level 0 slot that are due at now to the expired list.
+ */
+void wheel_collect(timer_wheel& w, uint64_t now) OS_NOEXCEPT
+{
+    timer_data* t = w.slots[0][w.current & (TIMER_WHEEL_SLOTS - 1)];
+    while (t)
+    {
+        timer_data* next = t->next;
+        if (t->expiry <= now)
+        {
+            wheel_remove(w, *t);
+            list_push(&w.expired, *t);
+        }
+        t = next;
+    }
+}
+
+/**
+ * Advance the wheel to now: every tick before the current one is due as a whole, the current
+ * tick only up to now.
+ */
+void wheel_advance(timer_wheel& w, uint64_t now) OS_NOEXCEPT
+{
+    const uint64_t now_tick = tick_of(w, now);
+
+    // nothing filed: skip the idle stretch at once
+    if (w.count == 0 && w.current < now_tick)
+    {
+        w.current = now_tick;
+    }
+
+    while (w.current < now_tick)
+    {
+        wheel_collect(w, now);
+        w.current++;
+        wheel_cascade(w);
+    }
+    wheel_collect(w, now);
+}
+
+/**
+ * Latest time at which an expiration can still be served: expiry plus the timer slack.
+ */
+inline uint64_t hard_expiry(const timer_data& t) OS_NOEXCEPT
+{
+    const uint64_t slack = t.slack.load(std::memory_order_relaxed);
+    return WAIT_FOREVER - t.expiry > slack ? t.expiry + slack : WAIT_FOREVER;
+}
+
+/**
+ * Latest time the service can sleep until: the earliest slack-extended expiration in level 0,
+ * or the start of the first upper slot that has to cascade before it. Every timer already due at
+ * that time is served by the same wakeup.
+ */
+uint64_t wheel_next(const timer_wheel& w) OS_NOEXCEPT
+{
+    if (w.count == 0)
+    {
+        return WAIT_FOREVER;
+    }
+
+    uint64_t next = WAIT_FOREVER;
+    for (size_t i = 0; i < TIMER_WHEEL_SLOTS; i++)
+    {
+        // the timers of this slot and beyond expire after its start, they cannot come earlier
+        const uint64_t start = w.origin + (w.current + i) * TIMER_WHEEL_TICK_NS;
+        if (i && start >= next)
+        {
+            break;
+        }
+
+        for (const timer_data* t = w.slots[0][(w.current + i) & (TIMER_WHEEL_SLOTS - 1)]; t; t = t->next)
+        {
+            const uint64_t hard = hard_expiry(*t);
+            next = hard < next ? hard : next;
+        }
+    }
+
+    for (size_t level = 1; level < TIMER_WHEEL_LEVELS; level++)
+    {
+        const size_t shift = TIMER_WHEEL_BITS * level;
+        for (uint64_t i = 1; i <= TIMER_WHEEL_SLOTS; i++)
+        {
+            const uint64_t index = (w.current >> shift) + i;
+            if (w.slots[level][index & (TIMER_WHEEL_SLOTS - 1)])
+            {
+                const uint64_t start = w.origin + (index << shift) * TIMER_WHEEL_TICK_NS;
+                next = start < next ? start : next;
+                break;
+            }
+        }
+    }
+
+    return next;
+}
+
+inline void pool_push(timer_data& t) OS_NOEXCEPT
+{
+    t.pool_next = nullptr;
+    if (pool.tail)
+    {
+        pool.tail->pool_next = &t;
+    }
+    else
+    {
+        pool.head = &t;
+    }
+    pool.tail = &t;
+    t.queued = true;
+    pthread_cond_signal(&pool.work);
+}
+
+/**
+ * Hand an expiration to the workers, or merge it into the call already queued or pending.
+ */
+void pool_post(timer_data& t, uint32_t overrun, uint64_t scheduled) OS_NOEXCEPT
+{
+    pthread_mutex_lock(&pool.mutex);
+    if (t.queued || t.again)
+    {
+        t.coalesced.fetch_add(1, std::memory_order_relaxed);
+        overrun++;
+    }
+    else if (t.busy)
+    {
+        // serialized: queued again once the running call returns
+        t.again = true;
+        t.pool_scheduled = scheduled;
+    }
+    else
+    {
+        pool_push(t);
+        t.pool_scheduled = scheduled;
+    }
+    t.pool_overrun = UINT32_MAX - t.pool_overrun > overrun ? t.pool_overrun + overrun : UINT32_MAX;
+    pthread_mutex_unlock(&pool.mutex);
+}
+
+void* pool_worker(void*)
+{
+    pthread_mutex_lock(&pool.mutex);
+    while (true)
+    {
+        while (pool.head == nullptr)
+        {
+            pthread_cond_wait(&pool.work, &pool.mutex);
+        }
+
+        timer_data& t = *pool.head;
+        pool.head = t.pool_next;
+        if (pool.head == nullptr)
+        {
+            pool.tail = nullptr;
+        }
+        t.queued = false;
+        t.busy = true;
+        pool_call call{&t, t.pool_overrun};
+        t.pool_overrun = 0;
+        const uint64_t scheduled = t.pool_scheduled;
+        timer_stats* const stats = t.stats;
+        pool_current = &call;
+
+        pthread_mutex_unlock(&pool.mutex);
+        if (t.fn)
+        {
+            const uint64_t begin = now_ns();
+            t.fn(t.owner, t.arg);
+            record_call(call.gone ? nullptr : stats, call.overrun, scheduled, begin, now_ns());
+        }
+        pthread_mutex_lock(&pool.mutex);
+
+        // a handler that stopped its own timer with wait may have destroyed it, t is not touched
+        pool_current = nullptr;
+        if (!call.gone)
+        {
+            t.busy = false;
+            if (t.again)
+            {
+                t.again = false;
+                pool_push(t);
+            }
+        }
+        pthread_cond_broadcast(&pool.idle);
+    }
+    return nullptr;
+}
+
+/**
+ * Withdraw a queued call and wait for a running one, unless called by that handler.
+ */
+void pool_stop(timer_data& t, bool wait) OS_NOEXCEPT
+{
+    pthread_mutex_lock(&pool.mutex);
+    if (t.queued)
+    {
+        timer_data** link = &pool.head;
+        timer_data* prev = nullptr;
+        while (*link != &t)
+        {
+            prev = *link;
+            link = &prev->pool_next;
+        }
+        *link = t.pool_next;
+        if (pool.tail == &t)
+        {
+            pool.tail = prev;
+        }
+        t.queued = false;
+        t.dropped.fetch_add(1, std::memory_order_relaxed);
+    }
+    if (t.again)
+    {
+        t.again = false;
+        t.dropped.fetch_add(1, std::memory_order_relaxed);
+    }
+    t.pool_overrun = 0;
+
+    if (wait && pool_current && pool_current->timer == &t)
+    {
+        // called by the running handler, likely from the destructor: the worker must not touch
+        // the timer once the handler returns
+        pool_current->gone = true;
+        t.busy = false;
+    }
+    else if (wait)
+    {
+        while (t.busy)
+        {
+            pthread_cond_wait(&pool.idle, &pool.mutex);
+        }
+    }
+    pthread_mutex_unlock(&pool.mutex);
+}
+
+void pool_init() OS_NOEXCEPT
+{
+    auto workers = reinterpret_cast<class thread*>(pool_storage);
+    for (size_t i = 0; i < OS_TIMER_WORKER_THREADS; i++)
+    {
+        auto worker = new (workers + i) class thread("os_timer_pool", TIMER_PRIO, TIMER_HEAP, pool_worker);
+        if (worker->create() == exit::KO)
+        {
+            return;
+        }
+    }
+    pool_running.store(true, std::memory_order_release);
+}
+
+/**
+ * Run the expired handlers one at a time with the mutex released, a periodic timer is armed
+ * again before its handler runs so that the handler can stop it. Catching up leaves the next
+ * expiration in the past: it is collected again on the next round. Returns the expirations served.
+ */
+size_t wheel_dispatch(timer_wheel& w, uint64_t now) OS_NOEXCEPT
+{
+    size_t dispatched = 0;
+
+    for (; w.expired; dispatched++)
+    {
+        timer_data& t = *w.expired;
+        list_unlink(t);
+
+        const uint64_t scheduled = t.expiry;
+        uint32_t overrun = 0;
+        const uint64_t period = t.period.load(std::memory_order_relaxed);
+        if (t.one_shot || period == 0)
+        {
+            t.armed.store(false, std::memory_order_relaxed);
+        }
+        else
+        {
+            // the next expiration follows the schedule, not the time this one was served
+            t.expiry += period;
+            if (t.expiry <= now)
+            {
+                const uint64_t missed = (now - t.expiry) / period + 1;
+                overrun = missed < UINT32_MAX ? static_cast<uint32_t>(missed) : UINT32_MAX;
+                if (!t.catch_up.load(std::memory_order_relaxed))
+                {
+                    t.expiry += missed * period;
+                }
+            }
+            wheel_insert(w, t);
+        }
+
+        // lock order is wheel then pool, as in timer_wheel_stop(); a pooled call has its own overrun,
+        // t.overrun belongs to the inline calls made on this thread
+        if (t.pooled.load(std::memory_order_relaxed))
+        {
+            pool_post(t, overrun, scheduled);
+            continue;
+        }
+
+        t.overrun = overrun;
+        timer_stats* const stats = t.stats;
+        w.running = &t;
+        pthread_mutex_unlock(&w.mutex);
+        if (t.fn)
+        {
+            const uint64_t begin = now_ns();
+            t.fn(t.owner, t.arg);
+            // only this thread clears w.running before the call returns, see timer_wheel_stop()
+            record_call(w.running == &t ? stats : nullptr, overrun, scheduled, begin, now_ns());
+        }
+        pthread_mutex_lock(&w.mutex);
+        w.running = nullptr;
+        pthread_cond_broadcast(&w.idle);
+    }
+
+    return dispatched;
+}
+
+/**
+ * Program the timerfd to the absolute wake time, WAIT_FOREVER disarms it.
+ */
+inline void wheel_arm(timer_wheel& w, uint64_t wake) OS_NOEXCEPT
+{
+    itimerspec its{};
+    if (wake != WAIT_FOREVER)
+    {
+        // 0 would disarm the timerfd, a past time expires at once
+        its.it_value = timespec_from_tick(wake ? wake : 1);
+    }
+    w.wake = wake;
+    timerfd_settime(w.fd, TFD_TIMER_ABSTIME, &its, nullptr);
+}
+
+void* wheel_service(void* arg)
+{
+    auto& w = *static_cast<timer_wheel*>(arg);
+    uint64_t expirations = 0;
+
+    // the default 50 us slack of normal threads would show up as jitter
+    prctl(PR_SET_TIMERSLACK, 1UL);
+
+    pthread_mutex_lock(&w.mutex);
+    w.service = pthread_self();
+    while (true)
+    {
+        const uint64_t now = now_ns();
+        wheel_advance(w, now);
+
+        const size_t dispatched = wheel_dispatch(w, now);
+        w.stats.wakeups++;
+        w.stats.expirations += dispatched;
+        w.stats.saved_wakeups += dispatched > 1 ? dispatched - 1 : 0;
+
+        wheel_arm(w, wheel_next(w));
+
+        pthread_mutex_unlock(&w.mutex);
+        if (read(w.fd, &expirations, sizeof(expirations)) < 0 && errno != EINTR)
+        {
+            // every timer of this wheel stops expiring from here on
+            OS_LOG_ERROR("TIMER", "Timer service read() fail, errno %d: timers stopped.", errno);
+            return nullptr;
+        }
+        pthread_mutex_lock(&w.mutex);
+    }
+    return nullptr;
+}
+
+void wheels_init() OS_NOEXCEPT
+{
+    auto storage = reinterpret_cast<timer_wheel*>(wheels_storage);
+    for (size_t i = 0; i < OS_TIMER_SERVICE_THREADS; i++)
+    {
+        auto w = new (storage + i) timer_wheel;
+        w->fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+        if (w->fd == -1 || w->worker.create(w) == exit::KO)
+        {
+            return;
+        }
+    }
+    wheels.store(storage, std::memory_order_release);
+}
+
+}
+
+timer_wheel::timer_wheel() OS_NOEXCEPT
+    : origin(now_ns())
+    , wake(WAIT_FOREVER)
+    , worker("os_timer", TIMER_PRIO, TIMER_HEAP, wheel_service)
+{
+    pthread_cond_init(&idle, nullptr);
+}
+
+osal::exit timer_pool_start(error** error) OS_NOEXCEPT
+{
+    pthread_once(&pool_once, pool_init);
+    if (!pool_running.load(std::memory_order_acquire))
+    {
+        if(error)
+        {
+            *error = OS_ERROR_BUILD("Impossible create timer worker pool.", error_type::OS_EAGAIN);
+            OS_ERROR_PTR_SET_POSITION(*error);
+        }
+        return exit::KO;
+    }
+    return exit::OK;
+}
+
+timer_service_stats timer_wheel_stats() OS_NOEXCEPT
+{
+    timer_service_stats stats{};
+    timer_wheel* all = wheels.load(std::memory_order_acquire);
+
+    for (size_t i = 0; all && i < OS_TIMER_SERVICE_THREADS; i++)
+    {
+        pthread_mutex_lock(&all[i].mutex);
+        stats.wakeups += all[i].stats.wakeups;
+        stats.expirations += all[i].stats.expirations;
+        stats.saved_wakeups += all[i].stats.saved_wakeups;
+        pthread_mutex_unlock(&all[i].mutex);
+    }
+    return stats;
+}
+
+timer_wheel* timer_wheel_get(error** error) OS_NOEXCEPT
+{
+    pthread_once(&wheels_once, wheels_init);
+    timer_wheel* all = wheels.load(std::memory_order_acquire);
+    if (all == nullptr)
+    {
+        if(error)
+        {
+            *error = OS_ERROR_BUILD("Impossible create timer service.", error_type::OS_EAGAIN);
+            OS_ERROR_PTR_SET_POSITION(*error);
+        }
+        return nullptr;
+    }
+
+    return &all[wheels_next.fetch_add(1, std::memory_order_relaxed) % OS_TIMER_SERVICE_THREADS];
+}
+
+void timer_wheel_start(timer_data& t, uint64_t expiry) OS_NOEXCEPT
+{
+    timer_wheel& w = *t.wheel;
+
+    pthread_mutex_lock(&w.mutex);
+    if (t.slot)
+    {
+        wheel_remove(w, t);
+    }
+    t.expiry = expiry;
+    t.armed.store(true, std::memory_order_relaxed);
+    wheel_insert(w, t);
+
+    // the service blocks on the timerfd: moving it earlier is enough to wake it in time
+    const uint64_t hard = hard_expiry(t);
+    if (hard < w.wake)
+    {
+        wheel_arm(w, hard);
+    }
+    pthread_mutex_unlock(&w.mutex);
+}
+
+uint32_t timer_wheel_overrun(const timer_data& t) OS_NOEXCEPT
+{
+    // only the worker running the pooled call sees it, pool_current is per thread
+    if (pool_current && pool_current->timer == &t)
+    {
+        return pool_current->overrun;
+    }
+    return t.overrun;
+}
+
+void timer_wheel_stop(timer_data& t, bool wait) OS_NOEXCEPT
+{
+    timer_wheel& w = *t.wheel;
+
+    pthread_mutex_lock(&w.mutex);
+    if (t.slot)
+    {
+        wheel_remove(w, t);
+    }
+    t.armed.store(false, std::memory_order_relaxed);
+
+    if (wait && pthread_equal(pthread_self(), w.service))
+    {
+        // called by the running handler, likely from the destructor: the service must not touch
+        // the timer once the handler returns
+        if (w.running == &t)
+        {
+            w.running = nullptr;
+        }
+    }
+    else if (wait)
+    {
+        while (w.running == &t)
+        {
+            pthread_cond_wait(&w.idle, &w.mutex);
+        }
+    }
+    pthread_mutex_unlock(&w.mutex);
+
+    // disarmed above, the service cannot queue the timer any more; a running pooled handler may
+    // itself need the wheel mutex, so it is awaited without holding it
+    if (pool_running.load(std::memory_order_acquire))
+    {
+        pool_stop(t, wait);
+    }
+}
+
+}
+}
@@ -21,6 +21,8 @@
 #include"osal/osal.hpp"
 #include"common_test.hpp"
 
+#include <atomic>
+
 
 #define BIT1 0x01
 #define BIT2 0x02
@@ -105,3 +107,58 @@ TEST(event_test, test_set_get)
 
     ASSERT_EQ(event1.get(), BIT1);
 }
+
+TEST(event_test, wait_per_bit)
+{
+    static os::event bits;
+    static std::atomic<uint32_t> woken[2];
+    auto waiter = [](void* arg) -> void*
+    {
+        const uint32_t i = static_cast<uint32_t>(reinterpret_cast<uintptr_t>(arg));
+        uint32_t value = 0;
+        if(bits.wait(1u << i, value, 2'000) == osal::exit::OK && value == (1u << i))
+        {
+            woken[i]++;
+        }
+        return nullptr;
+    };
+    os::thread waiter1{"waiter_1", 4, OASL_TASK_HEAP, waiter};
+    os::thread waiter2{"waiter_2", 4, OASL_TASK_HEAP, waiter};
+
+    waiter1.create(reinterpret_cast<void*>(uintptr_t{0}));
+    waiter2.create(reinterpret_cast<void*>(uintptr_t{1}));
+    os::us_sleep(20'000);
+
+    // each waiter returns on its own bit only
+    bits.set(0x04);
+    bits.set(BIT2);
+    os::us_sleep(20'000);
+    ASSERT_EQ(woken[0], 0);
+    ASSERT_EQ(woken[1], 1);
+
+    bits.set(BIT1);
+    waiter1.join();
+    waiter2.join();
+    ASSERT_EQ(woken[0], 1);
+    ASSERT_EQ(bits.get(), BIT1 | BIT2 | 0x04);
+
+    bits.clear(BIT1 | BIT2 | 0x04);
+    ASSERT_EQ(bits.get(), 0);
+}
+
+TEST(event_test, wait_timeout)
+{
+    os::event bits;
+    os::error* error = nullptr;
+    uint32_t value = 0;
+
+    bits.set(BIT2);
+    ASSERT_EQ(bits.wait(BIT1, value, 20, &error), osal::exit::KO);
+    ASSERT_NE(error, nullptr);
+    ASSERT_EQ(error->get_code(), static_cast<uint8_t>(os::error_type::OS_ETIMEDOUT));
+    ASSERT_EQ(value, 0);
+    delete error;
+
+    ASSERT_EQ(bits.wait(BIT2, value, 0), osal::exit::OK);
+    ASSERT_EQ(value, BIT2);
+}
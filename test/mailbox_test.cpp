@@ -0,0 +1,135 @@
+/***************************************************************************
+ * 
+ * OSAL
+ * Copyright (C) 2023/2024 Antonio Salsi <passy.linux@zresa.it>
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>. 
+ * 
+ ***************************************************************************/
+#include <gtest/gtest.h>
+
+#include"osal/osal.hpp"
+#include"common_test.hpp"
+
+#include <atomic>
+
+namespace
+{
+
+struct pose
+{
+    uint64_t x;
+    uint64_t y;     ///< Always ~x, a torn read breaks the pair.
+};
+
+constexpr uint32_t POSE_WRITES = 200'000;
+os::mailbox* pose_box = nullptr;
+std::atomic<bool> pose_done{false};
+std::atomic<uint32_t> pose_torn{0};
+
+}
+
+TEST(mailbox_test, overwrite_peek)
+{
+    os::mailbox box{sizeof(pose)};
+
+    pose p{};
+    os::error* error = nullptr;
+    EXPECT_EQ(box.peek(&p, 10, &error), osal::exit::KO);
+    ASSERT_NE(error, nullptr);
+    EXPECT_EQ(error->get_code(), static_cast<uint8_t>(os::error_type::OS_ETIMEDOUT));
+    delete error;
+
+    for(uint64_t i = 1; i <= 3; i++)
+    {
+        const pose w{i, ~i};
+        EXPECT_EQ(box.overwrite(reinterpret_cast<const uint8_t *>(&w)), osal::exit::OK);
+    }
+
+    // peek does not consume: every reader sees the newest value
+    for(int i = 0; i < 2; i++)
+    {
+        EXPECT_EQ(box.peek(&p, 0), osal::exit::OK);
+        EXPECT_EQ(p.x, 3);
+        EXPECT_EQ(p.y, ~uint64_t{3});
+    }
+}
+
+TEST(mailbox_test, first_value_wakes_reader)
+{
+    os::mailbox box{sizeof(pose)};
+    pose_box = &box;
+
+    os::thread writer{"writer", 4, OASL_TASK_HEAP, [](void*) -> void*
+    {
+        os::us_sleep(20'000);
+        const pose w{42, ~uint64_t{42}};
+        pose_box->overwrite(reinterpret_cast<const uint8_t *>(&w));
+        return nullptr;
+    }};
+    ASSERT_EQ(writer.create(), osal::exit::OK);
+
+    pose p{};
+    EXPECT_EQ(box.peek(&p, 1'000), osal::exit::OK);
+    EXPECT_EQ(p.x, 42);
+    writer.join();
+}
+
+TEST(mailbox_test, readers_never_tear)
+{
+    os::mailbox box{sizeof(pose)};
+    pose_box = &box;
+    pose_done = false;
+    pose_torn = 0;
+
+    auto reader = [](void*) -> void*
+    {
+        pose p{};
+        uint64_t last = 0;
+        while(!pose_done)
+        {
+            if(pose_box->peek(&p, os::WAIT_FOREVER) == osal::exit::OK)
+            {
+                if(p.y != ~p.x || p.x < last)
+                {
+                    pose_torn++;
+                }
+                last = p.x;
+            }
+        }
+        return nullptr;
+    };
+
+    os::thread reader1{"reader1", 4, OASL_TASK_HEAP, reader};
+    os::thread reader2{"reader2", 4, OASL_TASK_HEAP, reader};
+    os::thread reader3{"reader3", 4, OASL_TASK_HEAP, reader};
+
+    const pose first{1, ~uint64_t{1}};
+    box.overwrite(reinterpret_cast<const uint8_t *>(&first));
+    ASSERT_EQ(reader1.create(), osal::exit::OK);
+    ASSERT_EQ(reader2.create(), osal::exit::OK);
+    ASSERT_EQ(reader3.create(), osal::exit::OK);
+
+    for(uint64_t i = 2; i <= POSE_WRITES; i++)
+    {
+        const pose w{i, ~i};
+        box.overwrite(reinterpret_cast<const uint8_t *>(&w));
+    }
+    pose_done = true;
+
+    reader1.join();
+    reader2.join();
+    reader3.join();
+
+    EXPECT_EQ(pose_torn, 0);
+}
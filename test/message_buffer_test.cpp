@@ -0,0 +1,165 @@
+/***************************************************************************
+ * 
+ * OSAL
+ * Copyright (C) 2023/2024 Antonio Salsi <passy.linux@zresa.it>
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>. 
+ * 
+ ***************************************************************************/
+#include <gtest/gtest.h>
+
+#include"osal/osal.hpp"
+#include"common_test.hpp"
+
+#include <string.h>
+
+namespace
+{
+
+constexpr uint32_t PACKETS = 20'000;
+os::message_buffer* packets = nullptr;
+
+// packet n carries n % 97 + 1 bytes, each set to n
+size_t packet_size(uint32_t n)
+{
+    return n % 97 + 1;
+}
+
+}
+
+TEST(message_buffer_test, send_receive)
+{
+    os::message_buffer mb{32};
+    uint8_t buffer[32];
+
+    ASSERT_TRUE(mb.is_empty());
+    ASSERT_EQ(mb.next_size(), 0);
+    ASSERT_EQ(mb.receive(buffer, sizeof(buffer), 0), 0);
+
+    ASSERT_EQ(mb.send(reinterpret_cast<const uint8_t*>("hello"), 5, 0), 5);
+    ASSERT_EQ(mb.send(reinterpret_cast<const uint8_t*>("world!!"), 7, 0), 7);
+    // 4 + 5 + 4 + 7 bytes used: a 10 byte message with its prefix does not fit
+    ASSERT_EQ(mb.bytes_free(), 12);
+    ASSERT_EQ(mb.send(reinterpret_cast<const uint8_t*>("0123456789"), 10, 0), 0);
+
+    ASSERT_EQ(mb.next_size(), 5);
+    os::error* error = nullptr;
+    ASSERT_EQ(mb.receive(buffer, 4, 0, &error), 0);
+    ASSERT_NE(error, nullptr);
+    EXPECT_EQ(error->get_code(), static_cast<uint8_t>(os::error_type::OS_EMSGSIZE));
+    delete error;
+
+    ASSERT_EQ(mb.receive(buffer, sizeof(buffer), 0), 5);
+    ASSERT_EQ(memcmp(buffer, "hello", 5), 0);
+
+    // the next message wraps around the end of the ring
+    ASSERT_EQ(mb.send(reinterpret_cast<const uint8_t*>("0123456789"), 10, 0), 10);
+    ASSERT_EQ(mb.receive(buffer, sizeof(buffer), 0), 7);
+    ASSERT_EQ(memcmp(buffer, "world!!", 7), 0);
+    ASSERT_EQ(mb.receive(buffer, sizeof(buffer), 0), 10);
+    ASSERT_EQ(memcmp(buffer, "0123456789", 10), 0);
+    ASSERT_TRUE(mb.is_empty());
+
+    error = nullptr;
+    ASSERT_EQ(mb.send(buffer, 29, 0, &error), 0);
+    ASSERT_NE(error, nullptr);
+    EXPECT_EQ(error->get_code(), static_cast<uint8_t>(os::error_type::OS_EMSGSIZE));
+    delete error;
+
+    // an empty message could not be told from a timeout on the receiving side
+    error = nullptr;
+    ASSERT_EQ(mb.send(buffer, 0, 0, &error), 0);
+    ASSERT_NE(error, nullptr);
+    EXPECT_EQ(error->get_code(), static_cast<uint8_t>(os::error_type::OS_EINVAL));
+    delete error;
+    ASSERT_TRUE(mb.is_empty());
+}
+
+TEST(message_buffer_test, two_thread)
+{
+    os::message_buffer mb{256};
+    packets = &mb;
+
+    os::thread sender{"sender", 4, OASL_TASK_HEAP, [](void*) -> void*
+    {
+        uint8_t data[128];
+        for(uint32_t n = 0; n < PACKETS; n++)
+        {
+            memset(data, static_cast<uint8_t>(n), packet_size(n));
+            packets->send(data, packet_size(n), os::WAIT_FOREVER);
+        }
+        return nullptr;
+    }};
+    ASSERT_EQ(sender.create(), osal::exit::OK);
+
+    uint8_t data[128];
+    for(uint32_t n = 0; n < PACKETS; n++)
+    {
+        const size_t size = mb.receive(data, sizeof(data), 1'000);
+        ASSERT_EQ(size, packet_size(n));
+        for(size_t i = 0; i < size; i++)
+        {
+            ASSERT_EQ(data[i], static_cast<uint8_t>(n));
+        }
+    }
+    sender.join();
+    ASSERT_TRUE(mb.is_empty());
+}
+
+TEST(message_buffer_test, two_senders)
+{
+    os::message_buffer mb{256};
+    packets = &mb;
+
+    // each message is [sender, n, payload set to sender ^ n], a torn one mixes the two patterns
+    auto send = [](void* arg) -> void*
+    {
+        const uint8_t id = static_cast<uint8_t>(reinterpret_cast<uintptr_t>(arg));
+        uint8_t data[128];
+        for(uint32_t n = 0; n < PACKETS; n++)
+        {
+            const size_t size = packet_size(n) + 5;
+            data[0] = id;
+            memcpy(data + 1, &n, sizeof(n));
+            memset(data + 5, static_cast<uint8_t>(id ^ n), size - 5);
+            packets->send(data, size, os::WAIT_FOREVER);
+        }
+        return nullptr;
+    };
+    os::thread sender1{"sender_1", 4, OASL_TASK_HEAP, send};
+    os::thread sender2{"sender_2", 4, OASL_TASK_HEAP, send};
+    ASSERT_EQ(sender1.create(reinterpret_cast<void*>(uintptr_t{0x11})), osal::exit::OK);
+    ASSERT_EQ(sender2.create(reinterpret_cast<void*>(uintptr_t{0x22})), osal::exit::OK);
+
+    uint32_t next[2] = {0, 0};
+    uint8_t data[128];
+    for(uint32_t i = 0; i < 2 * PACKETS; i++)
+    {
+        const size_t size = mb.receive(data, sizeof(data), 1'000);
+        ASSERT_GE(size, 6);
+        ASSERT_TRUE(data[0] == 0x11 || data[0] == 0x22);
+
+        uint32_t n = 0;
+        memcpy(&n, data + 1, sizeof(n));
+        uint32_t& expected = next[data[0] == 0x11 ? 0 : 1];
+        ASSERT_EQ(n, expected++);
+        ASSERT_EQ(size, packet_size(n) + 5);
+        for(size_t j = 5; j < size; j++)
+        {
+            ASSERT_EQ(data[j], static_cast<uint8_t>(data[0] ^ n));
+        }
+    }
+    sender1.join();
+    sender2.join();
+    ASSERT_TRUE(mb.is_empty());
+}
@@ -0,0 +1,106 @@
+/***************************************************************************
+ * 
+ * OSAL
+ * Copyright (C) 2023/2024 Antonio Salsi <passy.linux@zresa.it>
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>. 
+ * 
+ ***************************************************************************/
+#include <gtest/gtest.h>
+
+#include"osal/osal.hpp"
+#include"common_test.hpp"
+
+#include <stdio.h>
+
+namespace
+{
+
+struct command
+{
+    uint32_t id;
+    uint8_t priority;
+};
+
+os::priority_queue* urgent_queue = nullptr;
+
+}
+
+TEST(priority_queue_test, order)
+{
+    os::priority_queue queue{8, sizeof(command)};
+    const command commands[] = { {0, 1}, {1, 5}, {2, 1}, {3, 9}, {4, 5}, {5, 0}, {6, 9}, {7, 1} };
+
+    for(auto& c : commands)
+    {
+        EXPECT_EQ(queue.post(reinterpret_cast<const uint8_t *>(&c), c.priority, 0), osal::exit::OK);
+    }
+    EXPECT_EQ(queue.size(), 8);
+
+    os::error* error = nullptr;
+    EXPECT_EQ(queue.post(reinterpret_cast<const uint8_t *>(&commands[0]), 0, 10, &error), osal::exit::KO);
+    ASSERT_NE(error, nullptr);
+    delete error;
+
+    // highest priority first, post order among equal priorities
+    const uint32_t expected[] = {3, 6, 1, 4, 0, 2, 7, 5};
+    for(auto id : expected)
+    {
+        command c{};
+        EXPECT_EQ(queue.fetch(&c, 0), osal::exit::OK);
+        EXPECT_EQ(c.id, id);
+    }
+    EXPECT_EQ(queue.size(), 0);
+
+    command c{};
+    EXPECT_EQ(queue.fetch(&c, 10), osal::exit::KO);
+}
+
+TEST(priority_queue_test, reuse_slots)
+{
+    os::priority_queue queue{3, sizeof(command)};
+
+    for(uint32_t round = 0; round < 100; round++)
+    {
+        const command low{round, 1};
+        const command high{round + 1'000, 2};
+        ASSERT_EQ(queue.post(reinterpret_cast<const uint8_t *>(&low), low.priority, 0), osal::exit::OK);
+        ASSERT_EQ(queue.post(reinterpret_cast<const uint8_t *>(&high), high.priority, 0), osal::exit::OK);
+
+        command c{};
+        ASSERT_EQ(queue.fetch(&c, 0), osal::exit::OK);
+        ASSERT_EQ(c.id, high.id);
+        ASSERT_EQ(queue.fetch(&c, 0), osal::exit::OK);
+        ASSERT_EQ(c.id, low.id);
+    }
+}
+
+TEST(priority_queue_test, blocking_fetch)
+{
+    os::priority_queue queue{4, sizeof(command)};
+    urgent_queue = &queue;
+
+    os::thread producer{"producer", 4, OASL_TASK_HEAP, [](void*) -> void*
+    {
+        os::us_sleep(20'000);
+        const command c{42, 7};
+        urgent_queue->post(reinterpret_cast<const uint8_t *>(&c), c.priority, os::WAIT_FOREVER);
+        return nullptr;
+    }};
+    ASSERT_EQ(producer.create(), osal::exit::OK);
+
+    command c{};
+    EXPECT_EQ(queue.fetch(&c, 1'000), osal::exit::OK);
+    EXPECT_EQ(c.id, 42);
+    producer.join();
+}
@@ -0,0 +1,121 @@
+/***************************************************************************
+ * 
+ * OSAL
+ * Copyright (C) 2023/2024 Antonio Salsi <passy.linux@zresa.it>
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>. 
+ * 
+ ***************************************************************************/
+#include <gtest/gtest.h>
+
+#include"osal/osal.hpp"
+#include"common_test.hpp"
+
+namespace
+{
+os::queue* set_queue = nullptr;
+}
+
+TEST(queue_set_test, select)
+{
+    os::queue q{4, sizeof(uint32_t)};
+    os::semaphore sem{0};
+    os::event ev;
+    os::queue_set set{8};
+
+    ASSERT_EQ(set.add(q), osal::exit::OK);
+    ASSERT_EQ(set.add(sem), osal::exit::OK);
+    ASSERT_EQ(set.add(ev, 0x02), osal::exit::OK);
+
+    os::error* error = nullptr;
+    EXPECT_EQ(set.select(10, &error), nullptr);
+    ASSERT_NE(error, nullptr);
+    EXPECT_EQ(error->get_code(), static_cast<uint8_t>(os::error_type::OS_ETIMEDOUT));
+    delete error;
+
+    sem.signal();
+    EXPECT_EQ(set.select(0), &sem);
+    EXPECT_EQ(sem.wait(0), osal::exit::OK);
+
+    ev.set(0x01);
+    EXPECT_EQ(set.select(0), nullptr);
+    ev.set(0x02);
+    EXPECT_EQ(set.select(0), &ev);
+    ev.clear(0x03);
+
+    set_queue = &q;
+    os::thread producer{"producer", 4, OASL_TASK_HEAP, [](void*) -> void*
+    {
+        os::us_sleep(20'000);
+        uint32_t value = 7;
+        set_queue->post(reinterpret_cast<const uint8_t *>(&value), os::WAIT_FOREVER);
+        return nullptr;
+    }};
+    ASSERT_EQ(producer.create(), osal::exit::OK);
+
+    EXPECT_EQ(set.select(1'000), &q);
+    uint32_t value = 0;
+    EXPECT_EQ(q.fetch(&value, 0), osal::exit::OK);
+    EXPECT_EQ(value, 7);
+    producer.join();
+
+    EXPECT_EQ(set.select(0), nullptr);
+}
+
+TEST(queue_set_test, fairness)
+{
+    os::semaphore first{0};
+    os::semaphore second{0};
+    os::queue_set set{8};
+
+    ASSERT_EQ(set.add(first), osal::exit::OK);
+    ASSERT_EQ(set.add(second), osal::exit::OK);
+
+    for(int i = 0; i < 4; i++)
+    {
+        first.signal();
+    }
+    second.signal();
+
+    // a member that stays ready does not hide the others
+    void* a = set.select(0);
+    void* b = set.select(0);
+    EXPECT_NE(a, b);
+}
+
+TEST(queue_set_test, membership)
+{
+    os::semaphore sem{0};
+    os::queue_set set{2};
+    os::queue_set other{2};
+
+    ASSERT_EQ(set.add(sem), osal::exit::OK);
+
+    os::error* error = nullptr;
+    EXPECT_EQ(other.add(sem, &error), osal::exit::KO);
+    ASSERT_NE(error, nullptr);
+    EXPECT_EQ(error->get_code(), static_cast<uint8_t>(os::error_type::OS_EEXIST));
+    delete error;
+    error = nullptr;
+
+    EXPECT_EQ(set.remove(sem), osal::exit::OK);
+    EXPECT_EQ(set.remove(sem, &error), osal::exit::KO);
+    ASSERT_NE(error, nullptr);
+    EXPECT_EQ(error->get_code(), static_cast<uint8_t>(os::error_type::OS_ENOENT));
+    delete error;
+
+    EXPECT_EQ(other.add(sem), osal::exit::OK);
+    sem.signal();
+    EXPECT_EQ(set.select(0), nullptr);
+    EXPECT_EQ(other.select(0), &sem);
+}
@@ -19,8 +19,11 @@
 #include <gtest/gtest.h>
 
 #include"osal/osal.hpp"
+#include"common_test.hpp"
 
+#include <atomic>
 #include <stdio.h>
+#include <string.h>
 
 #define APP_TAG "queue"
 
@@ -110,3 +113,343 @@ TEST(queue_test, single_thread)
     EXPECT_EQ(mbox.size(), 0);
 
 }
+
+TEST(queue_test, spsc_single_thread)
+{
+    os::queue mbox{3, sizeof(uint32_t), os::queue_mode::SPSC};
+
+    for(uint32_t i = 0; i < 3; i++)
+    {
+        EXPECT_EQ(mbox.post(reinterpret_cast<const uint8_t *>(&i), 0), osal::exit::OK);
+    }
+    EXPECT_EQ(mbox.size(), 3);
+
+    uint32_t value = 99;
+    os::error* error = nullptr;
+    EXPECT_EQ(mbox.post(reinterpret_cast<const uint8_t *>(&value), 10, &error), osal::exit::KO);
+    ASSERT_NE(error, nullptr);
+    EXPECT_EQ(error->get_code(), static_cast<uint8_t>(os::error_type::OS_ETIMEDOUT));
+    delete error;
+
+    for(uint32_t i = 0; i < 3; i++)
+    {
+        EXPECT_EQ(mbox.fetch(&value, 0), osal::exit::OK);
+        EXPECT_EQ(value, i);
+    }
+    EXPECT_EQ(mbox.size(), 0);
+    EXPECT_EQ(mbox.fetch(&value, 10), osal::exit::KO);
+}
+
+namespace
+{
+constexpr uint32_t SPSC_MESSAGES = 100'000;
+}
+
+TEST(queue_test, spsc_two_thread)
+{
+    static os::queue mbox{16, sizeof(uint32_t), os::queue_mode::SPSC};
+
+    os::thread producer{"producer", 4, OASL_TASK_HEAP, [](void*) -> void*
+    {
+        for(uint32_t i = 0; i < SPSC_MESSAGES; i++)
+        {
+            mbox.post(reinterpret_cast<const uint8_t *>(&i), os::WAIT_FOREVER);
+        }
+        return nullptr;
+    }};
+
+    ASSERT_EQ(producer.create(), osal::exit::OK);
+
+    uint32_t value = 0;
+    for(uint32_t i = 0; i < SPSC_MESSAGES; i++)
+    {
+        ASSERT_EQ(mbox.fetch(&value, 1'000), osal::exit::OK);
+        ASSERT_EQ(value, i);
+    }
+    producer.join();
+    EXPECT_EQ(mbox.size(), 0);
+}
+
+namespace
+{
+constexpr uint32_t MPMC_PRODUCERS = 4;
+constexpr uint32_t MPMC_MESSAGES = 20'000;
+os::queue* mpmc_mbox = nullptr;
+}
+
+TEST(queue_test, mpmc_multi_thread)
+{
+    os::queue mbox{8, sizeof(uint32_t), os::queue_mode::MPMC};
+    mpmc_mbox = &mbox;
+
+    auto producer = [](void* arg) -> void*
+    {
+        const uint32_t base = *static_cast<uint32_t*>(arg) * MPMC_MESSAGES;
+        for(uint32_t i = 0; i < MPMC_MESSAGES; i++)
+        {
+            uint32_t value = base + i;
+            mpmc_mbox->post(reinterpret_cast<const uint8_t *>(&value), os::WAIT_FOREVER);
+        }
+        return nullptr;
+    };
+
+    uint32_t ids[MPMC_PRODUCERS] = {0, 1, 2, 3};
+    os::thread producer1{"producer1", 4, OASL_TASK_HEAP, producer};
+    os::thread producer2{"producer2", 4, OASL_TASK_HEAP, producer};
+    os::thread producer3{"producer3", 4, OASL_TASK_HEAP, producer};
+    os::thread producer4{"producer4", 4, OASL_TASK_HEAP, producer};
+    ASSERT_EQ(producer1.create(&ids[0]), osal::exit::OK);
+    ASSERT_EQ(producer2.create(&ids[1]), osal::exit::OK);
+    ASSERT_EQ(producer3.create(&ids[2]), osal::exit::OK);
+    ASSERT_EQ(producer4.create(&ids[3]), osal::exit::OK);
+
+    uint32_t last[MPMC_PRODUCERS] = {0};
+    uint32_t received[MPMC_PRODUCERS] = {0};
+    for(uint32_t i = 0; i < MPMC_PRODUCERS * MPMC_MESSAGES; i++)
+    {
+        uint32_t value = 0;
+        ASSERT_EQ(mbox.fetch(&value, 1'000), osal::exit::OK);
+        const uint32_t id = value / MPMC_MESSAGES;
+        ASSERT_LT(id, MPMC_PRODUCERS);
+        // messages from one producer keep their order
+        if(received[id])
+        {
+            ASSERT_GT(value, last[id]);
+        }
+        last[id] = value;
+        received[id]++;
+    }
+
+    producer1.join();
+    producer2.join();
+    producer3.join();
+    producer4.join();
+
+    for(auto count : received)
+    {
+        EXPECT_EQ(count, MPMC_MESSAGES);
+    }
+    EXPECT_EQ(mbox.size(), 0);
+
+    uint32_t value = 0;
+    EXPECT_EQ(mbox.fetch(&value, 0), osal::exit::KO);
+}
+
+namespace
+{
+constexpr uint32_t LOCKED_THREADS = 4;
+constexpr uint32_t LOCKED_MESSAGES = 5'000;
+os::queue* locked_mbox = nullptr;
+std::atomic<uint32_t> locked_timeouts{0};
+}
+
+TEST(queue_test, locked_many_waiters)
+{
+    // a one slot queue keeps producers and consumers sleeping together: a wakeup delivered to
+    // the wrong side would leave everybody waiting and show up as timeouts
+    os::queue mbox{1, sizeof(uint32_t)};
+    locked_mbox = &mbox;
+    locked_timeouts = 0;
+
+    auto producer = [](void*) -> void*
+    {
+        for(uint32_t i = 0; i < LOCKED_MESSAGES; i++)
+        {
+            if(locked_mbox->post(reinterpret_cast<const uint8_t *>(&i), 2'000) != osal::exit::OK)
+            {
+                locked_timeouts++;
+            }
+        }
+        return nullptr;
+    };
+
+    auto consumer = [](void*) -> void*
+    {
+        uint32_t value = 0;
+        for(uint32_t i = 0; i < LOCKED_MESSAGES; i++)
+        {
+            if(locked_mbox->fetch(&value, 2'000) != osal::exit::OK)
+            {
+                locked_timeouts++;
+            }
+        }
+        return nullptr;
+    };
+
+    os::thread* threads[LOCKED_THREADS * 2]{};
+    for(uint32_t i = 0; i < LOCKED_THREADS; i++)
+    {
+        threads[2 * i] = new os::thread{"consumer", 4, OASL_TASK_HEAP, consumer};
+        threads[2 * i + 1] = new os::thread{"producer", 4, OASL_TASK_HEAP, producer};
+        ASSERT_EQ(threads[2 * i]->create(), osal::exit::OK);
+        ASSERT_EQ(threads[2 * i + 1]->create(), osal::exit::OK);
+    }
+    for(auto t : threads)
+    {
+        t->join();
+        delete t;
+    }
+
+    EXPECT_EQ(locked_timeouts, 0);
+    EXPECT_EQ(mbox.size(), 0);
+}
+
+TEST(queue_test, bulk_wrap)
+{
+    for(auto mode : {os::queue_mode::LOCKED, os::queue_mode::SPSC, os::queue_mode::MPMC})
+    {
+        os::queue mbox{5, sizeof(uint32_t), mode};
+        uint32_t in[8] = {0, 1, 2, 3, 4, 5, 6, 7};
+        uint32_t out[8] = {0};
+        size_t got = 0;
+
+        // move the ring position so the next transfers cross the wrap
+        EXPECT_EQ(mbox.post_bulk(reinterpret_cast<const uint8_t *>(in), 3, 0), 3);
+        EXPECT_EQ(mbox.fetch_bulk(out, 8, got, 0), osal::exit::OK);
+        EXPECT_EQ(got, 3);
+
+        EXPECT_EQ(mbox.post_bulk(reinterpret_cast<const uint8_t *>(in), 8, 0), 5);
+        EXPECT_EQ(mbox.size(), 5);
+        EXPECT_EQ(mbox.post_bulk(reinterpret_cast<const uint8_t *>(in), 1, 0), 0);
+
+        EXPECT_EQ(mbox.fetch_bulk(out, 2, got, 0), osal::exit::OK);
+        EXPECT_EQ(got, 2);
+        EXPECT_EQ(out[0], 0);
+        EXPECT_EQ(out[1], 1);
+
+        EXPECT_EQ(mbox.fetch_bulk(out, 8, got, 0), osal::exit::OK);
+        EXPECT_EQ(got, 3);
+        EXPECT_EQ(out[0], 2);
+        EXPECT_EQ(out[2], 4);
+
+        EXPECT_EQ(mbox.fetch_bulk(out, 8, got, 0), osal::exit::KO);
+        EXPECT_EQ(got, 0);
+    }
+}
+
+TEST(queue_test, reserve_commit_acquire_release)
+{
+    for(auto mode : {os::queue_mode::LOCKED, os::queue_mode::SPSC, os::queue_mode::MPMC})
+    {
+        os::queue mbox{2, 256, mode};
+
+        for(uint8_t i = 0; i < 2; i++)
+        {
+            uint8_t* slot = mbox.reserve(0);
+            ASSERT_NE(slot, nullptr);
+            memset(slot, 'a' + i, 256);
+            EXPECT_EQ(mbox.commit(slot), osal::exit::OK);
+        }
+        EXPECT_EQ(mbox.size(), 2);
+        EXPECT_EQ(mbox.reserve(10), nullptr);
+
+        const uint8_t* frame = mbox.acquire(0);
+        ASSERT_NE(frame, nullptr);
+        EXPECT_EQ(frame[0], 'a');
+        EXPECT_EQ(frame[255], 'a');
+        EXPECT_EQ(mbox.release(frame), osal::exit::OK);
+
+        uint8_t data[256];
+        EXPECT_EQ(mbox.fetch(data, 0), osal::exit::OK);
+        EXPECT_EQ(data[0], 'b');
+
+        os::error* error = nullptr;
+        EXPECT_EQ(mbox.commit(data, &error), osal::exit::KO);
+        ASSERT_NE(error, nullptr);
+        EXPECT_EQ(error->get_code(), static_cast<uint8_t>(os::error_type::OS_EINVAL));
+        delete error;
+        error = nullptr;
+
+        EXPECT_EQ(mbox.acquire(0), nullptr);
+
+        // a slot goes back once, a second commit or release must not publish or free it again
+        uint8_t* slot = mbox.reserve(0);
+        ASSERT_NE(slot, nullptr);
+        EXPECT_EQ(mbox.commit(slot), osal::exit::OK);
+        EXPECT_EQ(mbox.commit(slot, &error), osal::exit::KO);
+        ASSERT_NE(error, nullptr);
+        EXPECT_EQ(error->get_code(), static_cast<uint8_t>(os::error_type::OS_EINVAL));
+        delete error;
+        error = nullptr;
+        EXPECT_EQ(mbox.size(), 1);
+
+        frame = mbox.acquire(0);
+        ASSERT_EQ(frame, slot);
+        EXPECT_EQ(mbox.release(frame), osal::exit::OK);
+        EXPECT_EQ(mbox.release(frame, &error), osal::exit::KO);
+        ASSERT_NE(error, nullptr);
+        EXPECT_EQ(error->get_code(), static_cast<uint8_t>(os::error_type::OS_EINVAL));
+        delete error;
+        EXPECT_EQ(mbox.size(), 0);
+        EXPECT_EQ(mbox.acquire(0), nullptr);
+    }
+}
+
+namespace
+{
+
+struct sample
+{
+    uint32_t id;
+    int16_t value[3];
+};
+
+os::static_queue<sample, 4> global_queue;
+
+}
+
+TEST(queue_test, static_queue)
+{
+    static_assert(os::static_queue<sample, 4>::capacity() == 4);
+
+    for(uint32_t round = 0; round < 3; round++)
+    {
+        for(uint32_t i = 0; i < 4; i++)
+        {
+            EXPECT_EQ(global_queue.post(sample{round * 4 + i, {1, 2, 3}}, 0), osal::exit::OK);
+        }
+        EXPECT_EQ(global_queue.size(), 4);
+
+        os::error* error = nullptr;
+        EXPECT_EQ(global_queue.post(sample{}, 10, &error), osal::exit::KO);
+        ASSERT_NE(error, nullptr);
+        EXPECT_EQ(error->get_code(), static_cast<uint8_t>(os::error_type::OS_ETIMEDOUT));
+        delete error;
+
+        for(uint32_t i = 0; i < 4; i++)
+        {
+            sample s{};
+            EXPECT_EQ(global_queue.fetch(s, 0), osal::exit::OK);
+            EXPECT_EQ(s.id, round * 4 + i);
+            EXPECT_EQ(s.value[2], 3);
+        }
+        EXPECT_EQ(global_queue.size(), 0);
+    }
+
+    sample s{};
+    EXPECT_EQ(global_queue.fetch(s, 10), osal::exit::KO);
+}
+
+TEST(queue_test, static_queue_two_thread)
+{
+    static os::static_queue<uint32_t, 8> numbers;
+    constexpr uint32_t total = 50'000;
+
+    os::thread producer{"producer", 4, OASL_TASK_HEAP, [](void*) -> void*
+    {
+        for(uint32_t i = 0; i < total; i++)
+        {
+            numbers.post(i, os::WAIT_FOREVER);
+        }
+        return nullptr;
+    }};
+    producer.create();
+
+    for(uint32_t i = 0; i < total; i++)
+    {
+        uint32_t n = 0;
+        ASSERT_EQ(numbers.fetch(n, os::WAIT_FOREVER), osal::exit::OK);
+        ASSERT_EQ(n, i);
+    }
+    producer.join();
+}
@@ -23,6 +23,10 @@
 
 #include <string.h>
 #include <iostream>
+#include <dirent.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/socket.h>
 #include"common_test.hpp"
 using namespace std;
 
@@ -229,6 +233,414 @@ TEST(buffer_test, rotation_full_read)
     ASSERT_EQ(strncmp(buffer, "67890ABCDE", sizeof(buffer)), 0);
 }
 
+TEST(buffer_test, trigger_level)
+{
+    os::stream_buffer stream(10, 4);
+    uint8_t buffer[10];
+
+    ASSERT_EQ(stream.send(reinterpret_cast<const uint8_t*>("123"), 3, 0), 3);
+    ASSERT_EQ(stream.receive(buffer, sizeof(buffer), 0), 0);
+    ASSERT_EQ(stream.size(), 3);
+
+    ASSERT_EQ(stream.send(reinterpret_cast<const uint8_t*>("4"), 1, 0), 1);
+    ASSERT_EQ(stream.receive(buffer, sizeof(buffer), 0), 4);
+    ASSERT_EQ(memcmp(buffer, "1234", 4), 0);
+}
+
+TEST(buffer_test, receive_at_least)
+{
+    os::stream_buffer stream(10, 8);
+    uint8_t buffer[10];
+
+    ASSERT_EQ(stream.send(reinterpret_cast<const uint8_t*>("12"), 2, 0), 2);
+    ASSERT_EQ(stream.receive(buffer, sizeof(buffer), 0), 0);
+    ASSERT_EQ(stream.receive_at_least(buffer, sizeof(buffer), 3, 0), 0);
+    ASSERT_EQ(stream.receive_at_least(buffer, sizeof(buffer), 1, 0), 2);
+    ASSERT_EQ(memcmp(buffer, "12", 2), 0);
+
+    // the minimum is clamped to the destination size
+    ASSERT_EQ(stream.send(reinterpret_cast<const uint8_t*>("345"), 3, 0), 3);
+    ASSERT_EQ(stream.receive_at_least(buffer, 2, 5, 0), 2);
+    ASSERT_EQ(memcmp(buffer, "34", 2), 0);
+}
+
+TEST(buffer_test, set_trigger_level)
+{
+    static os::stream_buffer stream(10, 8);
+    static size_t received = 0;
+
+    os::error* error = nullptr;
+    ASSERT_EQ(stream.set_trigger_level(11, &error), osal::exit::KO);
+    ASSERT_NE(error, nullptr);
+    delete error;
+
+    os::thread reader{"reader", 4, OASL_TASK_HEAP, [](void*) -> void*
+                       {
+                           uint8_t buffer[10];
+                           received = stream.receive(buffer, sizeof(buffer), 2'000);
+                           return nullptr;
+                       }};
+
+    ASSERT_EQ(reader.create(), osal::exit::OK);
+    ASSERT_EQ(stream.send(reinterpret_cast<const uint8_t*>("123"), 3, 0), 3);
+    os::us_sleep(20'000);
+    ASSERT_EQ(received, 0);
+
+    // the sleeping reader picks up the lower level at once
+    const uint64_t start = os::get_current_time_us();
+    ASSERT_EQ(stream.set_trigger_level(2), osal::exit::OK);
+    reader.join();
+    ASSERT_EQ(received, 3);
+    ASSERT_LT(os::get_current_time_us() - start, 1'000'000);
+}
+
+TEST(buffer_test, event_fd)
+{
+    os::stream_buffer stream(10, 4);
+    uint8_t buffer[10];
+
+    const int fd = stream.get_event_fd();
+    ASSERT_GE(fd, 0);
+    ASSERT_EQ(stream.get_event_fd(), fd);
+
+    pollfd pfd{fd, POLLIN, 0};
+    ASSERT_EQ(stream.send(reinterpret_cast<const uint8_t*>("123"), 3, 0), 3);
+    ASSERT_EQ(poll(&pfd, 1, 0), 0);
+
+    ASSERT_EQ(stream.send(reinterpret_cast<const uint8_t*>("4"), 1, 0), 1);
+    ASSERT_EQ(poll(&pfd, 1, 0), 1);
+
+    uint64_t value = 0;
+    ASSERT_EQ(read(fd, &value, sizeof(value)), sizeof(value));
+    ASSERT_EQ(stream.receive(buffer, sizeof(buffer), 0), 4);
+    ASSERT_EQ(stream.receive(buffer, sizeof(buffer), 0), 0);
+
+    // drained: armed again for the next batch
+    ASSERT_EQ(poll(&pfd, 1, 0), 0);
+    ASSERT_EQ(stream.send(reinterpret_cast<const uint8_t*>("5678"), 4, 0), 4);
+    ASSERT_EQ(poll(&pfd, 1, 0), 1);
+}
+
+namespace
+{
+
+struct event_fd_call
+{
+    os::stream_buffer* stream;
+    int fd;
+};
+
+size_t open_fds()
+{
+    size_t count = 0;
+    DIR* dir = opendir("/proc/self/fd");
+    while (dir && readdir(dir))
+    {
+        count++;
+    }
+    if (dir)
+    {
+        closedir(dir);
+    }
+    return count;
+}
+
+}
+
+TEST(buffer_test, event_fd_concurrent)
+{
+    const size_t before = open_fds();
+
+    for (int round = 0; round < 20; round++)
+    {
+        os::stream_buffer stream(10, 4);
+        event_fd_call calls[2] = {{&stream, -1}, {&stream, -1}};
+        auto get = [](void* arg) -> void*
+        {
+            auto call = static_cast<event_fd_call*>(arg);
+            call->fd = call->stream->get_event_fd();
+            return nullptr;
+        };
+        os::thread first{"first", 4, OASL_TASK_HEAP, get};
+        os::thread second{"second", 4, OASL_TASK_HEAP, get};
+
+        ASSERT_EQ(first.create(&calls[0]), osal::exit::OK);
+        ASSERT_EQ(second.create(&calls[1]), osal::exit::OK);
+        first.join();
+        second.join();
+
+        // one descriptor shared by both callers, the other one is closed
+        ASSERT_GE(calls[0].fd, 0);
+        ASSERT_EQ(calls[0].fd, calls[1].fd);
+    }
+
+    ASSERT_EQ(open_fds(), before);
+}
+
+TEST(buffer_test, span_in_place)
+{
+    os::stream_buffer stream(10, 1);
+    os::span regions[2];
+    uint8_t buffer[12];
+
+    ASSERT_EQ(stream.acquire_read(regions, 0), 0);
+    ASSERT_EQ(regions[0].size + regions[1].size, 0);
+
+    ASSERT_EQ(stream.acquire_write(regions, 0), 10);
+    ASSERT_EQ(regions[0].size, 10);
+    ASSERT_EQ(regions[1].size, 0);
+    memcpy(regions[0].data, "abcdefghijklmno", 15);
+    ASSERT_EQ(stream.commit_write(15), osal::exit::KO);
+    ASSERT_EQ(stream.commit_write(8), osal::exit::OK);
+
+    ASSERT_EQ(stream.acquire_read(regions, 0), 8);
+    ASSERT_EQ(memcmp(regions[0].data, "abcdefgh", 8), 0);
+    ASSERT_EQ(stream.commit_read(6), osal::exit::OK);
+
+    // move the indices next to the end of the storage so that the free space wraps
+    ASSERT_EQ(stream.send(reinterpret_cast<const uint8_t*>("1234567"), 7, 0), 7);
+    ASSERT_EQ(stream.receive(buffer, sizeof(buffer), 0), 9);
+    ASSERT_EQ(memcmp(buffer, "gh1234567", 9), 0);
+
+    ASSERT_EQ(stream.acquire_write(regions, 0), 10);
+    ASSERT_GT(regions[1].size, 0);
+    const char* text = "0123456789";
+    memcpy(regions[0].data, text, regions[0].size);
+    memcpy(regions[1].data, text + regions[0].size, regions[1].size);
+    ASSERT_EQ(stream.commit_write(10), osal::exit::OK);
+    ASSERT_TRUE(stream.is_full());
+
+    ASSERT_EQ(stream.acquire_read(regions, 0), 10);
+    ASSERT_GT(regions[1].size, 0);
+    ASSERT_EQ(memcmp(regions[0].data, text, regions[0].size), 0);
+    ASSERT_EQ(memcmp(regions[1].data, text + regions[0].size, regions[1].size), 0);
+    ASSERT_EQ(stream.commit_read(11), osal::exit::KO);
+    ASSERT_EQ(stream.commit_read(10), osal::exit::OK);
+    ASSERT_TRUE(stream.is_empty());
+}
+
+TEST(buffer_test, mirrored_contiguous)
+{
+    os::error* error = nullptr;
+    os::stream_buffer stream(100, 1, os::stream_buffer_mode::MIRRORED, &error);
+    ASSERT_EQ(error, nullptr);
+
+    os::span regions[2];
+    uint8_t buffer[100];
+
+    // walk the indices across the end of the page-sized storage
+    for(size_t moved = 0; moved < 4'050; moved += 50)
+    {
+        ASSERT_EQ(stream.send(buffer, 50, 0), 50);
+        ASSERT_EQ(stream.receive(buffer, 50, 0), 50);
+    }
+
+    for(int round = 0; round < 3; round++)
+    {
+        ASSERT_EQ(stream.acquire_write(regions, 0), 100);
+        ASSERT_EQ(regions[0].size, 100);
+        ASSERT_EQ(regions[1].size, 0);
+        for(size_t i = 0; i < 100; i++)
+        {
+            regions[0].data[i] = static_cast<uint8_t>(i + round);
+        }
+        ASSERT_EQ(stream.commit_write(100), osal::exit::OK);
+
+        ASSERT_EQ(stream.acquire_read(regions, 0), 100);
+        ASSERT_EQ(regions[0].size, 100);
+        ASSERT_EQ(regions[1].size, 0);
+        ASSERT_EQ(stream.commit_read(30), osal::exit::OK);
+
+        ASSERT_EQ(stream.receive(buffer, sizeof(buffer), 0), 70);
+        for(size_t i = 0; i < 70; i++)
+        {
+            ASSERT_EQ(buffer[i], static_cast<uint8_t>(i + 30 + round));
+        }
+    }
+}
+
+namespace
+{
+constexpr size_t STREAM_BYTES = 1024 * 1024;
+}
+
+TEST(buffer_test, two_thread_no_loss)
+{
+    static os::stream_buffer stream(100, 1);
+    static size_t bad_bytes = 0;
+    static size_t received = 0;
+
+    os::thread reader{"reader", 4, OASL_TASK_HEAP, [](void*) -> void*
+                       {
+                           uint8_t buffer[37];
+                           while(received < STREAM_BYTES)
+                           {
+                               const size_t n = stream.receive(buffer, sizeof(buffer), 1'000);
+                               for(size_t i = 0; i < n; i++)
+                               {
+                                   if(buffer[i] != static_cast<uint8_t>((received + i) % 251))
+                                   {
+                                       bad_bytes++;
+                                   }
+                               }
+                               if(n == 0)
+                               {
+                                   break;
+                               }
+                               received += n;
+                           }
+                           return nullptr;
+                       }};
+
+    ASSERT_EQ(reader.create(), osal::exit::OK);
+
+    uint8_t data[61];
+    size_t sent = 0;
+    while(sent < STREAM_BYTES)
+    {
+        const size_t n = STREAM_BYTES - sent < sizeof(data) ? STREAM_BYTES - sent : sizeof(data);
+        for(size_t i = 0; i < n; i++)
+        {
+            data[i] = static_cast<uint8_t>((sent + i) % 251);
+        }
+        ASSERT_EQ(stream.send(data, n, os::WAIT_FOREVER), n);
+        sent += n;
+    }
+
+    reader.join();
+    ASSERT_EQ(received, STREAM_BYTES);
+    ASSERT_EQ(bad_bytes, 0);
+    ASSERT_TRUE(stream.is_empty());
+}
+
+TEST(buffer_test, fd_bridge)
+{
+    static os::stream_buffer stream(1000, 1);
+    static int in[2];
+    static int out[2];
+    static size_t bad_bytes = 0;
+    static size_t checked = 0;
+
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, in), 0);
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, out), 0);
+
+    os::thread writer{"writer", 4, OASL_TASK_HEAP, [](void*) -> void*
+                       {
+                           uint8_t data[333];
+                           for(size_t sent = 0; sent < STREAM_BYTES; )
+                           {
+                               const size_t n = STREAM_BYTES - sent < sizeof(data) ? STREAM_BYTES - sent : sizeof(data);
+                               for(size_t i = 0; i < n; i++)
+                               {
+                                   data[i] = static_cast<uint8_t>((sent + i) % 251);
+                               }
+                               sent += write(in[0], data, n);
+                           }
+                           close(in[0]);
+                           return nullptr;
+                       }};
+    os::thread pump{"pump", 4, OASL_TASK_HEAP, [](void*) -> void*
+                       {
+                           // socket -> stream buffer until end of file
+                           while(stream.send_from_fd(in[1], STREAM_BYTES, os::WAIT_FOREVER) > 0);
+                           return nullptr;
+                       }};
+    os::thread reader{"reader", 4, OASL_TASK_HEAP, [](void*) -> void*
+                       {
+                           uint8_t data[512];
+                           while(checked < STREAM_BYTES)
+                           {
+                               const ssize_t n = read(out[1], data, sizeof(data));
+                               if(n <= 0)
+                               {
+                                   break;
+                               }
+                               for(ssize_t i = 0; i < n; i++)
+                               {
+                                   if(data[i] != static_cast<uint8_t>((checked + i) % 251))
+                                   {
+                                       bad_bytes++;
+                                   }
+                               }
+                               checked += n;
+                           }
+                           return nullptr;
+                       }};
+
+    ASSERT_EQ(writer.create(), osal::exit::OK);
+    ASSERT_EQ(pump.create(), osal::exit::OK);
+    ASSERT_EQ(reader.create(), osal::exit::OK);
+
+    // stream buffer -> socket
+    size_t forwarded = 0;
+    while(forwarded < STREAM_BYTES)
+    {
+        const size_t n = stream.receive_to_fd(out[0], STREAM_BYTES, 1'000);
+        ASSERT_GT(n, 0);
+        forwarded += n;
+    }
+
+    writer.join();
+    pump.join();
+    reader.join();
+    close(in[1]);
+    close(out[0]);
+    close(out[1]);
+
+    ASSERT_EQ(checked, STREAM_BYTES);
+    ASSERT_EQ(bad_bytes, 0);
+    ASSERT_TRUE(stream.is_empty());
+}
+
+TEST(buffer_test, backpressure_send)
+{
+    static os::stream_buffer stream(16, 1);
+    static uint8_t received[1000];
+    static size_t count = 0;
+
+    // no consumer: whatever fits is written, a partial send is not an error
+    uint8_t data[sizeof(received)];
+    for(size_t i = 0; i < sizeof(data); i++)
+    {
+        data[i] = static_cast<uint8_t>(i % 251);
+    }
+    os::error* error = nullptr;
+    ASSERT_EQ(stream.send(data, 40, 20, &error), 16);
+    ASSERT_EQ(error, nullptr);
+
+    // full buffer: nothing sent within the deadline is reported as a timeout
+    ASSERT_EQ(stream.send(data, 1, 20, &error), 0);
+    ASSERT_NE(error, nullptr);
+    ASSERT_EQ(error->get_code(), static_cast<uint8_t>(os::error_type::OS_ETIMEDOUT));
+    delete error;
+    error = nullptr;
+    stream.reset();
+
+    // a slow consumer throttles the producer instead of losing bytes
+    os::thread reader{"reader", 4, OASL_TASK_HEAP, [](void*) -> void*
+                       {
+                           while(count < sizeof(received))
+                           {
+                               os::us_sleep(100);
+                               const size_t n = stream.receive(received + count, 7, 1'000);
+                               if(n == 0)
+                               {
+                                   break;
+                               }
+                               count += n;
+                           }
+                           return nullptr;
+                       }};
+
+    ASSERT_EQ(reader.create(), osal::exit::OK);
+    ASSERT_EQ(stream.send(data, sizeof(data), os::WAIT_FOREVER, &error), sizeof(data));
+    ASSERT_EQ(error, nullptr);
+    reader.join();
+
+    ASSERT_EQ(count, sizeof(received));
+    ASSERT_EQ(memcmp(received, data, sizeof(data)), 0);
+}
+
 string now() {
     time_t t = time(0);
     char buffer[9] = {0};
@@ -20,7 +20,10 @@
 
 #include"osal/osal.hpp"
 
+#include <dirent.h>
 #include <string.h>
+#include <atomic>
+#include <initializer_list>
 
 static char args[] = "args 1";
 
@@ -33,6 +36,31 @@ os::timer timer{1000
 };
 
 
+static std::atomic<uint32_t> table_calls{0};
+
+static os::timer table[] = {
+    {2'000, [](auto, auto) -> void* { table_calls++; return nullptr; }},
+    {3'000, [](auto, auto) -> void* { table_calls++; return nullptr; }},
+    {5'000, [](auto, auto) -> void* { table_calls++; return nullptr; }},
+    {7'000, [](auto, auto) -> void* { table_calls++; return nullptr; }},
+};
+
+static size_t thread_count()
+{
+    size_t ret = 0;
+    DIR* dir = opendir("/proc/self/task");
+    while(dir && readdir(dir))
+    {
+        ret++;
+    }
+    if(dir)
+    {
+        closedir(dir);
+    }
+    return ret;
+}
+
+
 TEST(timer_test, single_timer)
 {
 
@@ -45,3 +73,387 @@ TEST(timer_test, single_timer)
     timer.start();
 
 }
+
+TEST(timer_test, one_shot)
+{
+    static std::atomic<uint32_t> fired{0};
+    os::timer one_shot{5'000, [](auto, auto) -> void*
+                       {
+                           fired++;
+                           return nullptr;
+                       }, true};
+
+    ASSERT_EQ(one_shot.create(), osal::exit::OK);
+    one_shot.start();
+    ASSERT_TRUE(one_shot.is_active());
+    os::us_sleep(50'000);
+    ASSERT_EQ(fired, 1);
+    ASSERT_FALSE(one_shot.is_active());
+}
+
+TEST(timer_test, periodic_stop)
+{
+    static std::atomic<uint32_t> fired{0};
+    os::timer periodic{2'000, [](auto, auto) -> void*
+                       {
+                           fired++;
+                           return nullptr;
+                       }};
+
+    ASSERT_EQ(periodic.create(), osal::exit::OK);
+    periodic.start();
+    os::us_sleep(50'000);
+    periodic.stop();
+    const uint32_t count = fired;
+    ASSERT_GE(count, 5);
+    ASSERT_LE(count, 26);
+
+    os::us_sleep(20'000);
+    ASSERT_EQ(fired, count);
+    ASSERT_FALSE(periodic.is_active());
+}
+
+TEST(timer_test, thousand_timers_one_service)
+{
+    constexpr size_t TIMERS = 1'000;
+    static std::atomic<uint32_t> fired{0};
+    static os::timer* timers[TIMERS];
+
+    // periods spread over the first two wheel levels, every timer fires once
+    for(size_t i = 0; i < TIMERS; i++)
+    {
+        timers[i] = new os::timer{1'000 + i * 97, [](auto, auto) -> void*
+                                  {
+                                      fired++;
+                                      return nullptr;
+                                  }, true};
+        ASSERT_EQ(timers[i]->create(), osal::exit::OK);
+        timers[i]->start();
+    }
+
+    for(uint32_t i = 0; i < 100 && fired < TIMERS; i++)
+    {
+        os::us_sleep(10'000);
+    }
+    ASSERT_EQ(fired, TIMERS);
+
+    for(auto& timer : timers)
+    {
+        delete timer;
+        timer = nullptr;
+    }
+}
+
+TEST(timer_test, long_period)
+{
+    static std::atomic<uint64_t> fired_at{0};
+    os::timer one_shot{1'200'000, [](auto, auto) -> void*
+                       {
+                           fired_at = os::get_current_time_us();
+                           return nullptr;
+                       }, true};
+
+    // 1.2 s spans a level 1 cascade and exceeds the old timer_settime() nanosecond field
+    ASSERT_EQ(one_shot.create(), osal::exit::OK);
+    const uint64_t start = os::get_current_time_us();
+    one_shot.start();
+    os::us_sleep(1'400'000);
+    ASSERT_GE(fired_at - start, 1'200'000);
+    ASSERT_LT(fired_at - start, 1'300'000);
+}
+
+TEST(timer_test, skip_overrun)
+{
+    static std::atomic<uint32_t> calls{0};
+    static std::atomic<uint32_t> overrun{0};
+    os::timer periodic{2'000, [](auto timer, auto) -> void*
+                       {
+                           if(calls++ == 0)
+                           {
+                               // the second expiration is served 5 ms late: 2 schedule points pass without a call
+                               os::us_sleep(7'000);
+                           }
+                           else if(calls == 2)
+                           {
+                               overrun = timer->overrun();
+                           }
+                           return nullptr;
+                       }};
+
+    ASSERT_EQ(periodic.create(), osal::exit::OK);
+    periodic.start();
+    os::us_sleep(30'000);
+    periodic.stop();
+
+    ASSERT_GE(overrun, 2);
+    ASSERT_LE(calls, 14);
+}
+
+TEST(timer_test, catch_up)
+{
+    static std::atomic<uint32_t> calls{0};
+    os::timer periodic{2'000, [](auto, auto) -> void*
+                       {
+                           if(calls++ == 0)
+                           {
+                               os::us_sleep(9'000);
+                           }
+                           return nullptr;
+                       }};
+
+    ASSERT_EQ(periodic.create(), osal::exit::OK);
+    ASSERT_EQ(periodic.set_policy(os::timer_policy::CATCH_UP), osal::exit::OK);
+    const uint64_t start = os::get_current_time_us();
+    periodic.start();
+    os::us_sleep(40'000);
+    periodic.stop();
+    const uint64_t elapsed = os::get_current_time_us() - start;
+
+    // every expiration of the schedule is served, the late ones back to back
+    const uint32_t expected = elapsed / 2'000;
+    ASSERT_GE(calls + 2, expected);
+    ASSERT_LE(calls, expected + 1);
+}
+
+TEST(timer_test, start_at_no_drift)
+{
+    static std::atomic<uint32_t> calls{0};
+    static std::atomic<uint64_t> last{0};
+    os::timer periodic{3'000, [](auto, auto) -> void*
+                       {
+                           last = os::tick_current();
+                           calls++;
+                           return nullptr;
+                       }};
+
+    ASSERT_EQ(periodic.create(), osal::exit::OK);
+    const os::deadline first = os::deadline::from_ms(5);
+    periodic.start_at(first);
+    while(calls < 20)
+    {
+        os::us_sleep(1'000);
+    }
+    periodic.stop();
+
+    // the 20th expiration sits on the schedule computed from the deadline, not 20 accumulated lags;
+    // a skipped point on a loaded host moves it by whole periods only
+    const uint64_t scheduled = static_cast<os::tick>(first) + 19 * os::tick_from_us(3'000);
+    ASSERT_GE(last.load(), scheduled);
+    ASSERT_LT((last - scheduled) % os::tick_from_us(3'000), os::tick_from_us(2'000));
+}
+
+TEST(timer_test, pool_serialized)
+{
+    static std::atomic<uint32_t> fast_calls{0};
+    static std::atomic<uint32_t> slow_calls{0};
+    static std::atomic<uint32_t> inside{0};
+    static std::atomic<uint32_t> overlap{0};
+    os::timer slow{2'000, [](auto, auto) -> void*
+                   {
+                       if(inside++ != 0)
+                       {
+                           overlap++;
+                       }
+                       slow_calls++;
+                       os::us_sleep(15'000);
+                       inside--;
+                       return nullptr;
+                   }};
+    os::timer fast{2'000, [](auto, auto) -> void*
+                   {
+                       fast_calls++;
+                       return nullptr;
+                   }};
+
+    ASSERT_EQ(slow.create(), osal::exit::OK);
+    ASSERT_EQ(slow.set_dispatch(os::timer_dispatch::POOL), osal::exit::OK);
+    ASSERT_EQ(fast.create(), osal::exit::OK);
+    slow.start();
+    fast.start();
+    os::us_sleep(100'000);
+    slow.stop();
+    fast.stop();
+
+    // the slow handler keeps a worker busy but neither delays the service nor runs twice at once
+    ASSERT_GE(fast_calls, 30);
+    ASSERT_EQ(overlap, 0);
+    ASSERT_LE(slow_calls, 8);
+    ASSERT_GT(slow.coalesced(), 0);
+}
+
+TEST(timer_test, pool_dropped)
+{
+    static std::atomic<uint32_t> calls{0};
+    auto block = [](auto, auto) -> void*
+    {
+        os::us_sleep(60'000);
+        return nullptr;
+    };
+    os::timer a{1'000, block, true};
+    os::timer b{1'000, block, true};
+    os::timer c{5'000, [](auto, auto) -> void*
+                {
+                    calls++;
+                    return nullptr;
+                }, true};
+
+    for(auto timer : {&a, &b, &c})
+    {
+        ASSERT_EQ(timer->create(), osal::exit::OK);
+        ASSERT_EQ(timer->set_dispatch(os::timer_dispatch::POOL), osal::exit::OK);
+        timer->start();
+    }
+
+    // both workers are busy, c waits in the queue until it is stopped
+    os::us_sleep(20'000);
+    c.stop();
+    ASSERT_EQ(c.dropped(), 1);
+    os::us_sleep(60'000);
+    ASSERT_EQ(calls, 0);
+}
+
+TEST(timer_test, pool_overrun)
+{
+    static std::atomic<uint32_t> calls{0};
+    static std::atomic<uint32_t> merged{0};
+    os::timer slow{1'000, [](auto timer, auto) -> void*
+                   {
+                       calls++;
+                       merged += timer->overrun();
+                       os::us_sleep(10'000);
+                       return nullptr;
+                   }};
+
+    ASSERT_EQ(slow.create(), osal::exit::OK);
+    ASSERT_EQ(slow.set_dispatch(os::timer_dispatch::POOL), osal::exit::OK);
+    slow.start();
+    os::us_sleep(100'000);
+    slow.stop();
+    os::us_sleep(20'000);
+
+    // the expirations merged while the handler sleeps reach it through overrun()
+    ASSERT_GE(calls, 3);
+    ASSERT_GT(slow.coalesced(), 0);
+    ASSERT_GT(merged, 0);
+    ASSERT_GT(slow.get_stats().overrun.percentile(100), 0);
+}
+
+TEST(timer_test, slack_coalescing)
+{
+    static std::atomic<uint32_t> calls{0};
+    auto count = [](auto, auto) -> void*
+    {
+        calls++;
+        return nullptr;
+    };
+    os::timer loose{10'000, count};
+    os::timer strict{10'000, count};
+
+    // the 1 ms global timer would serve every expiration on its own wakeups
+    timer.stop();
+
+    ASSERT_EQ(loose.create(), osal::exit::OK);
+    ASSERT_EQ(strict.create(), osal::exit::OK);
+    loose.set_slack(5'000);
+
+    // loose expires 3 ms before strict: it waits within its slack and shares strict's wakeup
+    const os::timer_service_stats before = os::timer::get_service_stats();
+    const os::tick origin = os::tick_current();
+    loose.start_at(origin + os::tick_from_us(10'000));
+    strict.start_at(origin + os::tick_from_us(13'000));
+    os::us_sleep(200'000);
+    loose.stop();
+    strict.stop();
+    const os::timer_service_stats after = os::timer::get_service_stats();
+
+    const uint64_t expirations = after.expirations - before.expirations;
+    ASSERT_EQ(expirations, calls);
+    ASSERT_GE(expirations, 30);
+    ASSERT_GE(after.saved_wakeups - before.saved_wakeups, expirations / 2 - 4);
+}
+
+TEST(timer_test, stats_histogram)
+{
+    static std::atomic<uint32_t> calls{0};
+    os::timer slow{5'000, [](auto, auto) -> void*
+                   {
+                       calls++;
+                       os::us_sleep(2'000);
+                       return nullptr;
+                   }};
+
+    os::timer_histogram histogram;
+    ASSERT_EQ(histogram.percentile(50), 0);
+    for(uint64_t value : {0, 1, 3, 100, 1'000})
+    {
+        histogram.record(value);
+    }
+    ASSERT_EQ(histogram.count(), 5);
+    ASSERT_EQ(histogram.percentile(0), 0);
+    ASSERT_EQ(histogram.percentile(50), 3);
+    ASSERT_EQ(histogram.percentile(100), 1'023);
+    histogram.reset();
+    ASSERT_EQ(histogram.count(), 0);
+
+    const uint64_t global = os::timer::get_global_stats().lateness.count();
+    ASSERT_EQ(slow.create(), osal::exit::OK);
+    slow.start();
+    os::us_sleep(60'000);
+    slow.stop();
+    // stop() does not wait for a running handler, its call is recorded when it returns
+    os::us_sleep(10'000);
+
+    // every call is recorded once per histogram, in the timer and in the global statistics
+    os::timer_stats& stats = slow.get_stats();
+    ASSERT_GE(calls, 5);
+    ASSERT_EQ(stats.lateness.count(), calls);
+    ASSERT_EQ(stats.run_time.count(), calls);
+    ASSERT_EQ(stats.overrun.count(), calls);
+    ASSERT_GE(os::timer::get_global_stats().lateness.count() - global, calls);
+    ASSERT_GE(stats.run_time.percentile(50), 1'000'000);
+    ASSERT_LT(stats.lateness.percentile(50), 5'000'000);
+}
+
+TEST(timer_test, static_table)
+{
+    // the service starts with the first timer ever created, the global one
+    ASSERT_EQ(timer.create(args), osal::exit::OK);
+    const size_t threads = thread_count();
+
+    for(auto&& t : table)
+    {
+        ASSERT_EQ(t.create(), osal::exit::OK);
+        t.start();
+    }
+    os::us_sleep(50'000);
+    ASSERT_EQ(thread_count(), threads);
+    for(auto&& t : table)
+    {
+        t.stop();
+    }
+
+    ASSERT_GE(table_calls, 20);
+}
+
+TEST(timer_test, self_delete)
+{
+    static std::atomic<uint32_t> calls{0};
+    auto destroy = [](auto timer, auto) -> void*
+    {
+        calls++;
+        delete timer;
+        return nullptr;
+    };
+
+    // neither the service nor a worker touches the timer once its handler has deleted it
+    auto inline_timer = new os::timer{2'000, destroy, true};
+    auto pooled_timer = new os::timer{2'000, destroy, true};
+    ASSERT_EQ(inline_timer->create(), osal::exit::OK);
+    ASSERT_EQ(pooled_timer->create(), osal::exit::OK);
+    ASSERT_EQ(pooled_timer->set_dispatch(os::timer_dispatch::POOL), osal::exit::OK);
+    inline_timer->start();
+    pooled_timer->start();
+    os::us_sleep(50'000);
+
+    ASSERT_EQ(calls, 2);
+}
@@ -75,4 +75,46 @@ TEST(timing_test, literal)
 {
     ASSERT_EQ(1_s, sec_to_us(1));
     ASSERT_EQ(1_ms, ms_to_us(1));
-}
\ No newline at end of file
+}
+
+TEST(timing_test, deadline)
+{
+    ASSERT_FALSE(os::deadline{}.expired());
+    ASSERT_EQ(static_cast<os::tick>(os::deadline{}), WAIT_FOREVER);
+
+    const os::deadline past{os::tick_current()};
+    ASSERT_TRUE(past.expired());
+    ASSERT_TRUE(os::deadline::from_ms(0).expired());
+
+    const os::deadline soon = os::deadline::from_ms(50);
+    ASSERT_FALSE(soon.expired());
+    os::us_sleep(60_ms);
+    ASSERT_TRUE(soon.expired());
+}
+
+TEST(timing_test, shared_deadline)
+{
+    os::semaphore sem{0};
+    os::queue queue{2, sizeof(uint32_t)};
+    os::event event;
+    uint32_t value = 0;
+
+    // a deadline already passed turns every wait into a try
+    const os::deadline past{os::tick_current()};
+    ASSERT_EQ(sem.wait_until(past), osal::exit::KO);
+    ASSERT_EQ(queue.fetch_until(&value, past), osal::exit::KO);
+    ASSERT_EQ(event.wait_until(1, value, past), osal::exit::KO);
+
+    // successive waits share one budget instead of restarting it
+    const auto start = os::tick_current();
+    const os::deadline budget = os::deadline::from_ms(100);
+    ASSERT_EQ(sem.wait_until(budget), osal::exit::KO);
+    ASSERT_EQ(queue.fetch_until(&value, budget), osal::exit::KO);
+    ASSERT_EQ(event.wait_until(1, value, budget), osal::exit::KO);
+    const auto elapsed_ms = (os::tick_current() - start) / 1'000'000;
+    ASSERT_GE(elapsed_ms, 100u);
+    ASSERT_LT(elapsed_ms, 200u);
+
+    sem.signal();
+    ASSERT_EQ(sem.wait_until(os::deadline::from_ms(100)), osal::exit::OK);
+}